@@ -0,0 +1,271 @@
+// Multi-threaded stress harness for ActorStateStore.
+//
+// Writer threads simulate actors passing through a long session: each keeps a window of "loaded" actors, attaches
+// new ones with FormIDs that only ever grow, updates loaded ones and detaches the oldest, for a total of --events
+// churn events. Reader threads look up loaded and long-gone actors the whole time, and a pruner thread keeps
+// sweeping the store the way the periodic SKEE check does. Every value encodes a checksum of its FormID, so a torn
+// or misplaced entry shows up in any read. The harness fails unless:
+//
+//   - no read ever returns a value that does not belong to the FormID looked up
+//   - at the end, every loaded actor still in the store holds the value its writer wrote last, no detached actor is
+//     left, and the size matches the entries actually present
+//   - the store's memory stays at its cap, and the process RSS stays flat after warm-up (Linux)
+//
+// Build it with -fsanitize=thread to have the same run checked for data races.
+//
+//   ActorStateStoreBench [--events N] [--writers N] [--readers N] [--loaded N] [--cap BYTES]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+    #include <unistd.h>
+#endif
+
+#include "ActorStateStore.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::size_t events = 1000000;
+        std::size_t writers = 4;
+        std::size_t readers = 4;
+        std::size_t loaded = 1000;  // actors loaded at a time, per writer
+        std::size_t cap = ActorStateStore::kDefaultMemoryCap;
+    };
+
+    // The high nibble of every value is a checksum of the FormID it was stored for; the low nibble is a version.
+    std::uint8_t Checksum(std::uint32_t a_formID) {
+        return static_cast<std::uint8_t>((a_formID * 0x9E3779B1u) >> 24) & 0xF0;
+    }
+
+    std::uint8_t MakeValue(std::uint32_t a_formID, std::uint8_t a_version) {
+        return static_cast<std::uint8_t>(Checksum(a_formID) | (a_version & 0x0F));
+    }
+
+    // Writer t owns FormIDs t, t + writers, t + 2 * writers, ... starting above zero.
+    std::uint32_t FormIDOf(std::size_t a_writer, std::size_t a_writers, std::uint64_t a_serial) {
+        return static_cast<std::uint32_t>(1 + a_writer + a_serial * a_writers);
+    }
+
+    std::size_t GetResidentBytes() {
+#if defined(__linux__)
+        long pages = 0;
+        long resident = 0;
+        if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            std::fclose(statm);
+        }
+        return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+    struct Writer {
+        struct Loaded {
+            std::uint32_t formID;
+            std::uint8_t version;
+        };
+        std::deque<Loaded> loaded;                    // oldest first
+        std::vector<std::uint32_t> detached;          // the most recent, checked at the end
+        std::uint64_t nextSerial{};
+        std::atomic<std::uint64_t> highestSerial{0};  // readers aim below this
+    };
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::size_t value = std::strtoull(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--events") == 0) {
+            options.events = value;
+        } else if (std::strcmp(argv[i], "--writers") == 0) {
+            options.writers = std::max<std::size_t>(1, value);
+        } else if (std::strcmp(argv[i], "--readers") == 0) {
+            options.readers = value;
+        } else if (std::strcmp(argv[i], "--loaded") == 0) {
+            options.loaded = std::max<std::size_t>(1, value);
+        } else if (std::strcmp(argv[i], "--cap") == 0) {
+            options.cap = value;
+        } else {
+            std::fprintf(stderr,
+                         "usage: ActorStateStoreBench [--events N] [--writers N] [--readers N] [--loaded N] "
+                         "[--cap BYTES]\n");
+            return 2;
+        }
+    }
+
+    ActorStateStore store(options.cap);
+    const std::size_t memoryBefore = store.GetMemoryUsage();
+    std::vector<Writer> writers(options.writers);
+    std::atomic<bool> isDone{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> badReads{0};
+    std::atomic<std::uint64_t> pruneSweeps{0};
+    std::atomic<std::size_t> eventsDone{0};
+    std::size_t rssAfterWarmup = 0;
+    std::size_t rssPeak = 0;
+
+    const auto writerMain = [&](std::size_t a_index) {
+        Writer& writer = writers[a_index];
+        std::mt19937 rng(static_cast<std::uint32_t>(a_index + 1));
+        const std::size_t events = options.events / options.writers;
+        for (std::size_t event = 0; event < events; ++event) {
+            const std::uint32_t roll = rng() % 8;
+            if (writer.loaded.size() < options.loaded && roll < 3) {
+                // An actor comes into the loaded area.
+                const std::uint32_t formID = FormIDOf(a_index, options.writers, writer.nextSerial++);
+                writer.loaded.push_back({formID, 0});
+                store.Store(formID, MakeValue(formID, 0));
+                writer.highestSerial.store(writer.nextSerial, std::memory_order_relaxed);
+            } else if (!writer.loaded.empty() && roll < 6) {
+                // A loaded actor changes clothes.
+                auto& actor = writer.loaded[rng() % writer.loaded.size()];
+                store.Store(actor.formID, MakeValue(actor.formID, ++actor.version));
+            } else if (!writer.loaded.empty()) {
+                // The actor that has been around longest leaves.
+                store.Erase(writer.loaded.front().formID);
+                writer.detached.push_back(writer.loaded.front().formID);
+                writer.loaded.pop_front();
+                if (writer.detached.size() > 4 * options.loaded) {
+                    writer.detached.erase(writer.detached.begin(), writer.detached.begin() + options.loaded);
+                }
+            }
+            eventsDone.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    const auto readerMain = [&](std::size_t a_index) {
+        std::mt19937 rng(static_cast<std::uint32_t>(1000 + a_index));
+        std::uint64_t localReads = 0;
+        std::uint64_t localHits = 0;
+        while (!isDone.load(std::memory_order_relaxed)) {
+            const std::size_t writer = rng() % options.writers;
+            const std::uint64_t highest = writers[writer].highestSerial.load(std::memory_order_relaxed);
+            if (highest == 0) {
+                continue;
+            }
+            // Mostly recent actors, sometimes any actor ever seen.
+            const std::uint64_t window =
+                rng() % 4 == 0 ? highest : std::min<std::uint64_t>(highest, 4 * options.loaded);
+            const std::uint32_t formID = FormIDOf(writer, options.writers, highest - 1 - rng() % window);
+            const auto value = store.Find(formID);
+            ++localReads;
+            if (value) {
+                ++localHits;
+                if ((*value & 0xF0) != Checksum(formID)) {
+                    badReads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        reads.fetch_add(localReads, std::memory_order_relaxed);
+        hits.fetch_add(localHits, std::memory_order_relaxed);
+    };
+
+    // Stands in for the periodic SKEE check: sweeps every shard, keeping everything, so it only contends.
+    const auto prunerMain = [&] {
+        while (!isDone.load(std::memory_order_relaxed)) {
+            store.EraseIf([](std::uint32_t) { return false; });
+            pruneSweeps.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < options.readers; ++i) {
+        threads.emplace_back(readerMain, i);
+    }
+    threads.emplace_back(prunerMain);
+    std::vector<std::thread> writerThreads;
+    for (std::size_t i = 0; i < options.writers; ++i) {
+        writerThreads.emplace_back(writerMain, i);
+    }
+
+    // Sample RSS while the churn runs; the first tenth is warm-up.
+    const std::size_t totalEvents = options.events / options.writers * options.writers;
+    while (eventsDone.load(std::memory_order_relaxed) < totalEvents) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        const std::size_t rss = GetResidentBytes();
+        if (rssAfterWarmup == 0 && eventsDone.load(std::memory_order_relaxed) >= totalEvents / 10) {
+            rssAfterWarmup = rss;
+        }
+        rssPeak = std::max(rssPeak, rss);
+    }
+    for (auto& thread : writerThreads) {
+        thread.join();
+    }
+    const double churnSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    isDone.store(true, std::memory_order_relaxed);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Final state against every writer's own record.
+    std::size_t present = 0;
+    std::size_t evicted = 0;
+    std::size_t stale = 0;
+    std::size_t leftovers = 0;
+    for (const Writer& writer : writers) {
+        for (const auto& actor : writer.loaded) {
+            const auto value = store.Find(actor.formID);
+            if (!value) {
+                ++evicted;
+                continue;
+            }
+            ++present;
+            stale += *value != MakeValue(actor.formID, actor.version) ? 1 : 0;
+        }
+        for (const std::uint32_t formID : writer.detached) {
+            leftovers += store.Find(formID) ? 1 : 0;
+        }
+    }
+
+    // The periodic check proper: keep only what is loaded.
+    std::unordered_map<std::uint32_t, bool> isLoaded;
+    for (const Writer& writer : writers) {
+        for (const auto& actor : writer.loaded) {
+            isLoaded[actor.formID] = true;
+        }
+    }
+    const std::size_t pruned = store.EraseIf([&](std::uint32_t a_formID) { return !isLoaded.contains(a_formID); });
+    const auto stats = store.GetStats();
+
+    const std::size_t rssGrowth = rssPeak > rssAfterWarmup ? rssPeak - rssAfterWarmup : 0;
+    constexpr std::size_t kRssSlack = 4 << 20;
+    const bool isMemoryFlat = stats.memoryUsage == memoryBefore && (rssAfterWarmup == 0 || rssGrowth <= kRssSlack);
+
+    std::printf("%zu churn event(s) on %zu writer(s), %zu reader(s), 1 pruner; %zu loaded actor(s) per writer\n",
+                totalEvents, options.writers, options.readers, options.loaded);
+    std::printf("churn      %.2f s, %.1f M event(s)/s\n", churnSeconds, totalEvents / churnSeconds / 1e6);
+    std::printf("reads      %llu, %llu hit(s), %llu bad\n", static_cast<unsigned long long>(reads.load()),
+                static_cast<unsigned long long>(hits.load()), static_cast<unsigned long long>(badReads.load()));
+    std::printf("prunes     %llu sweep(s) during churn, %zu stray entr(ies) after\n",
+                static_cast<unsigned long long>(pruneSweeps.load()), pruned);
+    std::printf("store      %zu of %zu slot(s), %.1f KiB (cap %.1f KiB), %llu eviction(s), %llu removal(s)\n",
+                stats.size, stats.capacity, stats.memoryUsage / 1024.0, options.cap / 1024.0,
+                static_cast<unsigned long long>(stats.evictions), static_cast<unsigned long long>(stats.removals));
+    std::printf("final      %zu loaded present, %zu evicted, %zu stale value(s), %zu detached left over\n", present,
+                evicted, stale, leftovers);
+    std::printf("rss        %.1f MiB after warm-up, %.1f MiB peak -> %s\n", rssAfterWarmup / 1048576.0,
+                rssPeak / 1048576.0, isMemoryFlat ? "flat" : "GROWING");
+
+    const bool isOk = badReads.load() == 0 && stale == 0 && leftovers == 0 && pruned == 0 &&
+                      stats.size == present && (evicted == 0 || stats.evictions > 0) && isMemoryFlat;
+    std::printf("%s\n", isOk ? "ok" : "FAILED");
+    return isOk ? 0 : 1;
+}
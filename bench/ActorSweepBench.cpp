@@ -0,0 +1,277 @@
+// Headless harness for ActorSweep, the per-frame budgeted re-evaluation of loaded actors.
+//
+// Builds a crowd of synthetic actors at random distances from the camera, each wearing some mix of high heels, low
+// heels, pantyhose and boots. Some were "saved" with morphs that no longer match what they wear. The whole crowd is
+// queued the way the plugin does after a game load, and a fake frame clock runs one RunFrame() per frame. Along the
+// way a few actors unload and a cell attach queues more. The morphs recorded in a frame are committed at its end.
+// The harness fails unless:
+//
+//   - no frame makes more ApplyBodyMorphs calls or checks more actors than the budget allows
+//   - actors are checked nearest first
+//   - every actor still loaded at the end carries exactly the morphs of what it wears
+//
+//   ActorSweepBench [--actors N] [--updates N] [--checks N] [--seed N]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ActorSweep.h"
+#include "EquipPipeline.h"
+#include "MorphApplier.h"
+
+namespace {
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kFirstActor = 0xFF000800;
+    constexpr std::size_t kUnloadFrame = 3;
+    constexpr std::size_t kAttachFrame = 5;
+    constexpr std::size_t kMaxFrames = 100000;
+
+    struct Options {
+        std::size_t actors = 500;
+        ActorSweep::Budget budget;
+        std::uint32_t seed = 1;
+    };
+
+    enum Armor : std::uint32_t {
+        kNone = 0,
+        kHighHeels = 0x00012E46,
+        kLowHeels = 0x00012E4B,
+        kPantyhose = 0x00013EE1,
+        kHeeledBoots = 0x00013EE4,  // feet and calves
+    };
+
+    struct Actor {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+        float distance{};
+        bool isLoaded{};
+    };
+
+    class FakeWorld : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            static const std::uint32_t heel[] = {kHeelKeyword};
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.plugin = "Skyrim.esm";
+            a_out.localFormID = a_formID & 0xFFFFFF;
+            a_out.keywords = a_formID == kHighHeels || a_formID == kHeeledBoots ? std::span<const std::uint32_t>(heel)
+                                                                               : std::span<const std::uint32_t>{};
+            a_out.coversFeet = a_formID != kPantyhose;
+            a_out.coversCalves = a_formID == kPantyhose || a_formID == kHeeledBoots;
+            return a_formID != kNone;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            if (isRecording) {
+                checkOrder.push_back(a_formID);
+            }
+            const auto it = actors.find(a_formID);
+            return it != actors.end() && it->second.isLoaded ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            const auto* actor = static_cast<const Actor*>(a_actor.native);
+            return LookupArmor(a_slot == ArmorSlot::kFeet ? actor->feet : actor->calves, a_out);
+        }
+
+        std::unordered_map<std::uint32_t, Actor> actors;
+        std::vector<std::uint32_t> checkOrder;  // every LookupActor() while recording, in call order
+        bool isRecording{true};                 // off while committing, which looks actors up again
+    };
+
+    // Remembers which morphs every actor carries and counts ApplyBodyMorphs calls per frame.
+    class FakeSKEE : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, float) override {
+            if (std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0) {
+                morphs[a_actor.formID][a_morphName] = true;
+            }
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            if (std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0) {
+                morphs[a_actor.formID].erase(a_morphName);
+            }
+        }
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override {
+            const auto it = morphs.find(a_actor.formID);
+            return std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0 && it != morphs.end() && !it->second.empty();
+        }
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            const auto it = morphs.find(a_actor.formID);
+            return std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0 && it != morphs.end() &&
+                           it->second.contains(a_morphName)
+                       ? 1.0f
+                       : 0.0f;
+        }
+        void ApplyBodyMorphs(const ActorHandle&, bool) override {
+            ++frameUpdates;
+            ++totalUpdates;
+        }
+
+        std::unordered_map<std::uint32_t, std::unordered_map<std::string, bool>> morphs;
+        std::size_t frameUpdates{};
+        std::size_t totalUpdates{};
+    };
+
+    Actor RandomActor(std::mt19937& a_rng) {
+        static constexpr std::uint32_t kFeet[] = {kNone, kHighHeels, kLowHeels};
+        Actor actor;
+        if (a_rng() % 6 == 0) {
+            actor.feet = actor.calves = kHeeledBoots;
+        } else {
+            actor.feet = kFeet[a_rng() % 3];
+            actor.calves = a_rng() % 2 == 0 ? kPantyhose : kNone;
+        }
+        actor.distance = std::uniform_real_distribution<float>(0.0f, 8000.0f)(a_rng);
+        actor.isLoaded = true;
+        return actor;
+    }
+
+    bool IsNearestFirst(const FakeWorld& a_world, std::size_t a_begin, std::size_t a_end) {
+        for (std::size_t i = a_begin + 1; i < a_end; ++i) {
+            const float previous = a_world.actors.at(a_world.checkOrder[i - 1]).distance;
+            if (a_world.actors.at(a_world.checkOrder[i]).distance < previous) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--actors") == 0) {
+            options.actors = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--updates") == 0) {
+            options.budget.updates = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--checks") == 0) {
+            options.budget.checks = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: ActorSweepBench [--actors N] [--updates N] [--checks N] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    HighHeelClassifier classifier;
+    classifier.ParseJson({{"ByKeywords", {"SyntheticHeelKeyword"}}});
+    classifier.ResolveKeywords([](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    });
+    FakeWorld world;
+    FakeSKEE skee;
+    MorphApplier morphApplier(skee);
+    EquipPipeline pipeline(world, classifier, morphApplier);
+    ActorSweep sweep(world, pipeline, options.budget);
+
+    // The crowd as it was saved: two in five actors already carry morphs, half of those for clothes since changed.
+    std::mt19937 rng(options.seed);
+    std::vector<ActorSweep::Target> targets;
+    for (std::size_t i = 0; i < options.actors; ++i) {
+        const auto formID = static_cast<std::uint32_t>(kFirstActor + i);
+        Actor& actor = world.actors[formID] = RandomActor(rng);
+        if (rng() % 5 < 2) {
+            pipeline.Sync({formID, &actor});
+            world.isRecording = false;
+            morphApplier.Commit(world);
+            world.isRecording = true;
+            if (rng() % 2 == 0) {
+                const Actor changed = RandomActor(rng);
+                actor.feet = changed.feet;
+                actor.calves = changed.calves;
+            }
+        }
+        targets.push_back({formID, actor.distance});
+    }
+    const std::size_t savedUpdates = skee.totalUpdates;
+    world.checkOrder.clear();
+
+    bool isOk = sweep.Enqueue(targets);
+    std::size_t frame = 0;
+    std::size_t maxFrameUpdates = 0;
+    std::size_t maxFrameChecks = 0;
+    std::size_t attachCheck = 0;
+    std::size_t unloaded = 0;
+    std::size_t attached = 0;
+    for (bool isPending = true; isPending && frame < kMaxFrames;) {
+        ++frame;
+        if (frame == kUnloadFrame) {
+            // Walked out of the loaded area while queued.
+            for (auto& [formID, actor] : world.actors) {
+                if (rng() % 25 == 0) {
+                    actor.isLoaded = false;
+                    ++unloaded;
+                }
+            }
+        }
+        if (frame == kAttachFrame) {
+            attachCheck = world.checkOrder.size();
+            std::vector<ActorSweep::Target> arrivals;
+            for (std::size_t i = 0; i < options.actors / 10; ++i) {
+                const auto formID = static_cast<std::uint32_t>(kFirstActor + options.actors + i);
+                arrivals.push_back({formID, (world.actors[formID] = RandomActor(rng)).distance});
+            }
+            attached = arrivals.size();
+            // A frame is already scheduled, so nothing new has to be.
+            isOk &= !sweep.Enqueue(arrivals);
+        }
+
+        const std::size_t checksBefore = world.checkOrder.size();
+        skee.frameUpdates = 0;
+        isPending = sweep.RunFrame();
+        world.isRecording = false;
+        morphApplier.Commit(world);
+        world.isRecording = true;
+        maxFrameUpdates = std::max(maxFrameUpdates, skee.frameUpdates);
+        maxFrameChecks = std::max(maxFrameChecks, world.checkOrder.size() - checksBefore);
+    }
+    if (attachCheck == 0) {
+        attachCheck = world.checkOrder.size();
+    }
+
+    const bool isWithinBudget = maxFrameUpdates <= options.budget.updates && maxFrameChecks <= options.budget.checks;
+    const bool isOrdered =
+        IsNearestFirst(world, 0, attachCheck) && IsNearestFirst(world, attachCheck, world.checkOrder.size());
+
+    std::size_t wrong = 0;
+    for (const auto& [formID, actor] : world.actors) {
+        if (!actor.isLoaded) {
+            continue;
+        }
+        const auto state = pipeline.ResolveWornState({formID, const_cast<Actor*>(&actor)});
+        for (std::size_t m = 0; m < MorphStateMachine::kMorphCount; ++m) {
+            const auto morph = static_cast<MorphStateMachine::Morph>(m);
+            const auto& morphs = skee.morphs[formID];
+            const auto it = morphs.find(MorphStateMachine::GetMorphName(morph));
+            const bool isSet = it != morphs.end() && it->second;
+            if (isSet != MorphStateMachine::IsMorphSet(state, morph) || morphApplier.GetAppliedState(formID) != state) {
+                ++wrong;
+                break;
+            }
+        }
+    }
+
+    const auto stats = sweep.GetStats();
+    std::printf("%zu actor(s), %zu unloaded mid-sweep, %zu attached mid-sweep; budget %zu update(s) / %zu check(s)\n",
+                options.actors, unloaded, attached, options.budget.updates, options.budget.checks);
+    std::printf("morphs written before the sweep (saved game): %zu\n", savedUpdates);
+    std::printf("sweep: %zu frame(s), %zu check(s), %zu ApplyBodyMorphs call(s)\n", stats.frames, stats.checked,
+                stats.updated);
+    std::printf("worst frame: %zu ApplyBodyMorphs call(s), %zu check(s) -> %s\n", maxFrameUpdates, maxFrameChecks,
+                isWithinBudget ? "within budget" : "OVER BUDGET");
+    std::printf("check order: %s\n", isOrdered ? "nearest first" : "NOT NEAREST FIRST");
+    std::printf("%zu loaded actor(s) with wrong morphs\n", wrong);
+    isOk &= frame < kMaxFrames && isWithinBudget && isOrdered && wrong == 0 && sweep.GetPendingCount() == 0;
+    return isOk ? 0 : 1;
+}
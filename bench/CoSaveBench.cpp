@@ -0,0 +1,543 @@
+// Headless harness for the co-save record of applied morph states, against an in-memory stand-in for the SKSE
+// serialization interface.
+//
+// The first part round-trips MorphStateRecord through the stand-in: the same load order, a load order with plugins
+// moved and one removed, a save made under other rules, a record of a newer version, a truncated record and a record
+// with a bad state, with records of other kinds around it. Each case must come back with exactly the expected
+// entries and status.
+//
+// The second part is the reason for the record: a session of actors in one plugin plays for a while and saves, with
+// some morph writes still uncommitted, then the save is loaded the way the plugin does it, with and without the
+// record, under the same and under changed rules, and with the plugin moved in the load order. The harness fails
+// unless every load ends with every actor carrying the morphs of what it wears, and a load with a usable record
+// looks at no actor it restored.
+//
+//   CoSaveBench [--actors N] [--seed N]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ActorSweep.h"
+#include "EquipPipeline.h"
+#include "MorphApplier.h"
+#include "MorphStateRecord.h"
+
+namespace {
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kActorPlugin = 0x05;  // load order slot of the plugin defining the actors
+    constexpr std::uint32_t kOtherType = 0x4F544852;  // 'OTHR'
+    constexpr std::size_t kMaxFrames = 100000;
+    constexpr std::size_t kPlayRounds = 5;
+
+    struct Options {
+        std::size_t actors = 1000;
+        std::uint32_t seed = 1;
+    };
+
+    // SKSE's co-save in memory. ResolveFormID() follows a slot map the way SKSE follows the saved load order: regular
+    // slots map to regular slots, light plugins by their index under 0xFE, and 0xFF forms stay as they are.
+    class MemoryCoSave : public ICoSave {
+    public:
+        struct Record {
+            std::uint32_t type{};
+            std::uint32_t version{};
+            std::vector<std::uint8_t> data;
+        };
+
+        bool OpenRecord(std::uint32_t a_type, std::uint32_t a_version) override {
+            records.push_back({a_type, a_version, {}});
+            return true;
+        }
+        bool WriteRecordData(const void* a_data, std::uint32_t a_length) override {
+            if (records.empty()) {
+                return false;
+            }
+            const auto* bytes = static_cast<const std::uint8_t*>(a_data);
+            records.back().data.insert(records.back().data.end(), bytes, bytes + a_length);
+            return true;
+        }
+        bool GetNextRecordInfo(std::uint32_t& a_type, std::uint32_t& a_version, std::uint32_t& a_length) override {
+            if (m_next >= records.size()) {
+                return false;
+            }
+            m_current = &records[m_next++];
+            m_offset = 0;
+            a_type = m_current->type;
+            a_version = m_current->version;
+            a_length = static_cast<std::uint32_t>(m_current->data.size());
+            return true;
+        }
+        std::uint32_t ReadRecordData(void* a_data, std::uint32_t a_length) override {
+            if (!m_current) {
+                return 0;
+            }
+            const std::size_t length = std::min<std::size_t>(a_length, m_current->data.size() - m_offset);
+            std::memcpy(a_data, m_current->data.data() + m_offset, length);
+            m_offset += length;
+            return static_cast<std::uint32_t>(length);
+        }
+        bool ResolveFormID(std::uint32_t a_oldFormID, std::uint32_t& a_newFormID) override {
+            const std::uint32_t slot = a_oldFormID >> 24;
+            if (slot == 0xFF) {
+                a_newFormID = a_oldFormID;
+                return true;
+            }
+            const bool isLight = slot == 0xFE;
+            const std::uint32_t key = isLight ? 0xFE000 | ((a_oldFormID >> 12) & 0xFFF) : slot;
+            const auto it = slotMap.find(key);
+            const std::uint32_t mapped = it != slotMap.end() ? it->second : key;
+            if (mapped == kRemoved) {
+                return false;
+            }
+            a_newFormID = isLight ? (0xFE000000 | ((mapped & 0xFFF) << 12) | (a_oldFormID & 0xFFF))
+                                  : ((mapped << 24) | (a_oldFormID & 0xFFFFFF));
+            return true;
+        }
+
+        // Starts reading from the first record again.
+        void Rewind() {
+            m_next = 0;
+            m_current = nullptr;
+        }
+
+        static constexpr std::uint32_t kRemoved = 0xFFFFFFFF;
+
+        std::vector<Record> records;
+        // Regular slot -> regular slot, 0xFE000 | light index -> 0xFE000 | light index, or kRemoved.
+        std::unordered_map<std::uint32_t, std::uint32_t> slotMap;
+
+    private:
+        std::size_t m_next{};
+        Record* m_current{};
+        std::size_t m_offset{};
+    };
+
+    // What the plugin's load callback does: the first record of our type, others skipped.
+    MorphStateRecord::ReadResult ReadRecords(MemoryCoSave& a_coSave, std::uint64_t a_ruleHash,
+                                             std::vector<MorphStateRecord::Entry>& a_out) {
+        a_coSave.Rewind();
+        MorphStateRecord::ReadResult result{MorphStateRecord::Status::kCorrupt};
+        std::uint32_t type = 0;
+        std::uint32_t version = 0;
+        std::uint32_t length = 0;
+        while (a_coSave.GetNextRecordInfo(type, version, length)) {
+            if (type == MorphStateRecord::kType) {
+                result = MorphStateRecord::Read(a_coSave, version, length, a_ruleHash, a_out);
+            }
+        }
+        return result;
+    }
+
+    void WriteOther(MemoryCoSave& a_coSave) {
+        const char payload[] = "not ours";
+        a_coSave.OpenRecord(kOtherType, 3);
+        a_coSave.WriteRecordData(payload, sizeof(payload));
+    }
+
+    std::vector<MorphStateRecord::Entry> MakeEntries(std::mt19937& a_rng) {
+        std::vector<MorphStateRecord::Entry> entries;
+        const auto randomState = [&a_rng]() { return static_cast<MorphStateMachine::State>(1 + a_rng() % 6); };
+        for (std::uint32_t i = 0; i < 300; ++i) {
+            entries.push_back({0x00000800 + i, randomState()});               // Skyrim.esm
+            entries.push_back({(kActorPlugin << 24) | (0x1000 + i), randomState()});
+            entries.push_back({0x07000000 | (0x2000 + i), randomState()});     // removed below
+            entries.push_back({0xFE002000 | (0x800 + i), randomState()});      // light plugin 2
+            entries.push_back({0xFF000800 + i, randomState()});               // created at runtime
+        }
+        return entries;
+    }
+
+    bool CheckRecord(std::uint32_t a_seed) {
+        std::mt19937 rng(a_seed);
+        const auto entries = MakeEntries(rng);
+        constexpr std::uint64_t kRuleHash = 0x1234'5678'9ABC'DEF0ull;
+
+        struct Case {
+            const char* label;
+            bool isOk;
+        };
+        std::vector<Case> cases;
+
+        MemoryCoSave coSave;
+        WriteOther(coSave);
+        const bool isWritten = MorphStateRecord::Write(coSave, kRuleHash, entries);
+        WriteOther(coSave);
+        const std::size_t recordBytes = coSave.records[1].data.size();
+        std::vector<MorphStateRecord::Entry> read;
+
+        auto result = ReadRecords(coSave, kRuleHash, read);
+        cases.push_back({"same load order",
+                         isWritten && result.status == MorphStateRecord::Status::kLoaded && result.dropped == 0 &&
+                             read == entries});
+
+        // The actor plugin moves from 0x05 to 0x09, 0x07 is gone and light plugin 2 becomes light plugin 5.
+        coSave.slotMap = {{kActorPlugin, 0x09}, {0x07, MemoryCoSave::kRemoved}, {0xFE002, 0xFE005}};
+        std::vector<MorphStateRecord::Entry> expected;
+        std::size_t removed = 0;
+        for (auto entry : entries) {
+            std::uint32_t formID = 0;
+            if (!coSave.ResolveFormID(entry.formID, formID)) {
+                ++removed;
+                continue;
+            }
+            expected.push_back({formID, entry.state});
+        }
+        result = ReadRecords(coSave, kRuleHash, read);
+        cases.push_back({"remapped load order", result.status == MorphStateRecord::Status::kLoaded &&
+                                                    result.dropped == removed && removed == 300 && read == expected});
+        coSave.slotMap.clear();
+
+        read.clear();
+        result = ReadRecords(coSave, kRuleHash + 1, read);
+        cases.push_back({"other rules", result.status == MorphStateRecord::Status::kStale && read.empty()});
+
+        coSave.records[1].version = MorphStateRecord::kVersion + 1;
+        result = ReadRecords(coSave, kRuleHash, read);
+        cases.push_back({"newer version", result.status == MorphStateRecord::Status::kUnsupported && read.empty()});
+        coSave.records[1].version = MorphStateRecord::kVersion;
+
+        auto data = coSave.records[1].data;
+        coSave.records[1].data.resize(data.size() - 1);
+        result = ReadRecords(coSave, kRuleHash, read);
+        cases.push_back({"truncated", result.status == MorphStateRecord::Status::kCorrupt && read.empty()});
+
+        coSave.records[1].data = data;
+        coSave.records[1].data.back() = 0;  // kInvalid
+        result = ReadRecords(coSave, kRuleHash, read);
+        cases.push_back({"bad state", result.status == MorphStateRecord::Status::kCorrupt && read.empty()});
+
+        MemoryCoSave empty;
+        MorphStateRecord::Write(empty, kRuleHash, {});
+        result = ReadRecords(empty, kRuleHash, read);
+        cases.push_back({"no actors", result.status == MorphStateRecord::Status::kLoaded && read.empty()});
+
+        std::printf("record: %zu actor(s) in %zu byte(s), %.1f byte(s) per actor\n", entries.size(), recordBytes,
+                    static_cast<double>(recordBytes) / entries.size());
+        bool isOk = true;
+        for (const Case& c : cases) {
+            std::printf("  %-22s %s\n", c.label, c.isOk ? "ok" : "FAILED");
+            isOk &= c.isOk;
+        }
+        return isOk;
+    }
+
+    enum Armor : std::uint32_t {
+        kNone = 0,
+        kHighHeels = 0x00012E46,
+        kLowHeels = 0x00012E4B,
+        kPantyhose = 0x00013EE1,
+    };
+    constexpr std::uint32_t kFeet[] = {kNone, kHighHeels, kLowHeels};
+
+    struct Actor {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+    };
+
+    class FakeWorld : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            static const std::uint32_t heel[] = {kHeelKeyword};
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.plugin = "Skyrim.esm";
+            a_out.localFormID = a_formID & 0xFFFFFF;
+            a_out.keywords = a_formID == kHighHeels ? std::span<const std::uint32_t>(heel)
+                                                    : std::span<const std::uint32_t>{};
+            a_out.coversFeet = a_formID != kPantyhose;
+            a_out.coversCalves = a_formID == kPantyhose;
+            return a_formID != kNone;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            const auto it = actors.find(a_formID);
+            return it != actors.end() ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            ++wornLookups;
+            const auto* actor = static_cast<const Actor*>(a_actor.native);
+            return LookupArmor(a_slot == ArmorSlot::kFeet ? actor->feet : actor->calves, a_out);
+        }
+
+        std::unordered_map<std::uint32_t, Actor> actors;
+        std::size_t wornLookups{};
+    };
+
+    // actor -> morph name -> value, under MorphApplier::kMorphKey only.
+    using MorphStore = std::unordered_map<std::uint32_t, std::map<std::string, float>>;
+
+    class FakeSKEE : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char*, float a_value) override {
+            ++writes;
+            store[a_actor.formID][a_morphName] = a_value;
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char*) override {
+            ++writes;
+            if (const auto it = store.find(a_actor.formID); it != store.end()) {
+                it->second.erase(a_morphName);
+                if (it->second.empty()) {
+                    store.erase(it);
+                }
+            }
+        }
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override {
+            ++queries;
+            return std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0 && store.contains(a_actor.formID);
+        }
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char*) override {
+            ++queries;
+            return Find(a_actor.formID, a_morphName);
+        }
+        void ApplyBodyMorphs(const ActorHandle&, bool) override { ++applies; }
+
+        float Find(std::uint32_t a_formID, const char* a_morphName) const {
+            const auto actor = store.find(a_formID);
+            if (actor == store.end()) {
+                return 0.0f;
+            }
+            const auto morph = actor->second.find(a_morphName);
+            return morph != actor->second.end() ? morph->second : 0.0f;
+        }
+
+        MorphStore store;
+        std::size_t queries{};
+        std::size_t writes{};
+        std::size_t applies{};
+    };
+
+    struct Save {
+        std::unordered_map<std::uint32_t, Actor> worn;
+        MorphStore morphs;
+        MemoryCoSave coSave;
+    };
+
+    struct Session {
+        FakeWorld world;
+        FakeSKEE skee;
+        MorphApplier morphApplier{skee};
+        EquipPipeline pipeline;
+        ActorSweep sweep;
+
+        explicit Session(HighHeelClassifier& a_classifier)
+            : pipeline(world, a_classifier, morphApplier), sweep(world, pipeline) {}
+    };
+
+    bool IsCorrect(Session& a_session, std::uint32_t a_formID) {
+        auto& actor = a_session.world.actors.at(a_formID);
+        const auto state = a_session.pipeline.ResolveWornState({a_formID, &actor});
+        for (std::size_t m = 0; m < MorphStateMachine::kMorphCount; ++m) {
+            const auto morph = static_cast<MorphStateMachine::Morph>(m);
+            const bool isSet = a_session.skee.Find(a_formID, MorphStateMachine::GetMorphName(morph)) != 0.0f;
+            if (isSet != MorphStateMachine::IsMorphSet(state, morph)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Outfit changes through equip events and a flush per round; committed unless a_isCommitted is false.
+    void Play(Session& a_session, std::mt19937& a_rng, std::size_t a_rounds, bool a_isCommitted) {
+        for (std::size_t round = 0; round < a_rounds; ++round) {
+            for (auto& [formID, actor] : a_session.world.actors) {
+                if (a_rng() % 4 != 0) {
+                    continue;
+                }
+                if (a_rng() % 2 == 0) {
+                    const std::uint32_t feet = kFeet[a_rng() % 3];
+                    if (feet != actor.feet) {
+                        const std::uint32_t old = actor.feet;
+                        actor.feet = feet;
+                        if (old != kNone) {
+                            a_session.pipeline.OnEquipEvent({formID, old, false});
+                        }
+                        if (feet != kNone) {
+                            a_session.pipeline.OnEquipEvent({formID, feet, true});
+                        }
+                    }
+                } else {
+                    const bool isEquipped = actor.calves == kNone;
+                    actor.calves = isEquipped ? kPantyhose : kNone;
+                    a_session.pipeline.OnEquipEvent({formID, kPantyhose, isEquipped});
+                }
+            }
+            a_session.pipeline.Flush();
+            if (a_isCommitted) {
+                a_session.morphApplier.Commit(a_session.world);
+            }
+        }
+    }
+
+    // A session of its own that plays and saves the game while some morph writes are still waiting for the next
+    // commit: the co-save has their actors' new outfits, but SKEE's morphs from before.
+    Save MakeSave(HighHeelClassifier& a_classifier, const Options& a_options, std::size_t& a_pending) {
+        std::mt19937 rng(a_options.seed);
+        Session session(a_classifier);
+        for (std::size_t i = 0; i < a_options.actors; ++i) {
+            session.world.actors[(kActorPlugin << 24) | static_cast<std::uint32_t>(0x800 + i)] = {
+                kFeet[rng() % 3], rng() % 2 == 0 ? kPantyhose : kNone};
+        }
+        std::vector<ActorSweep::Target> targets;
+        for (const auto& [formID, actor] : session.world.actors) {
+            targets.push_back({formID, 0.0f});
+        }
+        session.sweep.Enqueue(targets);
+        while (session.sweep.RunFrame()) {
+            session.morphApplier.Commit(session.world);
+        }
+        session.morphApplier.Commit(session.world);
+        Play(session, rng, kPlayRounds, true);
+        Play(session, rng, 1, false);
+
+        Save save;
+        const auto states = session.morphApplier.GetCommittedStates();
+        a_pending = session.morphApplier.GetStateStats().size - states.size();
+        MorphStateRecord::Write(save.coSave, a_classifier.GetRuleHash(), states);
+        save.worn = session.world.actors;
+        save.morphs = session.skee.store;
+        return save;
+    }
+
+    // The same save after the actors' plugin moved to a_slot: the game and SKEE remap their FormIDs on load.
+    Save MoveActorPlugin(const Save& a_save, std::uint32_t a_slot) {
+        const auto move = [a_slot](std::uint32_t a_formID) { return (a_slot << 24) | (a_formID & 0xFFFFFF); };
+        Save moved;
+        moved.coSave = a_save.coSave;
+        moved.coSave.slotMap[kActorPlugin] = a_slot;
+        for (const auto& [formID, actor] : a_save.worn) {
+            moved.worn[move(formID)] = actor;
+        }
+        for (const auto& [formID, morphs] : a_save.morphs) {
+            moved.morphs[move(formID)] = morphs;
+        }
+        return moved;
+    }
+
+    struct LoadResult {
+        MorphStateRecord::Status status{};
+        std::size_t restored{};
+        std::size_t swept{};
+        std::size_t wornLookups{};
+        std::size_t queries{};
+        std::size_t writes{};
+        std::size_t applies{};
+        std::size_t wrong{};
+    };
+
+    // What the plugin does on kPreLoadGame, in its co-save load callback and on kPostLoadGame.
+    LoadResult Load(HighHeelClassifier& a_classifier, Save& a_save, bool a_isRecordUsed, std::uint64_t a_ruleHash) {
+        Session session(a_classifier);
+        session.world.actors = a_save.worn;
+        session.skee.store = a_save.morphs;
+
+        LoadResult result{MorphStateRecord::Status::kStale};
+        if (a_isRecordUsed) {
+            std::vector<MorphStateRecord::Entry> states;
+            const auto read = ReadRecords(a_save.coSave, a_ruleHash, states);
+            result.status = read.status;
+            if (read.status == MorphStateRecord::Status::kLoaded) {
+                session.morphApplier.RestoreAppliedStates(states);
+                result.restored = states.size();
+            }
+        }
+
+        std::vector<ActorSweep::Target> targets;
+        float distance = 0.0f;
+        for (const auto& [formID, actor] : session.world.actors) {
+            if (session.morphApplier.GetAppliedState(formID) == MorphStateMachine::State::kInvalid) {
+                targets.push_back({formID, distance += 1.0f});
+            }
+        }
+        result.swept = targets.size();
+        session.sweep.Enqueue(targets);
+        std::size_t frames = 0;
+        for (bool isPending = true; isPending && frames < kMaxFrames; ++frames) {
+            isPending = session.sweep.RunFrame();
+            session.morphApplier.Commit(session.world);
+        }
+
+        result.wornLookups = session.world.wornLookups;
+        result.queries = session.skee.queries;
+        result.writes = session.skee.writes;
+        result.applies = session.skee.applies;
+        for (const auto& [formID, actor] : session.world.actors) {
+            result.wrong += IsCorrect(session, formID) ? 0 : 1;
+        }
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--actors") == 0) {
+            options.actors = std::clamp<std::size_t>(std::strtoull(argv[i + 1], nullptr, 10), 1, 0x7FFFF);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: CoSaveBench [--actors N] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    bool isOk = CheckRecord(options.seed);
+
+    HighHeelClassifier classifier;
+    classifier.ParseJson({{"ByKeywords", {"SyntheticHeelKeyword"}}});
+    classifier.ResolveKeywords([](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    });
+    const std::uint64_t ruleHash = classifier.GetRuleHash();
+
+    std::size_t pending = 0;
+    Save save = MakeSave(classifier, options, pending);
+    Save moved = MoveActorPlugin(save, 0x09);
+
+    struct Step {
+        const char* label;
+        Save* save;
+        bool isRecordUsed;
+        std::uint64_t ruleHash;
+    };
+    const Step steps[] = {
+        {"no record", &save, false, ruleHash},
+        {"record", &save, true, ruleHash},
+        {"other rules", &save, true, ruleHash + 1},
+        {"plugin moved", &moved, true, ruleHash},
+    };
+
+    std::printf("\n%zu actor(s) saved, %zu of them with morph writes still pending\n", options.actors, pending);
+    std::printf("%-14s %8s %8s %8s %8s %8s %8s %8s\n", "load", "restored", "swept", "worn", "queries", "writes",
+                "applies", "wrong");
+    LoadResult baseline;
+    for (const Step& step : steps) {
+        const LoadResult result = Load(classifier, *step.save, step.isRecordUsed, step.ruleHash);
+        std::printf("%-14s %8zu %8zu %8zu %8zu %8zu %8zu %8zu\n", step.label, result.restored, result.swept,
+                    result.wornLookups, result.queries, result.writes, result.applies, result.wrong);
+        if (!step.isRecordUsed) {
+            baseline = result;
+        }
+        isOk &= result.wrong == 0;
+        // A usable record restores every committed actor and leaves only the pending ones to the sweep.
+        if (step.isRecordUsed && step.ruleHash == ruleHash) {
+            isOk &= result.status == MorphStateRecord::Status::kLoaded && result.restored == options.actors - pending &&
+                    result.swept == pending && result.applies <= pending;
+        } else if (step.isRecordUsed) {
+            isOk &= result.status == MorphStateRecord::Status::kStale && result.swept == options.actors &&
+                    result.applies == baseline.applies;
+        }
+    }
+    std::printf("%s\n", isOk ? "ok" : "FAILED");
+    return isOk ? 0 : 1;
+}
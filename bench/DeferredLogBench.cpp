@@ -0,0 +1,109 @@
+// Host-side benchmark for DeferredLog.
+//
+// Logs the same equip-event line the way the plugin's hot path would, in bursts separated by idle time, and times
+// every call on the logging thread. Compared modes:
+//
+//   spdlog, flush_on(trace)   what debug builds used to do: format and write every line synchronously
+//   spdlog, flush_on(warn)    formatted synchronously, flushed by spdlog's buffering
+//   DeferredLog               binary record into the thread's ring, formatted and written by the background thread
+//   DeferredLog, disabled     a trace site when the logger level is info
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <vector>
+
+#include "DeferredLog.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kBurstCount = 500;
+    constexpr int kLinesPerBurst = 200;
+
+    struct Result {
+        double meanNs;
+        double p99Ns;
+        double maxNs;
+    };
+
+    void UseLogger(const std::filesystem::path& a_path, spdlog::level::level_enum a_level,
+                   spdlog::level::level_enum a_flushLevel) {
+        auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(a_path.string(), true);
+        auto logger = std::make_shared<spdlog::logger>("log", std::move(sink));
+        logger->set_level(a_level);
+        logger->flush_on(a_flushLevel);
+        spdlog::set_default_logger(std::move(logger));
+    }
+
+    template <class TFunc>
+    Result Measure(TFunc&& a_logLine) {
+        std::vector<double> samples;
+        samples.reserve(kBurstCount * kLinesPerBurst);
+        const char* names[] = {"Lydia", "Aela the Huntress", "unnamed", "Serana"};
+
+        for (int burst = 0; burst < kBurstCount; ++burst) {
+            for (int i = 0; i < kLinesPerBurst; ++i) {
+                const auto start = Clock::now();
+                a_logLine(names[i % 4], 0x0A000800u + static_cast<unsigned>(i), (i & 1) != 0);
+                samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+            // Give the writer thread the gap between bursts that a frame would.
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        double total = 0;
+        for (const double sample : samples) {
+            total += sample;
+        }
+        std::ranges::sort(samples);
+        return {total / samples.size(), samples[samples.size() * 99 / 100], samples.back()};
+    }
+
+    void Print(const char* a_mode, const Result& a_result) {
+        std::printf("%-28s %10.1f %10.1f %12.1f\n", a_mode, a_result.meanNs, a_result.p99Ns, a_result.maxNs);
+    }
+}
+
+int main() {
+    const auto dir = std::filesystem::temp_directory_path() / "DeferredLogBench";
+    std::filesystem::create_directories(dir);
+
+    std::printf("%d bursts of %d lines\n", kBurstCount, kLinesPerBurst);
+    std::printf("%-28s %10s %10s %12s\n", "mode", "mean ns", "p99 ns", "max ns");
+
+    UseLogger(dir / "spdlog-flush-trace.log", spdlog::level::trace, spdlog::level::trace);
+    Print("spdlog, flush_on(trace)", Measure([](const char* a_name, unsigned a_formID, bool a_isEquipped) {
+              spdlog::trace("Processing equip event: actor={}, baseObject={:#x}, equipped={}", a_name, a_formID,
+                            a_isEquipped);
+          }));
+
+    UseLogger(dir / "spdlog-flush-warn.log", spdlog::level::trace, spdlog::level::warn);
+    Print("spdlog, flush_on(warn)", Measure([](const char* a_name, unsigned a_formID, bool a_isEquipped) {
+              spdlog::trace("Processing equip event: actor={}, baseObject={:#x}, equipped={}", a_name, a_formID,
+                            a_isEquipped);
+          }));
+
+    UseLogger(dir / "deferred.log", spdlog::level::trace, spdlog::level::trace);
+    DeferredLog::Start();
+    Print("DeferredLog", Measure([](const char* a_name, unsigned a_formID, bool a_isEquipped) {
+              AP_LOG_TRACE("Processing equip event: actor={}, baseObject={:#x}, equipped={}", a_name, a_formID,
+                           a_isEquipped);
+          }));
+    DeferredLog::Stop();
+
+    UseLogger(dir / "deferred-disabled.log", spdlog::level::info, spdlog::level::warn);
+    Print("DeferredLog, disabled", Measure([](const char* a_name, unsigned a_formID, bool a_isEquipped) {
+              AP_LOG_TRACE("Processing equip event: actor={}, baseObject={:#x}, equipped={}", a_name, a_formID,
+                           a_isEquipped);
+          }));
+
+    const auto stats = DeferredLog::GetStats();
+    std::printf("DeferredLog wrote %llu line(s), dropped %llu\n", static_cast<unsigned long long>(stats.written),
+                static_cast<unsigned long long>(stats.dropped));
+    spdlog::shutdown();
+    return 0;
+}
@@ -0,0 +1,244 @@
+// Host-side benchmark for the equip event prefilter.
+//
+// Synthesizes a load order of regular and light plugins, most of whose records are weapons, spells, ammo and body
+// armor, with footwear and legwear in between, and a stream of equip events drawn the way a fight or a crafting
+// session produces them: mostly weapons and spells, some body armor, a tenth footwear, and now and then a player
+// enchanted item, which is a dynamic form. The events go through two EquipPipelines, one given the footwear with
+// SetFootwear() and one without. A fake armor lookup stands in for TESForm::LookupByID: a hash map read under a
+// shared lock, as the engine does it.
+//
+// Reports the reject rate, the armor lookups saved and the cost per event with and without the prefilter. Both
+// pipelines must return the same for every event, and the prefilter must pass exactly the footwear and the dynamic
+// forms of the load order.
+//
+//   EquipPrefilterBench [--plugins N] [--light-share PERCENT] [--forms-per-plugin N] [--events N] [--seed N]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <shared_mutex>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+#include <vector>
+
+#include "EquipPipeline.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t kRegularSlots = 0xFE;
+    constexpr std::size_t kLightSlots = 0x1000;
+    constexpr std::uint32_t kActorCount = 200;
+
+    struct Options {
+        std::size_t plugins = 2000;
+        std::size_t lightShare = 80;  // percent
+        std::size_t formsPerPlugin = 200;
+        std::size_t events = 1 << 21;
+        std::uint32_t seed = 1;
+    };
+
+    enum class Kind : std::uint8_t { kWeapon, kSpell, kAmmo, kBodyArmor, kFeet, kCalves, kFeetAndCalves };
+
+    struct Form {
+        Kind kind{};
+        std::uint32_t localFormID{};
+    };
+
+    struct LoadOrder {
+        std::unordered_map<std::uint32_t, Form> forms;
+        std::vector<std::uint32_t> footwear;  // feet, calves or both
+        std::vector<std::uint32_t> other;     // everything else
+        std::vector<std::uint32_t> dynamic;   // enchanted copies of footwear, 0xFF
+    };
+
+    bool IsFootwear(Kind a_kind) { return a_kind >= Kind::kFeet; }
+
+    LoadOrder Synthesize(const Options& a_options, std::mt19937& a_rng) {
+        LoadOrder loadOrder;
+        const std::size_t regularShare = a_options.plugins * (100 - a_options.lightShare) / 100;
+        const std::size_t regularCount = std::min(regularShare, kRegularSlots);
+        const std::size_t lightCount = std::min(a_options.plugins - regularCount, kLightSlots);
+        const auto addPlugin = [&](std::uint32_t a_prefix, std::uint32_t a_localMax) {
+            // Records of a mod are added in runs, so its footwear is clustered among everything else.
+            std::uint32_t cursor = 0x800 + a_rng() % 0x100;
+            for (std::size_t i = 0; i < a_options.formsPerPlugin && cursor <= a_localMax; ++i) {
+                const std::uint32_t roll = a_rng() % 100;
+                const Kind kind = roll < 30   ? Kind::kWeapon
+                                  : roll < 50 ? Kind::kSpell
+                                  : roll < 60 ? Kind::kAmmo
+                                  : roll < 88 ? Kind::kBodyArmor
+                                  : roll < 94 ? Kind::kFeet
+                                  : roll < 97 ? Kind::kCalves
+                                              : Kind::kFeetAndCalves;
+                const std::uint32_t formID = a_prefix | cursor;
+                loadOrder.forms.emplace(formID, Form{kind, cursor});
+                (IsFootwear(kind) ? loadOrder.footwear : loadOrder.other).push_back(formID);
+                cursor += 1 + a_rng() % 3;
+            }
+        };
+        for (std::size_t i = 0; i < regularCount; ++i) {
+            addPlugin(static_cast<std::uint32_t>(i) << 24, 0xFFFFFF);
+        }
+        for (std::size_t i = 0; i < lightCount; ++i) {
+            addPlugin(0xFE000000 | static_cast<std::uint32_t>(i) << 12, 0xFFF);
+        }
+        for (std::uint32_t i = 0; i < 64; ++i) {
+            const std::uint32_t formID = 0xFF000800 + i;
+            loadOrder.forms.emplace(formID, Form{Kind::kFeet, formID & 0xFFFFFF});
+            loadOrder.dynamic.push_back(formID);
+        }
+        return loadOrder;
+    }
+
+    // The engine's form map: a hash map read under a shared lock.
+    class FakeArmorLookup : public IArmorLookup {
+    public:
+        explicit FakeArmorLookup(const LoadOrder& a_loadOrder) : m_loadOrder(a_loadOrder) {}
+
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            ++lookups;
+            std::shared_lock lock(m_lock);
+            const auto it = m_loadOrder.forms.find(a_formID);
+            if (it == m_loadOrder.forms.end() || it->second.kind < Kind::kBodyArmor) {
+                return false;
+            }
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.localFormID = it->second.localFormID;
+            a_out.coversFeet = it->second.kind == Kind::kFeet || it->second.kind == Kind::kFeetAndCalves;
+            a_out.coversCalves = it->second.kind == Kind::kCalves || it->second.kind == Kind::kFeetAndCalves;
+            a_out.isDynamic = (a_formID >> 24) == 0xFF;
+            return true;
+        }
+        ActorHandle LookupActor(std::uint32_t) override { return {}; }
+        bool GetWornArmor(const ActorHandle&, ArmorSlot, ArmorInfo&) override { return false; }
+
+        std::uint64_t lookups{};
+
+    private:
+        const LoadOrder& m_loadOrder;
+        std::shared_mutex m_lock;
+    };
+
+    class NullSKEE : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle&, const char*, const char*, float) override {}
+        void ClearMorph(const ActorHandle&, const char*, const char*) override {}
+        bool HasBodyMorphKey(const ActorHandle&, const char*) override { return false; }
+        float GetMorph(const ActorHandle&, const char*, const char*) override { return 0.0f; }
+        void ApplyBodyMorphs(const ActorHandle&, bool) override {}
+    };
+
+    struct Run {
+        std::vector<std::uint8_t> results;
+        std::uint64_t lookups{};
+        double nsPerEvent{};
+    };
+
+    Run Replay(const LoadOrder& a_loadOrder, const std::vector<EquipEvent>& a_events, bool a_isPrefiltered) {
+        HighHeelClassifier classifier;
+        classifier.ParseJson(nlohmann::json::object());
+        FakeArmorLookup armorLookup(a_loadOrder);
+        NullSKEE skee;
+        MorphApplier morphApplier(skee);
+        EquipPipeline pipeline(armorLookup, classifier, morphApplier);
+        if (a_isPrefiltered) {
+            pipeline.SetFootwear(a_loadOrder.footwear);
+        }
+
+        Run run;
+        run.results.resize(a_events.size());
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < a_events.size(); ++i) {
+            run.results[i] = pipeline.OnEquipEvent(a_events[i]);
+        }
+        run.nsPerEvent = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / a_events.size();
+        run.lookups = armorLookup.lookups;
+        return run;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--plugins") == 0) {
+            options.plugins = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--light-share") == 0) {
+            options.lightShare = std::min<std::size_t>(100, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--forms-per-plugin") == 0) {
+            options.formsPerPlugin = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--events") == 0) {
+            options.events = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: EquipPrefilterBench [--plugins N] [--light-share PERCENT] "
+                                 "[--forms-per-plugin N] [--events N] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    std::mt19937 rng(options.seed);
+    const LoadOrder loadOrder = Synthesize(options, rng);
+    if (loadOrder.footwear.empty() || loadOrder.other.empty()) {
+        std::fprintf(stderr, "load order too small\n");
+        return 2;
+    }
+
+    std::vector<EquipEvent> events(options.events);
+    std::size_t footwearEvents = 0;
+    for (auto& event : events) {
+        const std::uint32_t roll = rng() % 1000;
+        const auto& pool = roll < 895 ? loadOrder.other : roll < 995 ? loadOrder.footwear : loadOrder.dynamic;
+        event = {0x14 + static_cast<std::uint32_t>(rng() % kActorCount), pool[rng() % pool.size()], rng() % 2 == 0};
+        footwearEvents += roll >= 895;
+    }
+
+    const Run baseline = Replay(loadOrder, events, false);
+    const Run prefiltered = Replay(loadOrder, events, true);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        mismatches += baseline.results[i] != prefiltered.results[i];
+    }
+
+    // Every form of the load order passes exactly when it is footwear or dynamic; FormIDs of slots and records
+    // nobody defines never pass.
+    HighHeelClassifier classifier;
+    NullSKEE skee;
+    MorphApplier morphApplier(skee);
+    FakeArmorLookup armorLookup(loadOrder);
+    EquipPipeline pipeline(armorLookup, classifier, morphApplier);
+    pipeline.SetFootwear(loadOrder.footwear);
+    std::size_t wrongPasses = 0;
+    for (const auto& [formID, form] : loadOrder.forms) {
+        const bool isExpected = IsFootwear(form.kind) || (formID >> 24) == 0xFF;
+        wrongPasses += pipeline.IsFootwearCandidate(formID) != isExpected;
+    }
+    for (const std::uint32_t formID : {0xFD000800u, 0xFEFFF800u, 0x00000001u}) {
+        wrongPasses += !loadOrder.forms.contains(formID) && pipeline.IsFootwearCandidate(formID);
+    }
+
+    std::uint64_t passed = 0;
+    const auto start = Clock::now();
+    for (const auto& event : events) {
+        passed += pipeline.IsFootwearCandidate(event.baseFormID);
+    }
+    const double checkNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / events.size();
+
+    std::printf("%zu form(s), %zu footwear, %zu event(s), %zu of them footwear\n", loadOrder.forms.size(),
+                loadOrder.footwear.size(), events.size(), footwearEvents);
+    std::printf("prefilter  %.1f KiB, %.1f ns per check, %.1f%% of events rejected\n",
+                pipeline.GetFootwearMemoryUsage() / 1024.0, checkNs, 100.0 * (events.size() - passed) / events.size());
+    std::printf("%-14s %14s %14s\n", "pipeline", "ns / event", "lookups");
+    std::printf("%-14s %14.1f %14llu\n", "unfiltered", baseline.nsPerEvent,
+                static_cast<unsigned long long>(baseline.lookups));
+    std::printf("%-14s %14.1f %14llu\n", "prefiltered", prefiltered.nsPerEvent,
+                static_cast<unsigned long long>(prefiltered.lookups));
+    std::printf("%zu differing result(s), %zu wrong prefilter verdict(s)\n", mismatches, wrongPasses);
+    return mismatches == 0 && wrongPasses == 0 ? 0 : 1;
+}
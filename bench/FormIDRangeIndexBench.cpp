@@ -0,0 +1,118 @@
+// Host-side microbenchmark for FormIDRangeIndex.
+//
+// Builds synthetic rule sets of increasing size and compares the compiled index against the linear
+// string-compare scan HighHeelDetector::IsHighHeel used before. The index should stay flat as the rule
+// count grows while the linear scan grows with it.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Core/FormIDRangeIndex.h"
+
+namespace {
+    struct LinearRule {
+        std::string plugin;
+        std::uint32_t min;
+        std::uint32_t max;
+    };
+
+    struct Query {
+        const std::string* plugin;
+        std::uint32_t localFormID;
+    };
+
+    constexpr std::size_t kQueryCount = 1 << 18;
+    // The linear scan is quadratic overall, so it only gets as many queries as keep it under ~2^26 rule visits.
+    constexpr std::size_t kLinearBudget = 1 << 26;
+
+    template <class TFunc>
+    double MeasureNsPerLookup(const std::vector<Query>& a_queries, std::size_t a_count, TFunc&& a_func,
+                              std::size_t& a_hits) {
+        a_hits = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < a_count; ++i) {
+            a_hits += a_func(a_queries[i]) ? 1 : 0;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / a_count;
+    }
+}
+
+int main() {
+    std::mt19937 rng(20240613);
+
+    std::printf("%10s %8s %10s %14s %14s\n", "rules", "plugins", "merged", "index ns/op", "linear ns/op");
+
+    for (const std::size_t ruleCount : {10u, 100u, 1000u, 10000u, 100000u}) {
+        // Dozens of packs in a typical merged file, more when the file is huge.
+        const std::size_t pluginCount = std::min<std::size_t>(ruleCount, 50 + ruleCount / 1000);
+
+        std::vector<std::string> plugins;
+        for (std::size_t i = 0; i < pluginCount; ++i) {
+            plugins.push_back("[Synthetic] Cosplay Pack " + std::to_string(i) + ".esp");
+        }
+
+        std::uniform_int_distribution<std::uint32_t> pluginDist(0, static_cast<std::uint32_t>(pluginCount - 1));
+        std::uniform_int_distribution<std::uint32_t> idDist(0x800, 0xFFFFFF);
+        std::uniform_int_distribution<std::uint32_t> widthDist(0, 16);
+
+        std::vector<LinearRule> linearRules;
+        FormIDRangeIndex index;
+        for (std::size_t i = 0; i < ruleCount; ++i) {
+            const auto& plugin = plugins[pluginDist(rng)];
+            const std::uint32_t min = idDist(rng);
+            const std::uint32_t max = min + widthDist(rng);
+            linearRules.push_back({plugin, min, max});
+            index.Add(plugin, min, max);
+        }
+        index.Build();
+
+        // Half the queries hit a known rule, the rest are random FormIDs from random plugins.
+        std::vector<Query> queries;
+        std::uniform_int_distribution<std::size_t> ruleDist(0, ruleCount - 1);
+        for (std::size_t i = 0; i < kQueryCount; ++i) {
+            if (i % 2 == 0) {
+                const auto& rule = linearRules[ruleDist(rng)];
+                queries.push_back({&rule.plugin, rule.min});
+            } else {
+                queries.push_back({&plugins[pluginDist(rng)], idDist(rng)});
+            }
+        }
+
+        const auto indexLookup = [&](const Query& a_query) {
+            return index.Find(*a_query.plugin, a_query.localFormID).has_value();
+        };
+        std::size_t indexHits = 0;
+        const double indexNs = MeasureNsPerLookup(queries, queries.size(), indexLookup, indexHits);
+
+        const std::size_t linearCount = std::clamp<std::size_t>(kLinearBudget / ruleCount, 64, queries.size());
+        std::size_t linearHits = 0;
+        const double linearNs = MeasureNsPerLookup(
+            queries, linearCount,
+            [&](const Query& a_query) {
+                for (const auto& rule : linearRules) {
+                    if (*a_query.plugin == rule.plugin && a_query.localFormID >= rule.min &&
+                        a_query.localFormID <= rule.max) {
+                        return true;
+                    }
+                }
+                return false;
+            },
+            linearHits);
+
+        MeasureNsPerLookup(queries, linearCount, indexLookup, indexHits);
+        if (indexHits != linearHits) {
+            std::fprintf(stderr, "Verdict mismatch at %zu rules: index=%zu linear=%zu\n", ruleCount, indexHits,
+                         linearHits);
+            return 1;
+        }
+
+        std::printf("%10zu %8zu %10zu %14.1f %14.1f\n", ruleCount, pluginCount, index.GetRangeCount(), indexNs,
+                    linearNs);
+    }
+    return 0;
+}
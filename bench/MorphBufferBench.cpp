@@ -0,0 +1,282 @@
+// Headless harness for the morph command buffer, against a fake SKEE that counts every call.
+//
+// A crowd of synthetic actors wearing some mix of high heels, low heels and pantyhose goes through a game load, where
+// every actor is synced once, and then through a number of ticks of mass outfit changes. Every tick is several
+// rounds of equip events, each round flushed through the pipeline the way the plugin flushes a burst; an actor
+// often takes off in a later round what it put on in an earlier one. The same events are replayed twice:
+//
+//   immediate   MorphApplier::Commit() after every flush
+//   buffered    MorphApplier::Commit() once per tick, as the plugin does
+//
+// The harness fails unless both end every tick with exactly the morphs of what each actor wears, the buffered run
+// never applies an actor's morphs more than once per tick, and it makes no more backend calls than the immediate one.
+//
+//   MorphBufferBench [--actors N] [--ticks N] [--rounds N] [--seed N]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EquipPipeline.h"
+#include "MorphApplier.h"
+
+namespace {
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kFirstActor = 0xFF000800;
+
+    struct Options {
+        std::size_t actors = 2000;
+        std::size_t ticks = 20;
+        std::size_t rounds = 3;
+        std::uint32_t seed = 1;
+    };
+
+    enum Armor : std::uint32_t {
+        kNone = 0,
+        kHighHeels = 0x00012E46,
+        kLowHeels = 0x00012E4B,
+        kPantyhose = 0x00013EE1,
+    };
+
+    struct Actor {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+    };
+
+    class FakeWorld : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            static const std::uint32_t heel[] = {kHeelKeyword};
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.plugin = "Skyrim.esm";
+            a_out.localFormID = a_formID & 0xFFFFFF;
+            a_out.keywords = a_formID == kHighHeels ? std::span<const std::uint32_t>(heel)
+                                                    : std::span<const std::uint32_t>{};
+            a_out.coversFeet = a_formID != kPantyhose;
+            a_out.coversCalves = a_formID == kPantyhose;
+            return a_formID != kNone;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            const auto it = actors.find(a_formID);
+            return it != actors.end() ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            const auto* actor = static_cast<const Actor*>(a_actor.native);
+            return LookupArmor(a_slot == ArmorSlot::kFeet ? actor->feet : actor->calves, a_out);
+        }
+
+        std::unordered_map<std::uint32_t, Actor> actors;
+    };
+
+    // Counts every call, remembers which morphs every actor carries, and how often each actor was applied this tick.
+    class FakeSKEE : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, float) override {
+            ++setMorphCalls;
+            if (std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0) {
+                morphs[a_actor.formID][a_morphName] = true;
+            }
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++clearMorphCalls;
+            if (std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0) {
+                morphs[a_actor.formID].erase(a_morphName);
+            }
+        }
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override {
+            const auto it = morphs.find(a_actor.formID);
+            return std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0 && it != morphs.end() && !it->second.empty();
+        }
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            const auto it = morphs.find(a_actor.formID);
+            return std::strcmp(a_morphKey, MorphApplier::kMorphKey) == 0 && it != morphs.end() &&
+                           it->second.contains(a_morphName)
+                       ? 1.0f
+                       : 0.0f;
+        }
+        void ApplyBodyMorphs(const ActorHandle& a_actor, bool a_deferUpdate) override {
+            ++applyBodyMorphsCalls;
+            deferredApplies += a_deferUpdate ? 1 : 0;
+            maxTickApplies = std::max(maxTickApplies, ++tickApplies[a_actor.formID]);
+        }
+
+        std::size_t GetTotalCalls() const { return setMorphCalls + clearMorphCalls + applyBodyMorphsCalls; }
+
+        std::unordered_map<std::uint32_t, std::unordered_map<std::string, bool>> morphs;
+        std::unordered_map<std::uint32_t, std::size_t> tickApplies;
+        std::size_t maxTickApplies{};
+        std::size_t setMorphCalls{};
+        std::size_t clearMorphCalls{};
+        std::size_t applyBodyMorphsCalls{};
+        std::size_t deferredApplies{};
+    };
+
+    struct Result {
+        std::size_t loadApplies{};  // ApplyBodyMorphs calls of the game load tick
+        std::size_t setMorphCalls{};
+        std::size_t clearMorphCalls{};
+        std::size_t applyBodyMorphsCalls{};
+        std::size_t totalCalls{};
+        std::size_t maxTickApplies{};
+        std::size_t wrong{};  // actor-ticks that ended with the wrong morphs
+        bool isDeferred{};
+    };
+
+    std::size_t CountWrong(FakeWorld& a_world, FakeSKEE& a_skee, EquipPipeline& a_pipeline,
+                           MorphApplier& a_morphApplier) {
+        std::size_t wrong = 0;
+        for (auto& [formID, actor] : a_world.actors) {
+            const auto state = a_pipeline.ResolveWornState({formID, &actor});
+            const auto& morphs = a_skee.morphs[formID];
+            for (std::size_t m = 0; m < MorphStateMachine::kMorphCount; ++m) {
+                const auto morph = static_cast<MorphStateMachine::Morph>(m);
+                const auto it = morphs.find(MorphStateMachine::GetMorphName(morph));
+                const bool isSet = it != morphs.end() && it->second;
+                if (isSet != MorphStateMachine::IsMorphSet(state, morph) ||
+                    a_morphApplier.GetAppliedState(formID) != state) {
+                    ++wrong;
+                    break;
+                }
+            }
+        }
+        return wrong;
+    }
+
+    // One round of events for one actor: new shoes, pantyhose on or off, or both. Changes what the actor wears
+    // before the events are seen, as the game does.
+    void ChangeOutfit(std::uint32_t a_formID, Actor& a_actor, EquipPipeline& a_pipeline, std::mt19937& a_rng) {
+        static constexpr std::uint32_t kFeet[] = {kNone, kHighHeels, kLowHeels};
+        const std::uint32_t action = a_rng() % 3;
+        if (action != 1) {
+            const std::uint32_t feet = kFeet[a_rng() % 3];
+            if (feet != a_actor.feet) {
+                const std::uint32_t old = a_actor.feet;
+                a_actor.feet = feet;
+                if (old != kNone) {
+                    a_pipeline.OnEquipEvent({a_formID, old, false});
+                }
+                if (feet != kNone) {
+                    a_pipeline.OnEquipEvent({a_formID, feet, true});
+                }
+            }
+        }
+        if (action != 0) {
+            const bool isEquipped = a_actor.calves == kNone;
+            a_actor.calves = isEquipped ? kPantyhose : kNone;
+            a_pipeline.OnEquipEvent({a_formID, kPantyhose, isEquipped});
+        }
+    }
+
+    Result Run(const Options& a_options, const HighHeelClassifier& a_classifier, bool a_isBuffered) {
+        FakeWorld world;
+        FakeSKEE skee;
+        MorphApplier morphApplier(skee);
+        EquipPipeline pipeline(world, a_classifier, morphApplier);
+        std::mt19937 rng(a_options.seed);
+
+        Result result;
+        const auto endTick = [&] {
+            morphApplier.Commit(world);
+            result.wrong += CountWrong(world, skee, pipeline, morphApplier);
+            skee.tickApplies.clear();
+        };
+
+        // Game load: every actor is synced once, for the first time.
+        static constexpr std::uint32_t kFeet[] = {kNone, kHighHeels, kLowHeels};
+        for (std::size_t i = 0; i < a_options.actors; ++i) {
+            const auto formID = static_cast<std::uint32_t>(kFirstActor + i);
+            Actor& actor = world.actors[formID];
+            actor.feet = kFeet[rng() % 3];
+            actor.calves = rng() % 2 == 0 ? kPantyhose : kNone;
+            pipeline.Sync({formID, &actor});
+        }
+        endTick();
+        result.loadApplies = skee.applyBodyMorphsCalls;
+
+        // Mass outfit changes: in every round, about two actors in three change something.
+        for (std::size_t tick = 0; tick < a_options.ticks; ++tick) {
+            for (std::size_t round = 0; round < a_options.rounds; ++round) {
+                for (auto& [formID, actor] : world.actors) {
+                    if (rng() % 3 != 0) {
+                        ChangeOutfit(formID, actor, pipeline, rng);
+                    }
+                }
+                pipeline.Flush();
+                if (!a_isBuffered) {
+                    morphApplier.Commit(world);
+                }
+            }
+            endTick();
+        }
+
+        result.setMorphCalls = skee.setMorphCalls;
+        result.clearMorphCalls = skee.clearMorphCalls;
+        result.applyBodyMorphsCalls = skee.applyBodyMorphsCalls;
+        result.totalCalls = skee.GetTotalCalls();
+        result.maxTickApplies = skee.maxTickApplies;
+        result.isDeferred = skee.deferredApplies == skee.applyBodyMorphsCalls;
+        return result;
+    }
+
+    void Print(const char* a_label, const Result& a_result) {
+        std::printf("%-10s %10zu %10zu %12zu %10zu %14zu %8zu\n", a_label, a_result.setMorphCalls,
+                    a_result.clearMorphCalls, a_result.applyBodyMorphsCalls, a_result.totalCalls,
+                    a_result.maxTickApplies, a_result.wrong);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--actors") == 0) {
+            options.actors = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ticks") == 0) {
+            options.ticks = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--rounds") == 0) {
+            options.rounds = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: MorphBufferBench [--actors N] [--ticks N] [--rounds N] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    HighHeelClassifier classifier;
+    classifier.ParseJson({{"ByKeywords", {"SyntheticHeelKeyword"}}});
+    classifier.ResolveKeywords([](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    });
+
+    const Result immediate = Run(options, classifier, false);
+    const Result buffered = Run(options, classifier, true);
+
+    std::printf("%zu actor(s), game load + %zu tick(s) of %zu flush(es) each\n", options.actors, options.ticks,
+                options.rounds);
+    std::printf("%-10s %10s %10s %12s %10s %14s %8s\n", "commit", "SetMorph", "ClearMorph", "ApplyMorphs", "total",
+                "max per tick", "wrong");
+    Print("per flush", immediate);
+    Print("per tick", buffered);
+    std::printf("game load: %zu ApplyBodyMorphs call(s) for %zu actor(s)\n", buffered.loadApplies, options.actors);
+    std::printf("buffered: %.2fx fewer backend calls, %.2fx fewer ApplyBodyMorphs\n",
+                buffered.totalCalls ? static_cast<double>(immediate.totalCalls) / buffered.totalCalls : 1.0,
+                buffered.applyBodyMorphsCalls
+                    ? static_cast<double>(immediate.applyBodyMorphsCalls) / buffered.applyBodyMorphsCalls
+                    : 1.0);
+
+    const bool isOk = immediate.wrong == 0 && buffered.wrong == 0 && buffered.maxTickApplies <= 1 &&
+                      buffered.loadApplies <= options.actors && buffered.totalCalls <= immediate.totalCalls &&
+                      immediate.isDeferred && buffered.isDeferred;
+    std::printf("%s\n", isOk ? "ok" : "FAILED");
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+// Host-side benchmark for the ByNamePattern and ByModelPath rules.
+//
+// Generates 5,000 patterns, a fifth of them with '*', over the vocabulary of armor names and mesh paths that shoe
+// mods actually ship: vanilla boots and shoes, retextures, and the "[Author] Style Colour" naming of heel packs. There
+// is no dump of a real load order to read here, so the armor corpus is built from the same word lists. Every armor
+// is then matched two ways:
+//
+//   scan       every pattern in turn, folded and searched fragment by fragment
+//   automaton  PatternRuleSet::Match(), one pass over the name and each model path
+//
+// The verdicts must agree, and must stay the same once the rules have gone through DefineHighHeel.json and come back
+// from the rule image.
+//
+//   PatternRuleBench [--patterns N] [--armors N] [--seed N]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+#include "HighHeelRules.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Target = PatternRuleSet::Target;
+
+    struct Options {
+        std::size_t patterns = 5000;
+        std::size_t armors = 5000;
+        std::uint32_t seed = 1;
+    };
+
+    constexpr const char* kMaterials[] = {
+        "Ebony",  "Glass",  "Daedric", "Elven",     "Dwarven",  "Orcish",     "Steel",    "Iron",     "Leather",
+        "Hide",   "Fur",    "Dragon",  "Stalhrim",  "Falmer",   "Nordic",     "Imperial", "Silver",   "Gilded",
+        "Velvet", "Satin",  "Lace",    "Patent",    "Suede",    "Snakeskin",  "Crystal",  "Obsidian", "Bone",
+        "Chitin", "Netch",  "Amber",   "Madness",   "Moonlit",  "Blackreach", "Wayfarer", "Noble",    "Courtly",
+        "Mercenary", "Thieves", "Shrouded", "Vampire", "Dawnguard", "Nightingale",
+    };
+    constexpr const char* kStyles[] = {
+        "Boots",    "Shoes",       "Heels",       "High Heels",  "Pumps",      "Stilettos",      "Platform Boots",
+        "Sandals",  "Wedges",      "Court Shoes", "Thigh Boots", "Knee Boots", "Ankle Boots",    "Mary Janes",
+        "Slippers", "Greaves",     "Sabatons",    "Gauntlets",   "Cuirass",    "Armor",          "Stockings",
+        "Ballet Heels", "Open Toe Heels", "Strappy Sandals", "Riding Boots", "Peep Toes", "Mules", "Clogs",
+    };
+    constexpr const char* kColours[] = {
+        "Black", "White", "Red", "Crimson", "Gold", "Silver", "Ivory",   "Onyx", "Emerald", "Sapphire", "Rose", "Plum",
+        "Teal",  "Brown", "Tan", "Nude",    "Blue", "Purple", "Pink",    "Grey", "Scarlet", "Jade",     "Pearl",
+    };
+    constexpr const char* kAuthors[] = {
+        "Vesper", "Sable",   "Aurora", "Solace",  "Lunaris", "Kestrel", "Mirelle", "Tavi",   "Orrin",    "Quill",
+        "Ysolde", "Brynja",  "Caelia", "Dremora", "Elsweyr", "Faelan",  "Gwyn",    "Halvar", "Isolde",   "Jorunn",
+        "Kaira",  "Lysette", "Maren",  "Nerys",   "Odessa",  "Perrin",  "Rhea",    "Saadia", "Thessaly", "Ulla",
+    };
+    constexpr const char* kMeshFolders[] = {
+        "Armor\\Ebony\\F",       "Armor\\Glass\\F",        "Armor\\Daedric\\F",      "Armor\\Elven\\F",
+        "Armor\\Leather\\F",     "Clothes\\Prisoner",      "Clothes\\FineClothes01", "Clothes\\Jester",
+        "Armor\\Nightingale\\F", "Armor\\ThievesGuild\\F", "DLC01\\Armor\\Vampire",  "DLC02\\Armor\\Nordic\\F",
+    };
+    constexpr const char* kMeshFiles[] = {
+        "BootsGND.nif",  "Boots_1.nif", "Boots_0.nif", "Shoes_1.nif", "Shoes_0.nif",
+        "Heels_1.nif",   "Heels_0.nif", "F_Boots_1.nif", "Feet_1.nif", "Feet_0.nif",
+    };
+
+    template <std::size_t N>
+    const char* Pick(const char* const (&a_words)[N], std::mt19937& a_rng) {
+        return a_words[a_rng() % N];
+    }
+
+    struct Armor {
+        std::string name;
+        std::vector<std::string> modelPaths;
+        std::vector<std::string_view> modelPathViews;
+    };
+
+    // Vanilla names for a third, the rest in the "[Author] Material Style - Colour 012" form of mod packs. Mod meshes
+    // sit under their author's folder, male and female variants, with both kinds of slash in use.
+    std::vector<Armor> MakeArmors(std::size_t a_count, std::mt19937& a_rng) {
+        std::vector<Armor> armors(a_count);
+        for (Armor& armor : armors) {
+            if (a_rng() % 3 == 0) {
+                armor.name = std::string(Pick(kMaterials, a_rng)) + " " + Pick(kStyles, a_rng);
+                armor.modelPaths.push_back(std::string(Pick(kMeshFolders, a_rng)) + "\\" + Pick(kMeshFiles, a_rng));
+                continue;
+            }
+            const std::string author = Pick(kAuthors, a_rng);
+            const std::string style = Pick(kStyles, a_rng);
+            armor.name = "[" + author + "] " + Pick(kMaterials, a_rng) + " " + style + " - " + Pick(kColours, a_rng) +
+                         " " + std::to_string(a_rng() % 1000);
+            std::string folder = style;
+            std::erase(folder, ' ');
+            const std::string path = author + "\\" + folder + "\\" + Pick(kColours, a_rng) + "_";
+            armor.modelPaths.push_back(path + "1.nif");
+            armor.modelPaths.push_back(path + "0.nif");
+            if (a_rng() % 2 == 0) {
+                std::ranges::replace(armor.modelPaths.back(), '\\', '/');
+            }
+        }
+        for (Armor& armor : armors) {
+            armor.modelPathViews.assign(armor.modelPaths.begin(), armor.modelPaths.end());
+        }
+        return armors;
+    }
+
+    // Mostly narrow "[Author] Item"/"Author\Folder\" rules the way packs register their own items, some with
+    // wildcards across parts of a name, and two general ones that match many armors. Half the item numbers in the
+    // narrow ones are past any armor's, so plenty of armors match nothing at all. No pattern is repeated.
+    std::vector<std::pair<Target, std::string>> MakePatterns(std::size_t a_count, std::mt19937& a_rng) {
+        std::vector<std::pair<Target, std::string>> patterns;
+        std::set<std::pair<Target, std::string>> seen;
+        const auto add = [&](Target a_target, std::string a_pattern) {
+            if (seen.emplace(a_target, a_pattern).second) {
+                patterns.emplace_back(a_target, std::move(a_pattern));
+            }
+        };
+        add(Target::kName, "stiletto");
+        add(Target::kModelPath, "\\heels\\");
+        while (patterns.size() < a_count) {
+            const std::string author = Pick(kAuthors, a_rng);
+            std::string style = Pick(kStyles, a_rng);
+            const std::string colour = Pick(kColours, a_rng);
+            switch (a_rng() % 10) {
+                case 0:
+                    add(Target::kName, Pick(kMaterials, a_rng) + ("*" + style) + "*" + colour + " " +
+                                           std::to_string(a_rng() % 2000));
+                    break;
+                case 1:
+                    add(Target::kModelPath, "*" + author + "/*" + colour + "_1.NIF");
+                    break;
+                case 2:
+                case 3:
+                case 4:
+                    add(Target::kName, "[" + author + "] " + Pick(kMaterials, a_rng) + " " + style + " - " + colour +
+                                           " " + std::to_string(a_rng() % 2000));
+                    break;
+                case 5:
+                    add(Target::kName, colour + " " + std::to_string(a_rng() % 3000));
+                    break;
+                default:
+                    std::erase(style, ' ');
+                    add(Target::kModelPath, author + "\\" + style + "\\" + colour + std::to_string(a_rng() % 9));
+                    break;
+            }
+        }
+        return patterns;
+    }
+
+    // The reference: the same matching rules as PatternRuleSet, one pattern at a time.
+    class Scan {
+    public:
+        void Add(Target a_target, std::string_view a_pattern) {
+            Entry entry{a_target, {}};
+            std::size_t begin = 0;
+            while (begin <= a_pattern.size()) {
+                const std::size_t end = std::min(a_pattern.find('*', begin), a_pattern.size());
+                if (end > begin) {
+                    entry.fragments.push_back(Fold(a_pattern.substr(begin, end - begin)));
+                }
+                begin = end + 1;
+            }
+            m_entries.push_back(std::move(entry));
+        }
+
+        bool Match(Target a_target, std::string_view a_text) const {
+            const std::string text = Fold(a_text);
+            for (const Entry& entry : m_entries) {
+                if (entry.target != a_target) {
+                    continue;
+                }
+                std::size_t position = 0;
+                bool isMatch = true;
+                for (const std::string& fragment : entry.fragments) {
+                    position = text.find(fragment, position);
+                    if (position == std::string::npos) {
+                        isMatch = false;
+                        break;
+                    }
+                    position += fragment.size();
+                }
+                if (isMatch) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Entry {
+            Target target;
+            std::vector<std::string> fragments;
+        };
+
+        static std::string Fold(std::string_view a_text) {
+            std::string folded(a_text);
+            std::ranges::transform(folded, folded.begin(), PatternRuleSet::Fold);
+            return folded;
+        }
+
+        std::vector<Entry> m_entries;
+    };
+
+    template <class TMatch>
+    bool IsHighHeel(const Armor& a_armor, TMatch&& a_match) {
+        if (a_match(Target::kName, a_armor.name)) {
+            return true;
+        }
+        return std::ranges::any_of(a_armor.modelPaths, [&a_match](const std::string& a_path) {
+            return a_match(Target::kModelPath, a_path);
+        });
+    }
+
+    double ElapsedMs(Clock::time_point a_start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - a_start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--patterns") == 0) {
+            options.patterns = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--armors") == 0) {
+            options.armors = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: PatternRuleBench [--patterns N] [--armors N] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    std::mt19937 rng(options.seed);
+    const auto patterns = MakePatterns(options.patterns, rng);
+    const auto armors = MakeArmors(options.armors, rng);
+    std::size_t bytes = 0;
+    for (const Armor& armor : armors) {
+        bytes += armor.name.size();
+        for (const auto& path : armor.modelPaths) {
+            bytes += path.size();
+        }
+    }
+
+    Scan scan;
+    PatternRuleSet rules;
+    auto start = Clock::now();
+    for (const auto& [target, pattern] : patterns) {
+        rules.Add(target, pattern);
+    }
+    rules.Build();
+    const double buildMs = ElapsedMs(start);
+    for (const auto& [target, pattern] : patterns) {
+        scan.Add(target, pattern);
+    }
+
+    std::vector<std::uint8_t> expected(armors.size());
+    start = Clock::now();
+    for (std::size_t i = 0; i < armors.size(); ++i) {
+        expected[i] = IsHighHeel(armors[i], [&scan](Target a_target, std::string_view a_text) {
+            return scan.Match(a_target, a_text);
+        });
+    }
+    const double scanMs = ElapsedMs(start);
+
+    std::vector<std::uint8_t> actual(armors.size());
+    constexpr int kRuns = 20;
+    start = Clock::now();
+    for (int run = 0; run < kRuns; ++run) {
+        for (std::size_t i = 0; i < armors.size(); ++i) {
+            actual[i] = IsHighHeel(armors[i], [&rules](Target a_target, std::string_view a_text) {
+                return rules.Match(a_target, a_text) != nullptr;
+            });
+        }
+    }
+    const double automatonMs = ElapsedMs(start) / kRuns;
+    std::size_t wrong = 0;
+    for (std::size_t i = 0; i < armors.size(); ++i) {
+        wrong += expected[i] != actual[i];
+    }
+
+    // Through DefineHighHeel.json: parsed and written to the rule image, then attached from the image.
+    const auto root = std::filesystem::temp_directory_path() / "PatternRuleBench";
+    const auto jsonPath = root / "DefineHighHeel.json";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    {
+        nlohmann::json json;
+        json["ByNamePattern"] = nlohmann::json::array();
+        json["ByModelPath"] = nlohmann::json::array();
+        for (const auto& [target, pattern] : patterns) {
+            json[target == Target::kName ? "ByNamePattern" : "ByModelPath"].push_back(pattern);
+        }
+        std::ofstream(jsonPath) << json.dump(1);
+    }
+    HighHeelRules parsed;
+    HighHeelRules mapped;
+    bool isOk = parsed.Load(jsonPath) && std::filesystem::exists(root / "DefineHighHeel.json.bin") &&
+                mapped.Load(jsonPath);
+    std::size_t imageWrong = 0;
+    for (std::size_t i = 0; i < armors.size(); ++i) {
+        ArmorInfo info;
+        info.formID = static_cast<std::uint32_t>(i + 1);
+        info.name = armors[i].name;
+        info.modelPaths = armors[i].modelPathViews;
+        imageWrong += parsed.Classify(info) != static_cast<bool>(expected[i]);
+        imageWrong += mapped.Classify(info) != static_cast<bool>(expected[i]);
+    }
+    isOk &= mapped.GetPatternRules().GetPatternCount() == rules.GetPatternCount() &&
+            mapped.GetPatternRules().GetStateCount() == rules.GetStateCount();
+    std::filesystem::remove_all(root);
+
+    const std::size_t matched = std::ranges::count(expected, 1);
+    std::printf("%zu pattern(s), %zu armor(s) (%zu KiB of names and paths), %zu high heel(s)\n",
+                rules.GetPatternCount(), armors.size(), bytes / 1024, matched);
+    std::printf("automaton: %zu state(s), %zu KiB, built in %.2f ms\n", rules.GetStateCount(),
+                rules.GetMemoryUsage() / 1024, buildMs);
+    std::printf("%-12s %12s %14s\n", "matcher", "ms", "ns / armor");
+    std::printf("%-12s %12.2f %14.1f\n", "scan", scanMs, scanMs * 1e6 / armors.size());
+    std::printf("%-12s %12.2f %14.1f\n", "automaton", automatonMs, automatonMs * 1e6 / armors.size());
+    std::printf("%zu wrong verdict(s), %zu after the rule image\n", wrong, imageWrong);
+    return isOk && wrong == 0 && imageWrong == 0 ? 0 : 1;
+}
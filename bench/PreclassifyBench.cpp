@@ -0,0 +1,219 @@
+// Host-side benchmark for the kDataLoaded pre-classification pass.
+//
+// Synthesizes a load order of regular and light plugins with the FormID layout the engine uses, catalogs their
+// footwear, and builds the ArmorVerdictSet the way HighHeelClassifier does on kDataLoaded. Reports how long the pass
+// takes on every core, how much memory the bitset takes, and what a lookup costs against the lazy
+// classify-and-memoize path. Every bit is checked against HighHeelRules::Classify().
+//
+//   PreclassifyBench [--plugins N] [--light-share PERCENT] [--armors-per-plugin N] [--seed N]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ArmorVerdictSet.h"
+#include "HighHeelClassifier.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kOtherKeyword = 0x00013EE1;
+    constexpr std::size_t kRegularSlots = 0xFE;
+    constexpr std::size_t kLightSlots = 0x1000;
+    constexpr std::size_t kQueryCount = 1 << 20;
+
+    struct Options {
+        std::size_t plugins = 2000;
+        std::size_t lightShare = 80;  // percent
+        std::size_t armorsPerPlugin = 40;
+        std::uint32_t seed = 1;
+    };
+
+    struct LoadOrder {
+        std::vector<std::string> names;
+        std::size_t lightCount{};
+        ArmorCatalog catalog;
+        nlohmann::json rules;
+    };
+
+    LoadOrder Synthesize(const Options& a_options) {
+        std::mt19937 rng(a_options.seed);
+        LoadOrder loadOrder;
+        const std::size_t regularShare = a_options.plugins * (100 - a_options.lightShare) / 100;
+        const std::size_t regularCount = std::min(regularShare, kRegularSlots);
+        const std::size_t lightCount = std::min(a_options.plugins - regularCount, kLightSlots);
+        loadOrder.names.reserve(regularCount + lightCount);
+        loadOrder.lightCount = lightCount;
+
+        std::vector<std::size_t> keywordCounts;
+        loadOrder.rules["ByKeywords"] = {"SyntheticHeelKeyword"};
+        loadOrder.rules["ByFormIDRange"] = nlohmann::json::array();
+        char hex[16];
+        const auto addPlugin = [&](std::uint32_t a_prefix, std::uint32_t a_localMax, bool a_isLight) {
+            loadOrder.names.push_back((a_isLight ? "SyntheticLight" : "SyntheticMod") +
+                                      std::to_string(loadOrder.names.size()) + (a_isLight ? ".esl" : ".esp"));
+            // Armors of a mod are clustered, usually in a few runs of records added together.
+            std::uniform_int_distribution<std::uint32_t> local(0x800, a_localMax);
+            std::vector<bool> isUsed(a_localMax + 1);
+            std::uint32_t cursor = local(rng);
+            for (std::size_t i = 0; i < a_options.armorsPerPlugin; ++i) {
+                cursor = rng() % 8 == 0 ? local(rng) : cursor + 1 + rng() % 4;
+                while (cursor > a_localMax || isUsed[cursor]) {
+                    cursor = local(rng);
+                }
+                isUsed[cursor] = true;
+                ArmorInfo armor;
+                armor.formID = a_prefix | cursor;
+                armor.localFormID = cursor;
+                armor.coversFeet = true;
+                armor.coversCalves = rng() % 4 == 0;
+                loadOrder.catalog.keywords.push_back(kOtherKeyword);
+                std::size_t keywords = 1;
+                if (rng() % 16 == 0) {
+                    loadOrder.catalog.keywords.push_back(kHeelKeyword);
+                    ++keywords;
+                }
+                keywordCounts.push_back(keywords);
+                loadOrder.catalog.armors.push_back(armor);
+            }
+            // A rule for about one plugin in ten, covering part of its records.
+            if (rng() % 10 == 0) {
+                const std::uint32_t min = local(rng);
+                std::snprintf(hex, sizeof(hex), "%X", min);
+                std::string minHex = hex;
+                std::snprintf(hex, sizeof(hex), "%X", std::min<std::uint32_t>(min + 0x400, a_localMax));
+                loadOrder.rules["ByFormIDRange"].push_back(
+                    {{"Plugin", loadOrder.names.back()}, {"Min", minHex}, {"Max", hex}});
+            }
+        };
+        for (std::size_t i = 0; i < regularCount; ++i) {
+            addPlugin(static_cast<std::uint32_t>(i) << 24, 0x40000, false);
+        }
+        for (std::size_t i = 0; i < lightCount; ++i) {
+            addPlugin(0xFE000000 | static_cast<std::uint32_t>(i) << 12, 0xFFF, true);
+        }
+
+        // Plugin names and keyword spans only once both vectors have stopped growing.
+        const std::span<const std::uint32_t> keywords = loadOrder.catalog.keywords;
+        std::size_t keywordBegin = 0;
+        for (std::size_t i = 0; i < loadOrder.catalog.armors.size(); ++i) {
+            auto& armor = loadOrder.catalog.armors[i];
+            armor.plugin = loadOrder.names[i / a_options.armorsPerPlugin];
+            armor.keywords = keywords.subspan(keywordBegin, keywordCounts[i]);
+            keywordBegin += keywordCounts[i];
+        }
+        return loadOrder;
+    }
+
+    double BuildMs(ArmorVerdictSet& a_set, const ArmorCatalog& a_catalog, const HighHeelRules& a_rules) {
+        const auto start = Clock::now();
+        a_set.Build(a_catalog.armors, [&a_rules](std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) {
+            a_rules.ClassifyBatch(a_keys, a_out);
+        });
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    template <class TFunc>
+    double NsPerLookup(const std::vector<const ArmorInfo*>& a_queries, TFunc&& a_isHighHeel, std::size_t& a_hits) {
+        a_hits = 0;
+        const auto start = Clock::now();
+        for (const ArmorInfo* armor : a_queries) {
+            a_hits += a_isHighHeel(*armor) ? 1 : 0;
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / a_queries.size();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--plugins") == 0) {
+            options.plugins = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--light-share") == 0) {
+            options.lightShare = std::min<std::size_t>(100, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--armors-per-plugin") == 0) {
+            options.armorsPerPlugin = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr,
+                         "usage: PreclassifyBench [--plugins N] [--light-share PERCENT] [--armors-per-plugin N] "
+                         "[--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    const LoadOrder loadOrder = Synthesize(options);
+    const KeywordRuleSet::Resolver resolver = [](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    };
+    HighHeelRules rules;
+    rules.ParseJson(loadOrder.rules);
+    rules.ResolveKeywords(resolver);
+
+    ArmorVerdictSet verdicts;
+    std::vector<double> passMs;
+    for (int run = 0; run < 5; ++run) {
+        passMs.push_back(BuildMs(verdicts, loadOrder.catalog, rules));
+    }
+    std::ranges::sort(passMs);
+
+    std::size_t mismatches = 0;
+    for (const auto& armor : loadOrder.catalog.armors) {
+        mismatches += verdicts.Find(armor.formID) != std::optional(rules.Classify(armor)) ? 1 : 0;
+    }
+
+    // Lookup cost on the event path: the classifier with and without a catalog. Both are warmed up first, so the lazy
+    // one answers from its memo where it can.
+    HighHeelClassifier lazy;
+    HighHeelClassifier preclassified;
+    preclassified.SetArmorCatalog(std::shared_ptr<const ArmorCatalog>(&loadOrder.catalog, [](const ArmorCatalog*) {}));
+    for (HighHeelClassifier* classifier : {&lazy, &preclassified}) {
+        classifier->ParseJson(loadOrder.rules);
+        classifier->ResolveKeywords(resolver);
+    }
+
+    std::mt19937 rng(options.seed + 1);
+    std::uniform_int_distribution<std::size_t> pick(0, loadOrder.catalog.armors.size() - 1);
+    std::vector<const ArmorInfo*> queries(kQueryCount);
+    for (auto& query : queries) {
+        query = &loadOrder.catalog.armors[pick(rng)];
+    }
+    std::size_t lazyHits = 0;
+    std::size_t rulesHits = 0;
+    std::size_t bitHits = 0;
+    std::size_t preclassifiedHits = 0;
+    NsPerLookup(queries, [&](const ArmorInfo& a_armor) { return lazy.IsHighHeel(a_armor); }, lazyHits);
+    const double lazyNs =
+        NsPerLookup(queries, [&](const ArmorInfo& a_armor) { return lazy.IsHighHeel(a_armor); }, lazyHits);
+    const double preclassifiedNs = NsPerLookup(
+        queries, [&](const ArmorInfo& a_armor) { return preclassified.IsHighHeel(a_armor); }, preclassifiedHits);
+    const double rulesNs =
+        NsPerLookup(queries, [&](const ArmorInfo& a_armor) { return rules.Classify(a_armor); }, rulesHits);
+    const double bitNs = NsPerLookup(
+        queries, [&](const ArmorInfo& a_armor) { return verdicts.Find(a_armor.formID).value_or(false); }, bitHits);
+
+    std::printf("%zu plugin(s) (%zu light), %zu armor(s), %zu high heel(s), %u thread(s)\n", loadOrder.names.size(),
+                loadOrder.lightCount, verdicts.GetArmorCount(), verdicts.GetHighHeelCount(),
+                std::max(1u, std::thread::hardware_concurrency()));
+    std::printf("pass       median %8.2f ms\n", passMs[passMs.size() / 2]);
+    std::printf("bitset     %zu segment(s), %.1f KiB\n", verdicts.GetSegmentCount(),
+                verdicts.GetMemoryUsage() / 1024.0);
+    std::printf("%-28s %10s\n", "lookup", "ns");
+    std::printf("%-28s %10.1f\n", "rules only", rulesNs);
+    std::printf("%-28s %10.1f\n", "lazy + verdict cache", lazyNs);
+    std::printf("%-28s %10.1f\n", "pre-classified classifier", preclassifiedNs);
+    std::printf("%-28s %10.1f\n", "bit test only", bitNs);
+    const bool agree = lazyHits == rulesHits && preclassifiedHits == rulesHits && bitHits == rulesHits;
+    std::printf("%zu verdict mismatch(es), lookups %s\n", mismatches, agree ? "agree" : "DISAGREE");
+    return mismatches == 0 && agree ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+// Headless harness for the load-time reconciliation of actor morphs, against a fake SKEE morph store.
+//
+// The fake stores morphs per actor, key and name the way SKEE does, and a save is a copy of that store plus what
+// every actor wears. Two saves are made from different sessions. Some actors in each are saved with stale morphs:
+// clothes changed behind the plugin's back, morphs lost, or the legacy key of old releases still present. The saves
+// are then loaded one after another in a single session, with play in between, and once through a new game. Each
+// load resets the applier and runs the actor sweep, committing once per frame, as the plugin does. The harness
+// fails unless after every load:
+//
+//   - every actor carries exactly the morphs of what it wears, and no legacy key
+//   - ApplyBodyMorphs was called exactly once for each actor saved with wrong morphs, and for no other
+//
+//   ReconcileBench [--actors N] [--stale PERCENT] [--seed N]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ActorSweep.h"
+#include "EquipPipeline.h"
+#include "MorphApplier.h"
+
+namespace {
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kFirstActor = 0xFF000800;
+    constexpr std::size_t kMaxFrames = 100000;
+    constexpr std::size_t kPlayRounds = 5;
+
+    struct Options {
+        std::size_t actors = 1000;
+        std::size_t stalePercent = 10;
+        std::uint32_t seed = 1;
+    };
+
+    enum Armor : std::uint32_t {
+        kNone = 0,
+        kHighHeels = 0x00012E46,
+        kLowHeels = 0x00012E4B,
+        kPantyhose = 0x00013EE1,
+    };
+    constexpr std::uint32_t kFeet[] = {kNone, kHighHeels, kLowHeels};
+
+    struct Actor {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+    };
+
+    class FakeWorld : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            static const std::uint32_t heel[] = {kHeelKeyword};
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.plugin = "Skyrim.esm";
+            a_out.localFormID = a_formID & 0xFFFFFF;
+            a_out.keywords = a_formID == kHighHeels ? std::span<const std::uint32_t>(heel)
+                                                    : std::span<const std::uint32_t>{};
+            a_out.coversFeet = a_formID != kPantyhose;
+            a_out.coversCalves = a_formID == kPantyhose;
+            return a_formID != kNone;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            const auto it = actors.find(a_formID);
+            return it != actors.end() ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            const auto* actor = static_cast<const Actor*>(a_actor.native);
+            return LookupArmor(a_slot == ArmorSlot::kFeet ? actor->feet : actor->calves, a_out);
+        }
+
+        std::unordered_map<std::uint32_t, Actor> actors;
+    };
+
+    // actor -> morph key -> morph name -> value
+    using MorphStore = std::unordered_map<std::uint32_t, std::map<std::string, std::map<std::string, float>>>;
+
+    // SKEE's morph store with every call counted. Clearing the last morph of a key drops the key.
+    class FakeSKEE : public IMorphBackend {
+    public:
+        struct Counts {
+            std::size_t queries{};
+            std::size_t writes{};
+            std::size_t applies{};
+        };
+
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                      float a_value) override {
+            ++counts.writes;
+            store[a_actor.formID][a_morphKey][a_morphName] = a_value;
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++counts.writes;
+            auto& keys = store[a_actor.formID];
+            if (const auto it = keys.find(a_morphKey); it != keys.end()) {
+                it->second.erase(a_morphName);
+                if (it->second.empty()) {
+                    keys.erase(it);
+                }
+            }
+        }
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override {
+            ++counts.queries;
+            const auto it = store.find(a_actor.formID);
+            return it != store.end() && it->second.contains(a_morphKey);
+        }
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++counts.queries;
+            return Find(a_actor.formID, a_morphKey, a_morphName);
+        }
+        void ApplyBodyMorphs(const ActorHandle& a_actor, bool) override {
+            ++counts.applies;
+            ++applied[a_actor.formID];
+        }
+
+        float Find(std::uint32_t a_formID, const char* a_morphKey, const char* a_morphName) const {
+            const auto actor = store.find(a_formID);
+            if (actor == store.end()) {
+                return 0.0f;
+            }
+            const auto key = actor->second.find(a_morphKey);
+            if (key == actor->second.end()) {
+                return 0.0f;
+            }
+            const auto morph = key->second.find(a_morphName);
+            return morph != key->second.end() ? morph->second : 0.0f;
+        }
+
+        MorphStore store;
+        Counts counts;
+        std::unordered_map<std::uint32_t, std::size_t> applied;  // ApplyBodyMorphs calls per actor
+    };
+
+    struct Save {
+        std::unordered_map<std::uint32_t, Actor> worn;
+        MorphStore morphs;
+    };
+
+    struct Session {
+        FakeWorld world;
+        FakeSKEE skee;
+        MorphApplier morphApplier{skee};
+        EquipPipeline pipeline;
+        ActorSweep sweep;
+        HighHeelClassifier& classifier;
+
+        explicit Session(HighHeelClassifier& a_classifier)
+            : pipeline(world, a_classifier, morphApplier), sweep(world, pipeline), classifier(a_classifier) {}
+    };
+
+    bool IsCorrect(Session& a_session, std::uint32_t a_formID) {
+        auto& actor = a_session.world.actors.at(a_formID);
+        const auto state = a_session.pipeline.ResolveWornState({a_formID, &actor});
+        const auto& skee = a_session.skee;
+        if (skee.Find(a_formID, MorphApplier::kLegacyMorphKey, "NoHeel") != 0.0f) {
+            return false;
+        }
+        for (std::size_t m = 0; m < MorphStateMachine::kMorphCount; ++m) {
+            const auto morph = static_cast<MorphStateMachine::Morph>(m);
+            const bool isSet = skee.Find(a_formID, MorphApplier::kMorphKey, MorphStateMachine::GetMorphName(morph));
+            if (isSet != MorphStateMachine::IsMorphSet(state, morph)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // What the plugin does on kPreLoadGame and kPostLoadGame, with SKEE restoring a_save's morphs in between.
+    // Returns the number of sweep frames.
+    std::size_t Load(Session& a_session, const Save& a_save) {
+        a_session.sweep.Clear();
+        a_session.morphApplier.ResetAppliedMorphs();
+        a_session.world.actors = a_save.worn;
+        a_session.skee.store = a_save.morphs;
+
+        std::vector<ActorSweep::Target> targets;
+        float distance = 0.0f;
+        for (const auto& [formID, actor] : a_session.world.actors) {
+            targets.push_back({formID, distance += 1.0f});
+        }
+        a_session.sweep.Enqueue(targets);
+        std::size_t frames = 0;
+        for (bool isPending = true; isPending && frames < kMaxFrames; ++frames) {
+            isPending = a_session.sweep.RunFrame();
+            a_session.morphApplier.Commit(a_session.world);
+        }
+        return frames;
+    }
+
+    // Outfit changes through equip events, a flush and a commit per round.
+    void Play(Session& a_session, std::mt19937& a_rng) {
+        for (std::size_t round = 0; round < kPlayRounds; ++round) {
+            for (auto& [formID, actor] : a_session.world.actors) {
+                if (a_rng() % 4 != 0) {
+                    continue;
+                }
+                if (a_rng() % 2 == 0) {
+                    const std::uint32_t feet = kFeet[a_rng() % 3];
+                    if (feet != actor.feet) {
+                        const std::uint32_t old = actor.feet;
+                        actor.feet = feet;
+                        if (old != kNone) {
+                            a_session.pipeline.OnEquipEvent({formID, old, false});
+                        }
+                        if (feet != kNone) {
+                            a_session.pipeline.OnEquipEvent({formID, feet, true});
+                        }
+                    }
+                } else {
+                    const bool isEquipped = actor.calves == kNone;
+                    actor.calves = isEquipped ? kPantyhose : kNone;
+                    a_session.pipeline.OnEquipEvent({formID, kPantyhose, isEquipped});
+                }
+            }
+            a_session.pipeline.Flush();
+            a_session.morphApplier.Commit(a_session.world);
+        }
+    }
+
+    // A session of its own: a new game, some play, then stale actors the way real saves end up with them.
+    Save MakeSave(HighHeelClassifier& a_classifier, const Options& a_options, std::uint32_t a_seed) {
+        std::mt19937 rng(a_seed);
+        Session session(a_classifier);
+        Save fresh;
+        for (std::size_t i = 0; i < a_options.actors; ++i) {
+            fresh.worn[static_cast<std::uint32_t>(kFirstActor + i)] = {kFeet[rng() % 3],
+                                                                       rng() % 2 == 0 ? kPantyhose : kNone};
+        }
+        Load(session, fresh);
+        Play(session, rng);
+
+        for (auto& [formID, actor] : session.world.actors) {
+            if (rng() % 100 >= a_options.stalePercent) {
+                continue;
+            }
+            switch (rng() % 3) {
+                case 0:  // changed without an equip event the plugin saw
+                    actor = {kFeet[rng() % 3], rng() % 2 == 0 ? kPantyhose : kNone};
+                    break;
+                case 1:  // morphs lost
+                    session.skee.store.erase(formID);
+                    break;
+                default:  // saved by an old release
+                    session.skee.store[formID][MorphApplier::kLegacyMorphKey]["NoHeel"] = 1.0f;
+                    break;
+            }
+        }
+        return {session.world.actors, session.skee.store};
+    }
+
+    struct LoadResult {
+        std::size_t stale{};
+        std::size_t frames{};
+        FakeSKEE::Counts counts;
+        std::size_t wrong{};
+        std::size_t misapplied{};  // actors applied other than exactly once if stale, never otherwise
+    };
+
+    LoadResult MeasureLoad(Session& a_session, const Save& a_save) {
+        // The save as SKEE restores it, checked against itself before it is loaded.
+        Session saved(a_session.classifier);
+        saved.world.actors = a_save.worn;
+        saved.skee.store = a_save.morphs;
+
+        LoadResult result;
+        const auto before = a_session.skee.counts;
+        a_session.skee.applied.clear();
+        result.frames = Load(a_session, a_save);
+        result.counts.queries = a_session.skee.counts.queries - before.queries;
+        result.counts.writes = a_session.skee.counts.writes - before.writes;
+        result.counts.applies = a_session.skee.counts.applies - before.applies;
+
+        for (const auto& [formID, actor] : a_session.world.actors) {
+            const bool isStale = !IsCorrect(saved, formID);
+            const auto it = a_session.skee.applied.find(formID);
+            const std::size_t applies = it != a_session.skee.applied.end() ? it->second : 0;
+            result.stale += isStale ? 1 : 0;
+            result.wrong += IsCorrect(a_session, formID) ? 0 : 1;
+            result.misapplied += applies == (isStale ? 1u : 0u) ? 0 : 1;
+        }
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--actors") == 0) {
+            options.actors = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--stale") == 0) {
+            options.stalePercent = std::min<std::size_t>(100, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "usage: ReconcileBench [--actors N] [--stale PERCENT] [--seed N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    HighHeelClassifier classifier;
+    classifier.ParseJson({{"ByKeywords", {"SyntheticHeelKeyword"}}});
+    classifier.ResolveKeywords([](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    });
+
+    const Save saveA = MakeSave(classifier, options, options.seed);
+    const Save saveB = MakeSave(classifier, options, options.seed + 1);
+    Save newGame;
+    {
+        std::mt19937 rng(options.seed + 2);
+        for (std::size_t i = 0; i < options.actors; ++i) {
+            newGame.worn[static_cast<std::uint32_t>(kFirstActor + i)] = {kFeet[rng() % 3],
+                                                                         rng() % 2 == 0 ? kPantyhose : kNone};
+        }
+    }
+
+    // One session, loads back to back. Play in between moves every actor's state away from what the next save
+    // holds, so nothing the applier remembers from the previous load may be trusted.
+    struct Step {
+        const char* label;
+        const Save* save;
+        bool isPlayedBefore;
+    };
+    const Step steps[] = {
+        {"load A", &saveA, false}, {"load B", &saveB, true}, {"load A", &saveA, true},
+        {"load A", &saveA, false}, {"new game", &newGame, false}, {"load B", &saveB, true},
+    };
+
+    Session session(classifier);
+    std::mt19937 rng(options.seed + 3);
+    // The plugin used to clear the legacy key and write both morphs on every actor, then apply it.
+    const std::size_t fullRewriteCalls = options.actors * (2 + MorphStateMachine::kMorphCount);
+
+    std::printf("%zu actor(s), about %zu%% stale per save; a full rewrite is %zu SKEE call(s) per load\n",
+                options.actors, options.stalePercent, fullRewriteCalls);
+    std::printf("%-10s %8s %8s %8s %8s %8s %10s %8s\n", "step", "stale", "frames", "queries", "writes", "applies",
+                "vs full", "wrong");
+    bool isOk = true;
+    for (const Step& step : steps) {
+        if (step.isPlayedBefore) {
+            Play(session, rng);
+        }
+        const LoadResult result = MeasureLoad(session, *step.save);
+        const std::size_t calls = result.counts.writes + result.counts.applies;
+        std::printf("%-10s %8zu %8zu %8zu %8zu %8zu %9.1fx %8zu\n", step.label, result.stale, result.frames,
+                    result.counts.queries, result.counts.writes, result.counts.applies,
+                    calls ? static_cast<double>(fullRewriteCalls) / calls : 0.0, result.wrong);
+        isOk &= result.wrong == 0 && result.misapplied == 0 && result.counts.applies == result.stale &&
+                result.frames < kMaxFrames;
+    }
+    std::printf("%s\n", isOk ? "every load wrote exactly the stale actors" : "FAILED");
+    return isOk ? 0 : 1;
+}
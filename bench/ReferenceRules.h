@@ -0,0 +1,118 @@
+#pragma once
+// The high heel rules as README.md states them, checked one rule at a time against every armor.
+//
+// This is the yardstick the compiled engine is measured and fuzzed against: no merging, no indexes, no automaton,
+// no caches. It starts from the parsed RuleFiles, so what it checks is everything after the parser.
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HighHeelRules.h"
+
+class ReferenceRules {
+public:
+    ReferenceRules(std::span<const RuleFile> a_files, const KeywordRuleSet::Resolver& a_resolver) {
+        for (const RuleFile& file : a_files) {
+            for (const auto& keyword : file.keywords) {
+                if (const auto formID = a_resolver ? a_resolver(keyword) : std::nullopt) {
+                    m_keywords.push_back(*formID);
+                }
+            }
+            m_ranges.insert(m_ranges.end(), file.ranges.begin(), file.ranges.end());
+            for (const auto& pattern : file.namePatterns) {
+                m_namePatterns.push_back(Split(pattern));
+            }
+            for (const auto& pattern : file.modelPathPatterns) {
+                m_modelPathPatterns.push_back(Split(pattern));
+            }
+        }
+    }
+
+    bool Classify(const ArmorInfo& a_armor) const {
+        for (const std::uint32_t keyword : a_armor.keywords) {
+            for (const std::uint32_t rule : m_keywords) {
+                if (keyword == rule) {
+                    return true;
+                }
+            }
+        }
+        if (!a_armor.plugin.empty()) {
+            for (const auto& range : m_ranges) {
+                if (range.plugin == a_armor.plugin && range.min <= a_armor.localFormID &&
+                    a_armor.localFormID <= range.max) {
+                    return true;
+                }
+            }
+        }
+        if (MatchesAny(m_namePatterns, a_armor.name)) {
+            return true;
+        }
+        for (const auto path : a_armor.modelPaths) {
+            if (MatchesAny(m_modelPathPatterns, path)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    using Fragments = std::vector<std::string>;
+
+    static std::string Fold(std::string_view a_text) {
+        std::string folded(a_text);
+        for (char& c : folded) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            } else if (c == '/') {
+                c = '\\';
+            }
+        }
+        return folded;
+    }
+
+    // The runs of text between the '*'s, folded.
+    static Fragments Split(std::string_view a_pattern) {
+        Fragments fragments;
+        std::string current;
+        for (const char c : Fold(a_pattern)) {
+            if (c != '*') {
+                current += c;
+            } else if (!current.empty()) {
+                fragments.push_back(std::move(current));
+                current.clear();
+            }
+        }
+        if (!current.empty()) {
+            fragments.push_back(std::move(current));
+        }
+        return fragments;
+    }
+
+    // Every fragment in order, each starting after the previous one ends.
+    static bool MatchesAny(const std::vector<Fragments>& a_patterns, std::string_view a_text) {
+        const std::string text = Fold(a_text);
+        for (const auto& fragments : a_patterns) {
+            std::size_t position = 0;
+            bool isMatch = !fragments.empty();
+            for (const auto& fragment : fragments) {
+                position = text.find(fragment, position);
+                if (position == std::string::npos) {
+                    isMatch = false;
+                    break;
+                }
+                position += fragment.size();
+            }
+            if (isMatch) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::uint32_t> m_keywords;
+    std::vector<RuleFile::RangeRule> m_ranges;
+    std::vector<Fragments> m_namePatterns;
+    std::vector<Fragments> m_modelPathPatterns;
+};
@@ -0,0 +1,553 @@
+// Replays a recorded equip trace through the core library against a cost-modelled fake SKEE.
+//
+//   replay_bench <rules.json> <trace.tsv> [--set-ns N] [--clear-ns N] [--update-ns N]
+//   replay_bench --synthesize <dir> [--events N] [--seed N]
+//
+// The trace is tab separated, one record per line, '#' starts a comment. FormIDs are hex.
+//
+//   keyword  <editorID> <keywordFormID>
+//   armor    <formID> <plugin> <localFormID> <feet|calves|feet+calves|other> [<keywordFormID>,...]
+//   equip    <actorFormID> <armorFormID>
+//   unequip  <actorFormID> <armorFormID>
+//   flush
+//
+// keyword and armor records describe the game data and must come before the events that use them. A flush marks
+// the end of a frame, where the plugin would run its deferred task. An event's latency is the time spent handling
+// it plus the flush that wrote its result, which is what a player waits for after clicking an item.
+//
+// After the last flush every actor that changed footwear or legwear must carry the morphs of what it wears, and the
+// applied state must match; otherwise the replay fails with exit code 1.
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "EquipPipeline.h"
+#include "Metrics.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct ArmorDef {
+        std::uint32_t formID{};
+        std::string plugin;
+        std::uint32_t localFormID{};
+        bool coversFeet{};
+        bool coversCalves{};
+        std::vector<std::uint32_t> keywords;
+    };
+
+    struct TraceEvent {
+        enum class Kind : std::uint8_t { kEquip, kUnequip, kFlush };
+
+        Kind kind{};
+        std::uint32_t actorFormID{};
+        std::uint32_t armorFormID{};
+    };
+
+    struct Trace {
+        std::unordered_map<std::string, std::uint32_t> keywords;
+        std::unordered_map<std::uint32_t, ArmorDef> armors;
+        std::vector<TraceEvent> events;
+    };
+
+    struct WornSlots {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+    };
+
+    // Knows the armors from the trace and keeps track of what every actor is wearing as the trace is replayed.
+    class FakeArmorLookup : public IArmorLookup {
+    public:
+        explicit FakeArmorLookup(const Trace& a_trace) : m_trace(a_trace) {}
+
+        // Only footwear and legwear are tracked; actors that never changed either are unknown.
+        void Apply(const TraceEvent& a_event) {
+            const auto it = m_trace.armors.find(a_event.armorFormID);
+            if (it == m_trace.armors.end() || (!it->second.coversFeet && !it->second.coversCalves)) {
+                return;
+            }
+            auto& worn = m_worn[a_event.actorFormID];
+            const bool isEquipped = a_event.kind == TraceEvent::Kind::kEquip;
+            if (it->second.coversFeet) {
+                worn.feet = isEquipped ? a_event.armorFormID : (worn.feet == a_event.armorFormID ? 0 : worn.feet);
+            }
+            if (it->second.coversCalves) {
+                worn.calves =
+                    isEquipped ? a_event.armorFormID : (worn.calves == a_event.armorFormID ? 0 : worn.calves);
+            }
+        }
+
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            const auto it = m_trace.armors.find(a_formID);
+            if (it == m_trace.armors.end()) {
+                return false;
+            }
+            const ArmorDef& def = it->second;
+            a_out.formID = def.formID;
+            a_out.plugin = def.plugin;
+            a_out.localFormID = def.localFormID;
+            a_out.keywords = def.keywords;
+            a_out.coversFeet = def.coversFeet;
+            a_out.coversCalves = def.coversCalves;
+            a_out.isDynamic = (def.formID >> 24) == 0xFF;
+            return true;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            const auto it = m_worn.find(a_formID);
+            return it != m_worn.end() ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            const auto* worn = static_cast<const WornSlots*>(a_actor.native);
+            const std::uint32_t formID = a_slot == ArmorSlot::kFeet ? worn->feet : worn->calves;
+            return formID != 0 && LookupArmor(formID, a_out);
+        }
+
+        template <class TFunc>
+        void ForEachActor(TFunc&& a_func) {
+            for (auto& [formID, worn] : m_worn) {
+                a_func(ActorHandle{formID, &worn});
+            }
+        }
+
+    private:
+        const Trace& m_trace;
+        std::unordered_map<std::uint32_t, WornSlots> m_worn;
+    };
+
+    // Counts calls and burns a fixed amount of time per call, standing in for SKEE's own work. ApplyBodyMorphs
+    // is the expensive one: it queues a mesh rebuild.
+    class FakeSKEE : public IMorphBackend {
+    public:
+        struct Costs {
+            std::chrono::nanoseconds setMorph{300};
+            std::chrono::nanoseconds clearMorph{300};
+            std::chrono::nanoseconds applyBodyMorphs{20000};
+        };
+
+        explicit FakeSKEE(const Costs& a_costs) : m_costs(a_costs) {}
+
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, float) override {
+            ++setMorphCalls;
+            Record(a_actor, a_morphName, a_morphKey, true);
+            Burn(m_costs.setMorph);
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++clearMorphCalls;
+            Record(a_actor, a_morphName, a_morphKey, false);
+            Burn(m_costs.clearMorph);
+        }
+        // The trace starts on a fresh game: nobody carries a morph yet.
+        bool HasBodyMorphKey(const ActorHandle&, const char*) override { return false; }
+        float GetMorph(const ActorHandle&, const char*, const char*) override { return 0.0f; }
+        void ApplyBodyMorphs(const ActorHandle&, bool) override {
+            ++applyBodyMorphsCalls;
+            Burn(m_costs.applyBodyMorphs);
+        }
+
+        bool IsMorphSet(std::uint32_t a_actorFormID, MorphStateMachine::Morph a_morph) const {
+            const auto it = m_morphs.find(a_actorFormID);
+            return it != m_morphs.end() && (it->second & (1u << static_cast<unsigned>(a_morph))) != 0;
+        }
+
+        std::uint64_t setMorphCalls{};
+        std::uint64_t clearMorphCalls{};
+        std::uint64_t applyBodyMorphsCalls{};
+
+    private:
+        // One bit per morph under the plugin's key, for the end state check.
+        void Record(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, bool a_isSet) {
+            if (std::strcmp(a_morphKey, MorphApplier::kMorphKey) != 0) {
+                return;
+            }
+            for (std::size_t i = 0; i < MorphStateMachine::kMorphCount; ++i) {
+                const auto morph = static_cast<MorphStateMachine::Morph>(i);
+                if (std::strcmp(a_morphName, MorphStateMachine::GetMorphName(morph)) == 0) {
+                    auto& bits = m_morphs[a_actor.formID];
+                    bits = a_isSet ? bits | (1u << i) : bits & ~(1u << i);
+                }
+            }
+        }
+
+        static void Burn(std::chrono::nanoseconds a_cost) {
+            const auto deadline = Clock::now() + a_cost;
+            while (Clock::now() < deadline) {
+            }
+        }
+
+        Costs m_costs;
+        std::unordered_map<std::uint32_t, std::uint32_t> m_morphs;
+    };
+
+    bool ParseHex(std::string_view a_text, std::uint32_t& a_out) {
+        if (a_text.starts_with("0x") || a_text.starts_with("0X")) {
+            a_text.remove_prefix(2);
+        }
+        const auto [end, ec] = std::from_chars(a_text.data(), a_text.data() + a_text.size(), a_out, 16);
+        return ec == std::errc{} && end == a_text.data() + a_text.size();
+    }
+
+    std::vector<std::string_view> SplitTabs(std::string_view a_line) {
+        std::vector<std::string_view> fields;
+        while (true) {
+            const auto tab = a_line.find('\t');
+            fields.push_back(a_line.substr(0, tab));
+            if (tab == std::string_view::npos) {
+                return fields;
+            }
+            a_line.remove_prefix(tab + 1);
+        }
+    }
+
+    bool LoadTrace(const std::filesystem::path& a_path, Trace& a_trace) {
+        std::ifstream file(a_path);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "Failed to open trace '%s'\n", a_path.string().c_str());
+            return false;
+        }
+
+        std::string line;
+        std::size_t lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty() || line.front() == '#') {
+                continue;
+            }
+
+            const auto fields = SplitTabs(line);
+            const std::string_view kind = fields[0];
+            bool isValid = false;
+            if (kind == "flush") {
+                a_trace.events.push_back({TraceEvent::Kind::kFlush});
+                isValid = true;
+            } else if ((kind == "equip" || kind == "unequip") && fields.size() == 3) {
+                TraceEvent event{kind == "equip" ? TraceEvent::Kind::kEquip : TraceEvent::Kind::kUnequip};
+                isValid = ParseHex(fields[1], event.actorFormID) && ParseHex(fields[2], event.armorFormID);
+                a_trace.events.push_back(event);
+            } else if (kind == "keyword" && fields.size() == 3) {
+                std::uint32_t formID = 0;
+                isValid = ParseHex(fields[2], formID);
+                a_trace.keywords.emplace(std::string(fields[1]), formID);
+            } else if (kind == "armor" && (fields.size() == 5 || fields.size() == 6)) {
+                ArmorDef def;
+                def.plugin = fields[2];
+                def.coversFeet = fields[4] == "feet" || fields[4] == "feet+calves";
+                def.coversCalves = fields[4] == "calves" || fields[4] == "feet+calves";
+                isValid = ParseHex(fields[1], def.formID) && ParseHex(fields[3], def.localFormID);
+                if (fields.size() == 6) {
+                    std::string_view list = fields[5];
+                    while (isValid && !list.empty()) {
+                        const auto comma = list.find(',');
+                        std::uint32_t keyword = 0;
+                        isValid = ParseHex(list.substr(0, comma), keyword);
+                        def.keywords.push_back(keyword);
+                        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+                    }
+                }
+                a_trace.armors.emplace(def.formID, std::move(def));
+            }
+
+            if (!isValid) {
+                std::fprintf(stderr, "%s:%zu: malformed record '%s'\n", a_path.string().c_str(), lineNumber,
+                             line.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes a rules file and a trace shaped like a busy town: a few actors changing outfits every frame, boots
+    // from many plugins, a share of them high heels by keyword or by FormID range.
+    bool Synthesize(const std::filesystem::path& a_dir, std::size_t a_eventCount, std::uint32_t a_seed) {
+        std::mt19937 rng(a_seed);
+        std::filesystem::create_directories(a_dir);
+
+        constexpr std::uint32_t kPluginCount = 40;
+        constexpr std::uint32_t kArmorsPerPlugin = 50;
+        constexpr std::uint32_t kActorCount = 64;
+        constexpr std::uint32_t kHighHeelKeyword = 0x0A000800;
+
+        std::ofstream trace(a_dir / "trace.tsv");
+        std::ofstream rules(a_dir / "rules.json");
+        if (!trace.is_open() || !rules.is_open()) {
+            std::fprintf(stderr, "Failed to create files in '%s'\n", a_dir.string().c_str());
+            return false;
+        }
+
+        trace << "# synthesized by replay_bench, seed " << a_seed << "\n";
+        trace << "keyword\tSynthetic_HighHeels\t" << std::hex << kHighHeelKeyword << "\n";
+        trace << "keyword\tSynthetic_Cosmetic\t" << (kHighHeelKeyword + 1) << "\n";
+
+        std::vector<std::uint32_t> boots;
+        std::vector<std::uint32_t> pantyhose;
+        std::vector<std::uint32_t> other;
+        std::ostringstream ranges;
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        for (std::uint32_t p = 0; p < kPluginCount; ++p) {
+            const std::string plugin = "Synthetic Outfits " + std::to_string(p) + ".esp";
+            for (std::uint32_t i = 0; i < kArmorsPerPlugin; ++i) {
+                const std::uint32_t localFormID = 0x800 + i;
+                const std::uint32_t formID = ((p + 0x10) << 24) | localFormID;
+                const int roll = percent(rng);
+                const char* slots = roll < 50 ? "feet" : roll < 70 ? "calves" : roll < 80 ? "feet+calves" : "other";
+                trace << "armor\t" << formID << "\t" << plugin << "\t" << localFormID << "\t" << slots;
+                if (roll < 5) {
+                    trace << "\t" << kHighHeelKeyword;
+                } else if (roll < 10) {
+                    trace << "\t" << (kHighHeelKeyword + 1);
+                }
+                trace << "\n";
+                (roll < 50 || (roll >= 70 && roll < 80) ? boots : roll < 70 ? pantyhose : other).push_back(formID);
+            }
+            // The first third of every plugin's armors are heels by range.
+            ranges << (p ? "," : "") << R"({"Plugin":")" << plugin << R"(","Min":"800","Max":")" << std::hex
+                   << (0x800 + kArmorsPerPlugin / 3) << "\"}";
+        }
+        rules << R"({"ByKeywords":["Synthetic_HighHeels"],"ByFormIDRange":[)" << ranges.str() << "]}\n";
+
+        std::vector<WornSlots> worn(kActorCount);
+        std::uniform_int_distribution<std::uint32_t> actorDist(0, kActorCount - 1);
+        const auto pick = [&](const std::vector<std::uint32_t>& a_from) {
+            return a_from[std::uniform_int_distribution<std::size_t>(0, a_from.size() - 1)(rng)];
+        };
+        const auto emit = [&](const char* a_kind, std::uint32_t a_actor, std::uint32_t a_armor) {
+            trace << a_kind << "\t" << (0x14 + a_actor) << "\t" << a_armor << "\n";
+        };
+
+        std::size_t written = 0;
+        while (written < a_eventCount) {
+            // One to three actors change something per frame.
+            const int actorsThisFrame = 1 + percent(rng) % 3;
+            for (int a = 0; a < actorsThisFrame; ++a) {
+                const std::uint32_t actor = actorDist(rng);
+                auto& slots = worn[actor];
+                const int roll = percent(rng);
+                if (roll < 60) {
+                    // Boot swap: the unequip and equip arrive back to back.
+                    if (slots.feet) {
+                        emit("unequip", actor, slots.feet);
+                        ++written;
+                    }
+                    slots.feet = pick(boots);
+                    emit("equip", actor, slots.feet);
+                    ++written;
+                } else if (roll < 85) {
+                    if (slots.calves) {
+                        emit("unequip", actor, slots.calves);
+                        slots.calves = 0;
+                    } else {
+                        slots.calves = pick(pantyhose);
+                        emit("equip", actor, slots.calves);
+                    }
+                    ++written;
+                } else {
+                    // Everything else on the body: events the pipeline has to reject cheaply.
+                    emit("equip", actor, pick(other));
+                    ++written;
+                }
+            }
+            trace << "flush\n";
+        }
+
+        std::printf("Wrote %zu events for %u actors and %u armors to '%s'\n", written, kActorCount,
+                    kPluginCount * kArmorsPerPlugin, a_dir.string().c_str());
+        return true;
+    }
+
+    double Percentile(std::vector<double>& a_values, double a_percentile) {
+        if (a_values.empty()) {
+            return 0.0;
+        }
+        const auto index = static_cast<std::size_t>(a_percentile * (a_values.size() - 1));
+        std::nth_element(a_values.begin(), a_values.begin() + index, a_values.end());
+        return a_values[index];
+    }
+
+    int Replay(const std::filesystem::path& a_rulesPath, const std::filesystem::path& a_tracePath,
+               const FakeSKEE::Costs& a_costs) {
+        Trace trace;
+        if (!LoadTrace(a_tracePath, trace)) {
+            return 1;
+        }
+
+        HighHeelClassifier classifier;
+        if (!classifier.Load(a_rulesPath)) {
+            std::fprintf(stderr, "Failed to load rules from '%s'\n", a_rulesPath.string().c_str());
+            return 1;
+        }
+        classifier.ResolveKeywords([&](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+            const auto it = trace.keywords.find(std::string(a_editorID));
+            return it != trace.keywords.end() ? std::optional(it->second) : std::nullopt;
+        });
+
+        FakeArmorLookup armorLookup(trace);
+        FakeSKEE skee(a_costs);
+        MorphApplier morphApplier(skee);
+        EquipPipeline pipeline(armorLookup, classifier, morphApplier);
+        std::vector<std::uint32_t> footwear;
+        for (const auto& [formID, def] : trace.armors) {
+            if (def.coversFeet || def.coversCalves) {
+                footwear.push_back(formID);
+            }
+        }
+        pipeline.SetFootwear(footwear);
+
+        std::vector<double> latencies;
+        latencies.reserve(trace.events.size());
+        std::size_t batchBegin = 0;
+        std::size_t flushCount = 0;
+        Clock::duration total{};
+
+        const auto flush = [&]() {
+            const auto start = Clock::now();
+            pipeline.Flush();
+            morphApplier.Commit(armorLookup);
+            const auto elapsed = Clock::now() - start;
+            total += elapsed;
+            const double flushNs = std::chrono::duration<double, std::nano>(elapsed).count();
+            for (std::size_t i = batchBegin; i < latencies.size(); ++i) {
+                latencies[i] += flushNs;
+            }
+            batchBegin = latencies.size();
+            ++flushCount;
+        };
+
+        for (const auto& event : trace.events) {
+            if (event.kind == TraceEvent::Kind::kFlush) {
+                flush();
+                continue;
+            }
+            // The game has already changed what the actor wears by the time the event is sent.
+            armorLookup.Apply(event);
+            const auto start = Clock::now();
+            pipeline.OnEquipEvent({event.actorFormID, event.armorFormID, event.kind == TraceEvent::Kind::kEquip});
+            const auto elapsed = Clock::now() - start;
+            total += elapsed;
+            latencies.push_back(std::chrono::duration<double, std::nano>(elapsed).count());
+        }
+        if (batchBegin < latencies.size()) {
+            flush();
+        }
+
+        const std::size_t eventCount = latencies.size();
+        const double seconds = std::chrono::duration<double>(total).count();
+        const auto cacheStats = classifier.GetCacheStats();
+        const double p50 = Percentile(latencies, 0.50);
+        const double p99 = Percentile(latencies, 0.99);
+
+        std::printf("events             %zu in %zu flush(es)\n", eventCount, flushCount);
+        std::printf("events/sec         %.0f\n", seconds > 0 ? eventCount / seconds : 0.0);
+        std::printf("latency p50        %.1f us\n", p50 / 1000.0);
+        std::printf("latency p99        %.1f us\n", p99 / 1000.0);
+        std::printf("SetMorph           %llu\n", static_cast<unsigned long long>(skee.setMorphCalls));
+        std::printf("ClearMorph         %llu\n", static_cast<unsigned long long>(skee.clearMorphCalls));
+        std::printf("ApplyBodyMorphs    %llu\n", static_cast<unsigned long long>(skee.applyBodyMorphsCalls));
+        std::printf("SKEE calls total   %llu\n",
+                    static_cast<unsigned long long>(skee.setMorphCalls + skee.clearMorphCalls +
+                                                    skee.applyBodyMorphsCalls));
+        std::printf("verdict cache      %llu hit(s), %llu miss(es)\n",
+                    static_cast<unsigned long long>(cacheStats.hits),
+                    static_cast<unsigned long long>(cacheStats.misses));
+#if AP_ENABLE_METRICS
+        std::printf("metrics\n%s", Metrics::FormatSummary().c_str());
+#endif
+
+        // Whatever order the events came in, the replay must end with the morphs of what every actor wears.
+        std::size_t actorCount = 0;
+        std::size_t wrong = 0;
+        armorLookup.ForEachActor([&](const ActorHandle& a_actor) {
+            ++actorCount;
+            const auto state = pipeline.ResolveWornState(a_actor);
+            bool isOk = morphApplier.GetAppliedState(a_actor.formID) == state;
+            for (std::size_t i = 0; i < MorphStateMachine::kMorphCount; ++i) {
+                const auto morph = static_cast<MorphStateMachine::Morph>(i);
+                isOk = isOk && skee.IsMorphSet(a_actor.formID, morph) == MorphStateMachine::IsMorphSet(state, morph);
+            }
+            wrong += isOk ? 0 : 1;
+        });
+        std::printf("end state          %zu actor(s), %zu wrong\n", actorCount, wrong);
+        return wrong == 0 ? 0 : 1;
+    }
+
+    bool ParseCount(const char* a_text, std::size_t& a_out) {
+        const std::string_view text(a_text);
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), a_out);
+        return ec == std::errc{} && end == text.data() + text.size();
+    }
+
+    int Usage() {
+        std::fprintf(stderr,
+                     "usage: replay_bench <rules.json> <trace.tsv> [--set-ns N] [--clear-ns N] [--update-ns N]\n"
+                     "       replay_bench --synthesize <dir> [--events N] [--seed N]\n");
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::warn);
+
+    if (argc < 3) {
+        return Usage();
+    }
+
+    std::vector<std::string_view> positional;
+    std::size_t events = 200000;
+    std::size_t seed = 20240613;
+    FakeSKEE::Costs costs;
+    bool isSynthesize = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        std::size_t value = 0;
+        if (arg == "--synthesize") {
+            isSynthesize = true;
+        } else if (arg.starts_with("--") && i + 1 < argc && ParseCount(argv[i + 1], value)) {
+            ++i;
+            if (arg == "--events") {
+                events = value;
+            } else if (arg == "--seed") {
+                seed = value;
+            } else if (arg == "--set-ns") {
+                costs.setMorph = std::chrono::nanoseconds(value);
+            } else if (arg == "--clear-ns") {
+                costs.clearMorph = std::chrono::nanoseconds(value);
+            } else if (arg == "--update-ns") {
+                costs.applyBodyMorphs = std::chrono::nanoseconds(value);
+            } else {
+                return Usage();
+            }
+        } else if (!arg.starts_with("--")) {
+            positional.push_back(arg);
+        } else {
+            return Usage();
+        }
+    }
+
+    if (isSynthesize) {
+        if (positional.size() != 1) {
+            return Usage();
+        }
+        return Synthesize(positional[0], events, static_cast<std::uint32_t>(seed)) ? 0 : 1;
+    }
+    if (positional.size() != 2) {
+        return Usage();
+    }
+    return Replay(positional[0], positional[1], costs);
+}
@@ -0,0 +1,286 @@
+// Google Benchmark microbenchmarks for the rule engine.
+//
+// Synthetic rule files of 1k, 10k and 100k rules (mostly FormID ranges over 500 plugins, plus a keyword and name
+// and model path patterns) and synthetic armor populations grouped by plugin the way a load order scan sees them,
+// with a twentieth of the armors carrying the heel keyword, a heel name or a heel model path. Benchmarks:
+//
+//   BM_ParseJson/rules              HighHeelRules::ParseJson(), parse and merge
+//   BM_ReferenceClassify/rules      the linear ReferenceRules, per armor, for scale
+//   BM_Classify/rules               HighHeelRules::Classify(), per armor
+//   BM_ClassifyBatch/rules          HighHeelRules::ClassifyBatch() over the same armors, items are armors
+//   BM_IsHighHeel/path              HighHeelClassifier::IsHighHeel() through the cataloged verdicts (0), the verdict
+//                                   cache (1) and the rules (2, dynamic forms)
+//
+// Before timing, every benchmark checks its verdicts against ReferenceRules and reports a mismatch as an error.
+//
+//   RuleEngineBench [--benchmark_filter=REGEX] [--benchmark_min_time=SECONDS] ...
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "HighHeelClassifier.h"
+#include "ReferenceRules.h"
+
+namespace {
+    constexpr std::size_t kPlugins = 500;
+    constexpr std::size_t kArmors = 10000;  // population of the per-armor benchmarks
+    // Rules and armors use local IDs from 0x800 up to 0x800 + kLocalSpan, so the ranges cover a few in a hundred.
+    constexpr std::uint32_t kLocalSpan = 0x4000;
+    // The armors cycled through on the verdict cache path: what the actors around the player wear, well inside the
+    // 4,096 entries of the cache.
+    constexpr std::size_t kCachedArmors = 1024;
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+    constexpr std::uint32_t kOtherKeyword = 0x00013EE1;
+
+    bool g_isMismatched = false;  // fails the run, not only the benchmark
+
+    std::optional<std::uint32_t> ResolveKeyword(std::string_view a_editorID) {
+        return a_editorID == "SyntheticHeelKeyword" ? std::optional(kHeelKeyword) : std::nullopt;
+    }
+
+    std::string PluginName(std::size_t a_index) { return "SyntheticArmorPack" + std::to_string(a_index) + ".esp"; }
+
+    // One rule in twenty is a pattern, at most 2,000 of them; the rest are ranges.
+    std::size_t PatternCount(std::size_t a_rules) { return std::min<std::size_t>(a_rules / 20, 2000); }
+
+    nlohmann::json MakeRuleJson(std::size_t a_rules) {
+        std::mt19937 rng(static_cast<std::uint32_t>(a_rules));
+        nlohmann::json json;
+        json["ByKeywords"] = {"SyntheticHeelKeyword"};
+        json["ByFormIDRange"] = nlohmann::json::array();
+        json["ByNamePattern"] = nlohmann::json::array();
+        json["ByModelPath"] = nlohmann::json::array();
+        const std::size_t patterns = PatternCount(a_rules);
+        for (std::size_t i = 0; i < patterns; ++i) {
+            json["ByNamePattern"].push_back("*Stiletto" + std::to_string(i) + " *");
+            json["ByModelPath"].push_back("*/heels" + std::to_string(i) + "/*.nif");
+        }
+        char hex[2][16];
+        for (std::size_t i = patterns * 2; i < a_rules; ++i) {
+            const std::uint32_t min = 0x800 + rng() % kLocalSpan;
+            std::snprintf(hex[0], sizeof(hex[0]), "%X", static_cast<unsigned>(min));
+            std::snprintf(hex[1], sizeof(hex[1]), "%X", static_cast<unsigned>(min + rng() % 0x40));
+            json["ByFormIDRange"].push_back(
+                {{"Plugin", PluginName(rng() % kPlugins)}, {"Min", hex[0]}, {"Max", hex[1]}});
+        }
+        return json;
+    }
+
+    // A fake of what the adapter collects from TESObjectARMO, with the storage the spans point into.
+    struct Population {
+        std::vector<std::string> pluginNames;
+        std::vector<std::string> names;
+        std::vector<std::string> modelPaths;
+        std::vector<std::string_view> modelPathViews;
+        std::vector<ArmorInfo> armors;
+        std::vector<ArmorKey> keys;
+    };
+
+    std::unique_ptr<Population> MakePopulation(std::size_t a_count, std::size_t a_patterns) {
+        static const std::uint32_t heel[] = {kOtherKeyword, kHeelKeyword};
+        static const std::uint32_t other[] = {kOtherKeyword};
+        std::mt19937 rng(static_cast<std::uint32_t>(a_count * 31 + a_patterns));
+        auto population = std::make_unique<Population>();
+        std::unordered_set<std::uint32_t> formIDs;
+        for (std::size_t i = 0; i < kPlugins; ++i) {
+            population->pluginNames.push_back(PluginName(i));
+        }
+        population->names.reserve(a_count);
+        population->modelPaths.reserve(a_count);
+        while (population->armors.size() < a_count) {
+            const std::size_t plugin = rng() % kPlugins;
+            const std::size_t run = std::min<std::size_t>(1 + rng() % 64, a_count - population->armors.size());
+            for (std::size_t i = 0; i < run; ++i) {
+                const std::size_t n = population->armors.size();
+                const std::uint32_t roll = rng() % 60;
+                const std::string pattern = std::to_string(a_patterns ? rng() % a_patterns : 0);
+                population->names.push_back(roll == 0 ? "Stiletto" + pattern + " Pumps"
+                                                      : "Leather Boots " + std::to_string(n));
+                population->modelPaths.push_back(roll == 1 ? "Armor\\Heels" + pattern + "\\Pumps_1.nif"
+                                                           : "Armor\\Pack" + std::to_string(plugin) + "\\Boots_1.nif");
+                ArmorInfo armor;
+                do {
+                    armor.formID = static_cast<std::uint32_t>(plugin) << 24 | (0x800 + rng() % kLocalSpan);
+                } while (!formIDs.insert(armor.formID).second);
+                armor.plugin = population->pluginNames[plugin];
+                armor.localFormID = armor.formID & 0xFFFFFF;
+                armor.keywords = roll == 2 ? std::span<const std::uint32_t>(heel) : other;
+                armor.coversFeet = true;
+                population->armors.push_back(armor);
+            }
+        }
+        population->modelPathViews.assign(population->modelPaths.begin(), population->modelPaths.end());
+        for (std::size_t i = 0; i < a_count; ++i) {
+            population->armors[i].name = population->names[i];
+            population->armors[i].modelPaths = std::span(population->modelPathViews).subspan(i, 1);
+            population->keys.push_back(population->armors[i].GetKey());
+        }
+        return population;
+    }
+
+    // Rules and populations are built once per size and shared by the benchmarks.
+    struct Fixture {
+        nlohmann::json json;
+        std::vector<RuleFile> files;
+        HighHeelRules rules;
+        std::unique_ptr<ReferenceRules> reference;
+    };
+
+    const Fixture& GetFixture(std::size_t a_rules) {
+        static std::map<std::size_t, std::unique_ptr<Fixture>> fixtures;
+        auto& fixture = fixtures[a_rules];
+        if (!fixture) {
+            fixture = std::make_unique<Fixture>();
+            fixture->json = MakeRuleJson(a_rules);
+            fixture->files.emplace_back().Parse(fixture->json);
+            fixture->rules.Merge(fixture->files);
+            fixture->rules.ResolveKeywords(ResolveKeyword);
+            fixture->reference = std::make_unique<ReferenceRules>(fixture->files, ResolveKeyword);
+        }
+        return *fixture;
+    }
+
+    const Population& GetPopulation(std::size_t a_armors, std::size_t a_rules) {
+        static std::map<std::pair<std::size_t, std::size_t>, std::unique_ptr<Population>> populations;
+        auto& population = populations[{a_armors, a_rules}];
+        if (!population) {
+            population = MakePopulation(a_armors, PatternCount(a_rules));
+        }
+        return *population;
+    }
+
+    // Checks a_verdicts, those of the first armors of a_population, against the reference; on a mismatch marks the
+    // benchmark failed and returns false.
+    bool MatchesReference(benchmark::State& a_state, const Fixture& a_fixture, const Population& a_population,
+                          const std::vector<std::uint8_t>& a_verdicts) {
+        for (std::size_t i = 0; i < a_verdicts.size(); ++i) {
+            if ((a_verdicts[i] != 0) != a_fixture.reference->Classify(a_population.armors[i])) {
+                g_isMismatched = true;
+                a_state.SkipWithError(("verdict differs from the reference for " +
+                                       std::string(a_population.armors[i].name)).c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void BM_ParseJson(benchmark::State& a_state) {
+        const std::size_t count = static_cast<std::size_t>(a_state.range(0));
+        const nlohmann::json& json = GetFixture(count).json;
+        for (auto _ : a_state) {
+            HighHeelRules rules;
+            benchmark::DoNotOptimize(rules.ParseJson(json));
+        }
+        a_state.SetItemsProcessed(static_cast<std::int64_t>(a_state.iterations() * count));
+    }
+    BENCHMARK(BM_ParseJson)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+    void BM_ReferenceClassify(benchmark::State& a_state) {
+        const Fixture& fixture = GetFixture(static_cast<std::size_t>(a_state.range(0)));
+        const Population& population = GetPopulation(kArmors, static_cast<std::size_t>(a_state.range(0)));
+        std::size_t i = 0;
+        for (auto _ : a_state) {
+            benchmark::DoNotOptimize(fixture.reference->Classify(population.armors[i]));
+            i = i + 1 == population.armors.size() ? 0 : i + 1;
+        }
+        a_state.SetItemsProcessed(a_state.iterations());
+    }
+    BENCHMARK(BM_ReferenceClassify)->Arg(1000)->Arg(10000);
+
+    void BM_Classify(benchmark::State& a_state) {
+        const Fixture& fixture = GetFixture(static_cast<std::size_t>(a_state.range(0)));
+        const Population& population = GetPopulation(kArmors, static_cast<std::size_t>(a_state.range(0)));
+        std::vector<std::uint8_t> verdicts;
+        for (const auto& armor : population.armors) {
+            verdicts.push_back(fixture.rules.Classify(armor));
+        }
+        if (!MatchesReference(a_state, fixture, population, verdicts)) {
+            return;
+        }
+        std::size_t i = 0;
+        for (auto _ : a_state) {
+            benchmark::DoNotOptimize(fixture.rules.Classify(population.armors[i]));
+            i = i + 1 == population.armors.size() ? 0 : i + 1;
+        }
+        a_state.SetItemsProcessed(a_state.iterations());
+    }
+    BENCHMARK(BM_Classify)->Arg(1000)->Arg(10000)->Arg(100000);
+
+    void BM_ClassifyBatch(benchmark::State& a_state) {
+        const Fixture& fixture = GetFixture(static_cast<std::size_t>(a_state.range(0)));
+        const Population& population = GetPopulation(kArmors, static_cast<std::size_t>(a_state.range(0)));
+        std::vector<std::uint8_t> verdicts(population.keys.size());
+        fixture.rules.ClassifyBatch(population.keys, verdicts);
+        if (!MatchesReference(a_state, fixture, population, verdicts)) {
+            return;
+        }
+        for (auto _ : a_state) {
+            fixture.rules.ClassifyBatch(population.keys, verdicts);
+            benchmark::ClobberMemory();
+        }
+        a_state.SetItemsProcessed(static_cast<std::int64_t>(a_state.iterations() * population.keys.size()));
+    }
+    BENCHMARK(BM_ClassifyBatch)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+    void BM_IsHighHeel(benchmark::State& a_state) {
+        enum Path : std::int64_t { kCataloged, kCached, kRules };
+        const auto path = static_cast<Path>(a_state.range(0));
+        const Fixture& fixture = GetFixture(10000);
+        const Population& population = GetPopulation(kArmors, 10000);
+
+        // Dynamic copies of the armors are never cataloged nor cached.
+        std::vector<ArmorInfo> armors = population.armors;
+        if (path == kCached) {
+            armors.resize(kCachedArmors);
+        } else if (path == kRules) {
+            for (auto& armor : armors) {
+                armor.formID = 0xFF000000 | (armor.formID & 0xFFFFFF);
+                armor.isDynamic = true;
+            }
+        }
+        HighHeelClassifier classifier;
+        if (path == kCataloged) {
+            auto catalog = std::make_shared<ArmorCatalog>();
+            catalog->armors = population.armors;
+            classifier.SetArmorCatalog(std::move(catalog));
+        }
+        classifier.ResolveKeywords(ResolveKeyword);
+        classifier.ParseJson(fixture.json);
+
+        // The first pass also fills the verdict cache.
+        std::vector<std::uint8_t> verdicts;
+        for (const auto& armor : armors) {
+            verdicts.push_back(classifier.IsHighHeel(armor));
+        }
+        if (!MatchesReference(a_state, fixture, population, verdicts)) {
+            return;
+        }
+        std::size_t i = 0;
+        for (auto _ : a_state) {
+            benchmark::DoNotOptimize(classifier.IsHighHeel(armors[i]));
+            i = i + 1 == armors.size() ? 0 : i + 1;
+        }
+        a_state.SetLabel(path == kCataloged ? "cataloged" : path == kCached ? "cached" : "rules");
+        a_state.SetItemsProcessed(a_state.iterations());
+    }
+    BENCHMARK(BM_IsHighHeel)->Arg(0)->Arg(1)->Arg(2);
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::off);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 2;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return g_isMismatched ? 1 : 0;
+}
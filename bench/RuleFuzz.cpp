@@ -0,0 +1,370 @@
+// Differential fuzzer for the rule engine.
+//
+// Every input is decoded into one to three rule files and a handful of armors, drawn from small vocabularies so that
+// rules and armors collide often: a few plugin names differing only in case, keyword editor IDs of which some do not
+// resolve, ranges written with and without "0x", reversed or malformed, patterns over "aAbB/\*" and spaces, and
+// regular, light and dynamic armors with names and model paths over the same letters. Each armor is then classified
+//
+//   reference   ReferenceRules, one rule at a time (bench/ReferenceRules.h)
+//   classify    HighHeelRules::Classify() on the merged files
+//   batch       HighHeelRules::ClassifyBatch() on the same armors
+//   classifier  HighHeelClassifier::IsHighHeel() on the first file, twice, through the cataloged verdicts for the
+//               armors that cover the feet and through the verdict cache for the others
+//
+// and any verdict that differs from the reference is a failure.
+//
+// Built with -DAP_LIBFUZZER and -fsanitize=fuzzer this is a libFuzzer target that aborts on the first mismatch.
+// Otherwise it is a property test that runs random inputs from a seed, or replays the inputs given as files:
+//
+//   RuleFuzz [--runs N] [--max-len N] [--seed N] [INPUT...]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HighHeelClassifier.h"
+#include "ReferenceRules.h"
+
+namespace {
+    // Case variants on purpose: plugin names match exactly.
+    constexpr std::string_view kPlugins[] = {"Heels.esp", "heels.esp", "Boots.esm", "Light.esl", "Two Words.esp"};
+    constexpr std::uint32_t kPluginPrefixes[] = {0x01000000, 0x02000000, 0x03000000, 0xFE001000, 0x04000000};
+    // KW0-KW5 resolve to 0x100-0x105; the others never resolve.
+    constexpr std::string_view kKeywords[] = {"KW0", "KW1", "KW2", "KW3", "KW4", "KW5", " KW1 ", "kw0", "Missing"};
+    constexpr std::uint32_t kArmorKeywords[] = {0x100, 0x101, 0x102, 0x103, 0x104, 0x105, 0x999};
+    constexpr std::string_view kPatternAlphabet = "aAbB/\\* ";
+    constexpr std::string_view kTextAlphabet = "aAbB/\\ x";
+    constexpr std::uint32_t kLocalBase = 0x7F8;  // ranges and armors fall in [kLocalBase, kLocalBase + 0x60)
+
+    std::optional<std::uint32_t> ResolveKeyword(std::string_view a_editorID) {
+        if (a_editorID.size() == 3 && a_editorID.starts_with("KW") && a_editorID[2] >= '0' && a_editorID[2] <= '5') {
+            return 0x100 + static_cast<std::uint32_t>(a_editorID[2] - '0');
+        }
+        return std::nullopt;
+    }
+
+    // Reads the input a byte at a time; past the end every read is 0, so every input decodes to some case.
+    class ByteReader {
+    public:
+        ByteReader(const std::uint8_t* a_data, std::size_t a_size) : m_data(a_data), m_size(a_size) {}
+
+        std::uint8_t Next() { return m_position < m_size ? m_data[m_position++] : 0; }
+        std::uint32_t Below(std::uint32_t a_bound) { return Next() % a_bound; }
+        // True in a_numerator out of 16.
+        bool Chance(std::uint32_t a_numerator) { return Below(16) < a_numerator; }
+        template <class T, std::size_t N>
+        const T& Pick(const T (&a_items)[N]) {
+            return a_items[Below(N)];
+        }
+        std::string Text(std::string_view a_alphabet, std::uint32_t a_maxLength) {
+            std::string text(Below(a_maxLength + 1), ' ');
+            for (char& c : text) {
+                c = a_alphabet[Below(static_cast<std::uint32_t>(a_alphabet.size()))];
+            }
+            return text;
+        }
+
+    private:
+        const std::uint8_t* m_data;
+        std::size_t m_size;
+        std::size_t m_position = 0;
+    };
+
+    std::string Hex(std::uint32_t a_value, bool a_isPrefixed) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), a_isPrefixed ? "0x%X" : "%X", a_value);
+        return buffer;
+    }
+
+    nlohmann::json MakeRuleJson(ByteReader& a_reader) {
+        nlohmann::json j = nlohmann::json::object();
+        // Now and then a section is not an array, which fails the parse of that section only.
+        const auto section = [&](const char* a_name, auto&& a_makeRule) {
+            if (a_reader.Chance(2)) {
+                return;
+            }
+            if (a_reader.Below(64) == 0) {
+                j[a_name] = "not an array";
+                return;
+            }
+            nlohmann::json rules = nlohmann::json::array();
+            for (std::uint32_t count = a_reader.Below(5); count > 0; --count) {
+                rules.push_back(a_makeRule());
+            }
+            j[a_name] = std::move(rules);
+        };
+
+        section("ByKeywords", [&]() -> nlohmann::json {
+            if (a_reader.Below(32) == 0) {
+                return 42;
+            }
+            return std::string(a_reader.Pick(kKeywords));
+        });
+        section("ByFormIDRange", [&]() -> nlohmann::json {
+            std::string plugin(a_reader.Pick(kPlugins));
+            if (a_reader.Below(8) == 0) {
+                plugin = " " + plugin + " ";
+            }
+            const std::uint32_t min = kLocalBase + a_reader.Below(0x60);
+            const std::uint32_t max = min + a_reader.Below(24) - 2;  // sometimes below min
+            nlohmann::json rule = {{"Plugin", plugin},
+                                   {"Min", Hex(min, a_reader.Chance(8))},
+                                   {"Max", Hex(max, a_reader.Chance(8))}};
+            switch (a_reader.Below(32)) {
+                case 0:
+                    rule.erase("Max");
+                    break;
+                case 1:
+                    rule["Min"] = "0xZZ";
+                    break;
+                case 2:
+                    rule["Plugin"] = 7;
+                    break;
+                default:
+                    break;
+            }
+            return rule;
+        });
+        section("ByNamePattern", [&]() -> nlohmann::json { return a_reader.Text(kPatternAlphabet, 6); });
+        section("ByModelPath", [&]() -> nlohmann::json { return a_reader.Text(kPatternAlphabet, 6); });
+        return j;
+    }
+
+    // The armors of one case and the storage their spans point into.
+    struct Armors {
+        std::vector<ArmorInfo> infos;
+        std::vector<std::vector<std::uint32_t>> keywords;
+        std::vector<std::string> names;
+        std::vector<std::vector<std::string>> modelPaths;
+        std::vector<std::vector<std::string_view>> modelPathViews;
+    };
+
+    void MakeArmors(ByteReader& a_reader, Armors& a_out) {
+        const std::size_t count = 1 + a_reader.Below(24);
+        for (std::size_t i = 0; i < count; ++i) {
+            ArmorInfo armor;
+            const std::uint32_t origin = a_reader.Below(std::size(kPlugins) + 1);
+            armor.localFormID = kLocalBase + a_reader.Below(0x60);
+            if (origin == std::size(kPlugins)) {
+                armor.formID = 0xFF000000 | armor.localFormID;
+                armor.isDynamic = true;
+            } else {
+                armor.formID = kPluginPrefixes[origin] | armor.localFormID;
+                armor.plugin = kPlugins[origin];
+            }
+            const auto isSameForm = [&](const ArmorInfo& a_other) { return a_other.formID == armor.formID; };
+            if (std::ranges::any_of(a_out.infos, isSameForm)) {
+                continue;
+            }
+            const std::uint32_t coverage = a_reader.Below(4);
+            armor.coversFeet = coverage != 0;
+            armor.coversCalves = coverage != 1;
+
+            auto& keywords = a_out.keywords.emplace_back();
+            for (std::uint32_t n = a_reader.Below(4); n > 0; --n) {
+                keywords.push_back(a_reader.Pick(kArmorKeywords));
+            }
+            a_out.names.push_back(a_reader.Text(kTextAlphabet, 10));
+            auto& paths = a_out.modelPaths.emplace_back();
+            for (std::uint32_t n = a_reader.Below(3); n > 0; --n) {
+                paths.push_back(a_reader.Text(kTextAlphabet, 10));
+            }
+            a_out.infos.push_back(armor);
+        }
+        // Point the spans only now that the vectors no longer grow.
+        a_out.modelPathViews.resize(a_out.infos.size());
+        for (std::size_t i = 0; i < a_out.infos.size(); ++i) {
+            a_out.modelPathViews[i].assign(a_out.modelPaths[i].begin(), a_out.modelPaths[i].end());
+            a_out.infos[i].keywords = a_out.keywords[i];
+            a_out.infos[i].name = a_out.names[i];
+            a_out.infos[i].modelPaths = a_out.modelPathViews[i];
+        }
+    }
+
+    std::string Describe(const ArmorInfo& a_armor) {
+        std::string text = fmt::format("{:08X} plugin='{}' local={:#x} feet={} calves={} dynamic={} name='{}'",
+                                       a_armor.formID, a_armor.plugin, a_armor.localFormID, a_armor.coversFeet,
+                                       a_armor.coversCalves, a_armor.isDynamic, a_armor.name);
+        text += " keywords=[";
+        for (const std::uint32_t keyword : a_armor.keywords) {
+            text += fmt::format(" {:#x}", keyword);
+        }
+        text += " ] models=[";
+        for (const auto path : a_armor.modelPaths) {
+            text += fmt::format(" '{}'", path);
+        }
+        return text + " ]";
+    }
+
+    struct Totals {
+        std::size_t cases{};
+        std::size_t armors{};
+        std::size_t highHeels{};
+        std::size_t classifierChecks{};
+    };
+
+    // Returns false and prints the case on the first verdict that differs from the reference.
+    bool RunCase(const std::uint8_t* a_data, std::size_t a_size, Totals& a_totals) {
+        ByteReader reader(a_data, a_size);
+        std::vector<nlohmann::json> documents(1 + reader.Below(3));
+        std::vector<RuleFile> files(documents.size());
+        bool isFirstParsed = false;
+        for (std::size_t i = 0; i < documents.size(); ++i) {
+            documents[i] = MakeRuleJson(reader);
+            files[i].source = "fuzz" + std::to_string(i) + ".json";
+            const bool isParsed = files[i].Parse(documents[i]);
+            isFirstParsed = i == 0 ? isParsed : isFirstParsed;
+        }
+        Armors armors;
+        MakeArmors(reader, armors);
+
+        HighHeelRules rules;
+        rules.Merge(files);
+        rules.ResolveKeywords(ResolveKeyword);
+        const ReferenceRules reference(files, ResolveKeyword);
+        const ReferenceRules firstReference(std::span<const RuleFile>(files).first(1), ResolveKeyword);
+
+        std::vector<ArmorKey> keys;
+        for (const auto& armor : armors.infos) {
+            keys.push_back(armor.GetKey());
+        }
+        std::vector<std::uint8_t> batch(keys.size());
+        rules.ClassifyBatch(keys, batch);
+
+        // The classifier keeps its previous rules when a parse fails, so it is only checked on clean first files. It
+        // is given the foot armors as its catalog, as the plugin does on kDataLoaded.
+        std::optional<HighHeelClassifier> classifier;
+        if (isFirstParsed) {
+            auto catalog = std::make_shared<ArmorCatalog>();
+            for (const auto& armor : armors.infos) {
+                if (armor.coversFeet && !armor.isDynamic) {
+                    catalog->armors.push_back(armor);
+                }
+            }
+            classifier.emplace();
+            classifier->SetArmorCatalog(std::move(catalog));
+            classifier->ResolveKeywords(ResolveKeyword);
+            classifier->ParseJson(documents[0]);
+        }
+
+        const auto fail = [&](std::size_t a_index, const char* a_engine, bool a_expected) {
+            std::fprintf(stderr, "MISMATCH: %s says %s, reference says %s\n  armor %s\n", a_engine,
+                         a_expected ? "no" : "yes", a_expected ? "yes" : "no",
+                         Describe(armors.infos[a_index]).c_str());
+            for (std::size_t i = 0; i < documents.size(); ++i) {
+                std::fprintf(stderr, "  rule file %zu: %s\n", i, documents[i].dump().c_str());
+            }
+            return false;
+        };
+        for (std::size_t i = 0; i < armors.infos.size(); ++i) {
+            const ArmorInfo& armor = armors.infos[i];
+            const bool expected = reference.Classify(armor);
+            if (rules.Classify(armor) != expected) {
+                return fail(i, "Classify", expected);
+            }
+            if ((batch[i] != 0) != expected) {
+                return fail(i, "ClassifyBatch", expected);
+            }
+            if (classifier) {
+                const bool expectedFirst = firstReference.Classify(armor);
+                for (int pass = 0; pass < 2; ++pass) {
+                    if (classifier->IsHighHeel(armor) != expectedFirst) {
+                        return fail(i, pass == 0 ? "IsHighHeel" : "IsHighHeel (again)", expectedFirst);
+                    }
+                }
+                ++a_totals.classifierChecks;
+            }
+            a_totals.highHeels += expected;
+        }
+        ++a_totals.cases;
+        a_totals.armors += armors.infos.size();
+        return true;
+    }
+}
+
+#ifdef AP_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* a_data, std::size_t a_size) {
+    static const bool isQuiet = (spdlog::set_level(spdlog::level::off), true);
+    (void)isQuiet;
+    Totals totals;
+    if (!RunCase(a_data, a_size, totals)) {
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    std::size_t runs = 100000;
+    std::size_t maxLength = 256;
+    std::uint32_t seed = 1;
+    std::vector<const char*> inputs;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--runs") == 0) {
+            runs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (hasValue && std::strcmp(argv[i], "--max-len") == 0) {
+            maxLength = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (hasValue && std::strcmp(argv[i], "--seed") == 0) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argv[i][0] != '-') {
+            inputs.push_back(argv[i]);
+        } else {
+            std::fprintf(stderr, "usage: RuleFuzz [--runs N] [--max-len N] [--seed N] [INPUT...]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::off);
+
+    Totals totals;
+    for (const char* path : inputs) {
+        std::ifstream file(path, std::ios::binary);
+        const std::vector<std::uint8_t> input{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        if (!file.is_open() && input.empty()) {
+            std::fprintf(stderr, "cannot read '%s'\n", path);
+            return 2;
+        }
+        if (!RunCase(input.data(), input.size(), totals)) {
+            std::fprintf(stderr, "input: %s\n", path);
+            return 1;
+        }
+    }
+    if (!inputs.empty()) {
+        std::printf("%zu input(s), %zu armor(s) checked\n", totals.cases, totals.armors);
+        return 0;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<std::uint8_t> input;
+    for (std::size_t run = 0; run < runs; ++run) {
+        input.resize(1 + rng() % maxLength);
+        for (auto& byte : input) {
+            byte = static_cast<std::uint8_t>(rng());
+        }
+        if (!RunCase(input.data(), input.size(), totals)) {
+            std::fprintf(stderr, "seed %u, run %zu, input:", seed, run);
+            for (const std::uint8_t byte : input) {
+                std::fprintf(stderr, " %02x", byte);
+            }
+            std::fprintf(stderr, "\n");
+            return 1;
+        }
+    }
+    std::printf("%zu case(s), %zu armor(s) checked, %zu high heel verdict(s), %zu through the classifier\n",
+                totals.cases, totals.armors, totals.highHeels, totals.classifierChecks);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,215 @@
+// Host-side benchmark for loading the high heel rules at startup.
+//
+// Generates one synthetic rule set and writes it twice: as a single DefineHighHeel.json, and split across many small
+// files in a rule directory the way separate shoe mods would ship it. Each layout is loaded with
+// HighHeelRules::Load() three ways:
+//
+//   cold    no rule image yet: parse the JSON, merge, build the tables and write the image
+//   warm    the image matches the JSON: map it and attach the tables in place
+//   stale   one JSON file changed since the image was written: parse everything again and rewrite
+//
+// The merged directory must answer every query exactly like the single file, from the JSON and from the image, and
+// at the same cost per lookup.
+//
+//   RuleLoadBench [--rules N] [--keywords N] [--files N] [--runs N]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+#include "HighHeelRules.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t kPluginCount = 500;
+    constexpr std::size_t kQueryCount = 1 << 18;
+
+    struct Options {
+        std::size_t rules = 100000;
+        std::size_t keywords = 1000;
+        std::size_t files = 200;
+        int runs = 5;
+    };
+
+    struct Timings {
+        double coldMs;
+        double warmMs;
+        double staleMs;
+    };
+
+    std::string PluginName(std::size_t a_index) { return "SyntheticArmorPack" + std::to_string(a_index) + ".esp"; }
+
+    // Writes the rule set of a_seed to a_fileCount files named rules_NNN.json in a_directory, or to a_path itself
+    // when a_fileCount is 0. Rule i goes to file i % a_fileCount, so every layout holds the same rules.
+    void WriteRules(const std::filesystem::path& a_path, std::size_t a_fileCount, const Options& a_options,
+                    std::uint32_t a_seed) {
+        std::mt19937 rng(a_seed);
+        std::uniform_int_distribution<std::uint32_t> formID(0x800, 0xFFFFFF);
+        std::uniform_int_distribution<std::uint32_t> width(0, 0x40);
+        std::uniform_int_distribution<std::size_t> plugin(0, kPluginCount - 1);
+
+        const std::size_t outCount = std::max<std::size_t>(a_fileCount, 1);
+        std::vector<std::string> keywords(outCount);
+        std::vector<std::string> ranges(outCount);
+        for (std::size_t i = 0; i < a_options.keywords; ++i) {
+            auto& out = keywords[i % outCount];
+            out += (out.empty() ? "\"" : ", \"") + std::string("SyntheticHeelKeyword") + std::to_string(i) + '"';
+        }
+        char line[160];
+        for (std::size_t i = 0; i < a_options.rules; ++i) {
+            const std::uint32_t min = formID(rng);
+            const std::uint32_t max = std::min<std::uint32_t>(min + width(rng), 0xFFFFFF);
+            auto& out = ranges[i % outCount];
+            std::snprintf(line, sizeof(line), "%s    {\"Plugin\": \"%s\", \"Min\": \"%06X\", \"Max\": \"%06X\"}",
+                          out.empty() ? "" : ",\n", PluginName(plugin(rng)).c_str(), min, max);
+            out += line;
+        }
+
+        for (std::size_t i = 0; i < outCount; ++i) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "rules_%03zu.json", i);
+            std::ofstream out(a_fileCount ? a_path / name : a_path, std::ios::binary | std::ios::trunc);
+            out << "{\n  \"ByKeywords\": [" << keywords[i] << "],\n  \"ByFormIDRange\": [\n"
+                << ranges[i] << "\n  ]\n}\n";
+        }
+    }
+
+    double ElapsedMs(Clock::time_point a_start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - a_start).count();
+    }
+
+    double Median(std::vector<double> a_samples) {
+        std::ranges::sort(a_samples);
+        return a_samples[a_samples.size() / 2];
+    }
+
+    Timings MeasureLoad(const std::filesystem::path& a_path, std::size_t a_fileCount, const Options& a_options,
+                        bool& a_isOk) {
+        std::vector<double> cold;
+        std::vector<double> warm;
+        std::vector<double> stale;
+        const auto imagePath = HighHeelRules::GetImagePath(a_path);
+        for (int run = 0; run < a_options.runs; ++run) {
+            std::filesystem::remove(imagePath);
+            auto start = Clock::now();
+            a_isOk &= HighHeelRules().Load(a_path);
+            cold.push_back(ElapsedMs(start));
+
+            start = Clock::now();
+            a_isOk &= HighHeelRules().Load(a_path);
+            warm.push_back(ElapsedMs(start));
+
+            // Touch one file: append whitespace, which changes the hash but not the rules.
+            {
+                const auto touched = a_fileCount ? a_path / "rules_000.json" : a_path;
+                std::ofstream(touched, std::ios::binary | std::ios::app) << ' ';
+            }
+            start = Clock::now();
+            a_isOk &= HighHeelRules().Load(a_path);
+            stale.push_back(ElapsedMs(start));
+        }
+        return {Median(cold), Median(warm), Median(stale)};
+    }
+
+    // Every query must be answered the same way by both rule sets. Returns the mean lookup time of a_actual.
+    bool AgreeOnQueries(const HighHeelRules& a_expected, const HighHeelRules& a_actual, double& a_actualNs) {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::uint32_t> formID(0x800, 0xFFFFFF);
+        std::uniform_int_distribution<std::size_t> plugin(0, kPluginCount);  // one past the end: unknown plugin
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i <= kPluginCount; ++i) {
+            names.push_back(PluginName(i));
+        }
+
+        const auto& expected = a_expected.GetFormIDRangeIndex();
+        const auto& actual = a_actual.GetFormIDRangeIndex();
+        if (expected.GetRuleCount() != actual.GetRuleCount() || expected.GetRangeCount() != actual.GetRangeCount() ||
+            a_expected.GetKeywordRules().GetNameCount() != a_actual.GetKeywordRules().GetNameCount()) {
+            return false;
+        }
+
+        std::vector<std::pair<const std::string*, std::uint32_t>> queries;
+        for (std::size_t i = 0; i < kQueryCount; ++i) {
+            queries.emplace_back(&names[plugin(rng)], formID(rng));
+        }
+        std::vector<std::optional<FormIDRangeIndex::Range>> found(kQueryCount);
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < kQueryCount; ++i) {
+            found[i] = actual.Find(*queries[i].first, queries[i].second);
+        }
+        a_actualNs = ElapsedMs(start) * 1e6 / kQueryCount;
+
+        for (std::size_t i = 0; i < kQueryCount; ++i) {
+            const auto lhs = expected.Find(*queries[i].first, queries[i].second);
+            const auto& rhs = found[i];
+            if (lhs.has_value() != rhs.has_value() || (lhs && (lhs->min != rhs->min || lhs->max != rhs->max))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--rules") == 0) {
+            options.rules = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--keywords") == 0) {
+            options.keywords = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--files") == 0) {
+            options.files = std::max<std::size_t>(1, std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--runs") == 0) {
+            options.runs = std::max(1, std::atoi(argv[i + 1]));
+        } else {
+            std::fprintf(stderr, "usage: RuleLoadBench [--rules N] [--keywords N] [--files N] [--runs N]\n");
+            return 2;
+        }
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    const auto root = std::filesystem::temp_directory_path() / "RuleLoadBench";
+    const auto jsonPath = root / "DefineHighHeel.json";
+    const auto directory = root / "Rules";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(directory);
+    WriteRules(jsonPath, 0, options, 1);
+    WriteRules(directory, options.files, options, 1);
+
+    bool isOk = true;
+    const Timings single = MeasureLoad(jsonPath, 0, options, isOk);
+    const Timings split = MeasureLoad(directory, options.files, options, isOk);
+
+    HighHeelRules parsed;
+    {
+        std::ifstream in(jsonPath, std::ios::binary);
+        isOk &= parsed.ParseJson(nlohmann::json::parse(in));
+    }
+    HighHeelRules mappedSingle;
+    HighHeelRules mappedSplit;
+    isOk &= mappedSingle.Load(jsonPath) && mappedSplit.Load(directory);
+    double singleNs = 0;
+    double splitNs = 0;
+    const bool agrees = AgreeOnQueries(parsed, mappedSingle, singleNs) && AgreeOnQueries(parsed, mappedSplit, splitNs);
+
+    std::printf("%zu FormID range rule(s), %zu keyword rule(s), %d run(s)\n", options.rules, options.keywords,
+                options.runs);
+    std::printf("%-22s %10s %10s %10s %12s\n", "layout", "cold ms", "warm ms", "stale ms", "lookup ns");
+    std::printf("%-22s %10.2f %10.2f %10.2f %12.1f\n", "1 file", single.coldMs, single.warmMs, single.staleMs,
+                singleNs);
+    char label[32];
+    std::snprintf(label, sizeof(label), "%zu files", options.files);
+    std::printf("%-22s %10.2f %10.2f %10.2f %12.1f\n", label, split.coldMs, split.warmMs, split.staleMs, splitNs);
+    std::printf("merged rules %s the single file\n", agrees ? "match" : "DIFFER FROM");
+    return isOk && agrees ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+# Generates the state table of MorphStateMachine from docs/FSM.csv: the state numbers and the kFeet and kCalves slot
+# of each. The equip/unequip columns are checked for shape only; the plugin resolves an actor's state from everything
+# it wears (MorphStateMachine::FromSlots), never by stepping through events, so they are not generated.
+#
+# Usage: cmake -DFSM_CSV=<path to FSM.csv> -DFSM_HEADER=<output header> -P GenerateFSMTable.cmake
+#
+# Expected layout (as exported from docs/FSM.xlsx):
+#   ,,,Equiping,,,Unequiping,,
+#   State#,kFeet,kCalves,LowHeel,HighHeel,Pantyhose,LowHeel,HighHeel,Pantyhose
+#   <state>,<feet>,<calves>,<next state per event>...
+# Any row whose first cell is not a number is ignored. State 0 (impossible) has empty slots.
+
+cmake_minimum_required(VERSION 3.21)
+
+if(NOT DEFINED FSM_CSV OR NOT DEFINED FSM_HEADER)
+    message(FATAL_ERROR "FSM_CSV and FSM_HEADER must be defined")
+endif()
+
+set(EXPECTED_HEADER "State#;kFeet;kCalves;LowHeel;HighHeel;Pantyhose;LowHeel;HighHeel;Pantyhose")
+set(EVENT_COUNT 6)
+
+file(STRINGS "${FSM_CSV}" FSM_LINES ENCODING UTF-8)
+
+set(HEADER_FOUND FALSE)
+set(STATE_COUNT 0)
+foreach(LINE IN LISTS FSM_LINES)
+    # Only the first line carries the UTF-8 BOM and it is not a state row, so only the CR needs stripping.
+    string(REGEX REPLACE "\r$" "" LINE "${LINE}")
+    string(REPLACE "," ";" CELLS "${LINE}")
+
+    if(CELLS STREQUAL EXPECTED_HEADER)
+        set(HEADER_FOUND TRUE)
+        continue()
+    endif()
+
+    list(GET CELLS 0 STATE)
+    if(NOT STATE MATCHES "^[0-9]+$")
+        continue()
+    endif()
+    if(NOT STATE EQUAL STATE_COUNT)
+        message(FATAL_ERROR
+            "${FSM_CSV}: states must be numbered 0, 1, 2, ... in order, found ${STATE} after ${STATE_COUNT}")
+    endif()
+
+    list(LENGTH CELLS CELL_COUNT)
+    math(EXPR EXPECTED_CELLS "3 + ${EVENT_COUNT}")
+    if(CELL_COUNT LESS EXPECTED_CELLS)
+        message(FATAL_ERROR "${FSM_CSV}: state ${STATE} has ${CELL_COUNT} cells, expected ${EXPECTED_CELLS}")
+    endif()
+
+    list(GET CELLS 1 FEET)
+    list(GET CELLS 2 CALVES)
+    list(APPEND FEET_NAMES "\"${FEET}\"")
+    list(APPEND CALVES_NAMES "\"${CALVES}\"")
+
+    math(EXPR STATE_COUNT "${STATE_COUNT} + 1")
+endforeach()
+
+if(NOT HEADER_FOUND)
+    message(FATAL_ERROR "${FSM_CSV}: column header '${EXPECTED_HEADER}' not found, the table layout changed")
+endif()
+
+list(JOIN FEET_NAMES ", " FEET_NAMES)
+list(JOIN CALVES_NAMES ", " CALVES_NAMES)
+
+set(CONTENT "// Generated by cmake/GenerateFSMTable.cmake from docs/FSM.csv. Do not edit.
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+namespace FSMTable {
+    inline constexpr std::size_t kStateCount = ${STATE_COUNT};
+
+    inline constexpr std::string_view kFeetNames[kStateCount] = {${FEET_NAMES}};
+    inline constexpr std::string_view kCalvesNames[kStateCount] = {${CALVES_NAMES}};
+}
+")
+
+# Only touch the header when it changes so dependent sources are not rebuilt needlessly.
+file(WRITE "${FSM_HEADER}.tmp" "${CONTENT}")
+file(COPY_FILE "${FSM_HEADER}.tmp" "${FSM_HEADER}" ONLY_IF_DIFFERENT)
+file(REMOVE "${FSM_HEADER}.tmp")
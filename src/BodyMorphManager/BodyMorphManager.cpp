@@ -1,8 +1,37 @@
 // src/BodyMorphManager/BodyMorphManager.cpp
 #include "PCH.h"
 #include "BodyMorphManager.h"
+#include <unordered_set>
+#include "HighHeelDetector/HighHeelDetector.h"
+
+namespace {
+    class SerializationCoSave : public ICoSave {
+    public:
+        explicit SerializationCoSave(SKSE::SerializationInterface* a_serialization)
+            : m_serialization(a_serialization) {}
+
+        bool OpenRecord(std::uint32_t a_type, std::uint32_t a_version) override {
+            return m_serialization->OpenRecord(a_type, a_version);
+        }
+        bool WriteRecordData(const void* a_data, std::uint32_t a_length) override {
+            return m_serialization->WriteRecordData(a_data, a_length);
+        }
+        bool GetNextRecordInfo(std::uint32_t& a_type, std::uint32_t& a_version, std::uint32_t& a_length) override {
+            return m_serialization->GetNextRecordInfo(a_type, a_version, a_length);
+        }
+        std::uint32_t ReadRecordData(void* a_data, std::uint32_t a_length) override {
+            return m_serialization->ReadRecordData(a_data, a_length);
+        }
+        bool ResolveFormID(std::uint32_t a_oldFormID, std::uint32_t& a_newFormID) override {
+            return m_serialization->ResolveFormID(a_oldFormID, a_newFormID);
+        }
+
+    private:
+        SKSE::SerializationInterface* m_serialization;
+    };
+}
 
-BodyMorphManager::BodyMorphManager() : m_bodyMorphInterface(nullptr) {}
+BodyMorphManager::BodyMorphManager() : m_bodyMorphInterface(nullptr), m_morphApplier(*this) {}
 
 BodyMorphManager& BodyMorphManager::GetSingleton() {
     static BodyMorphManager instance;
@@ -51,39 +80,124 @@ bool BodyMorphManager::Init() {
     return true;
 }
 
-void BodyMorphManager::UpdateHighHeelMorph(RE::Actor* a_actor, bool isHighHeel) {
-    SKSE::log::trace(">>>> Entering BodyMorphManager::UpdateHighHeelMorph");
+void BodyMorphManager::ResetAppliedMorphs() { m_morphApplier.ResetAppliedMorphs(); }
 
-    if (!a_actor) {
-        SKSE::log::warn("BodyMorphManager::UpdateHighHeelMorph - Actor is null");
-        SKSE::log::trace("<<<< Exiting BodyMorphManager::UpdateHighHeelMorph (no actor)");
+void BodyMorphManager::PruneAppliedMorphsIfDue() {
+    const auto now = std::chrono::steady_clock::now();
+    if (!m_bodyMorphInterface || now < m_nextPrune) {
         return;
     }
+    SKSE::log::trace(">>>> Entering BodyMorphManager::PruneAppliedMorphsIfDue");
+    m_nextPrune = now + kPruneInterval;
+
+    class ActorCollector : public SKEE::IBodyMorphInterface::ActorVisitor {
+    public:
+        void Visit(RE::TESObjectREFR* a_refr) override {
+            if (a_refr) {
+                formIDs.insert(a_refr->GetFormID());
+            }
+        }
+        std::unordered_set<RE::FormID> formIDs;
+    } collector;
+    m_bodyMorphInterface->VisitActors(collector);
+
+    // An actor that is forgotten but still around only costs a few morph queries on its next update.
+    const std::size_t forgotten = m_morphApplier.RetainActors(
+        [&collector](std::uint32_t a_formID) { return collector.formIDs.contains(a_formID); });
+    const auto stats = m_morphApplier.GetStateStats();
+    SKSE::log::info("Forgot {} actor(s) without SKEE morphs. Actor state: {} of {} slot(s), {:.1f} KiB, {} "
+                    "eviction(s).",
+                    forgotten, stats.size, stats.capacity, stats.memoryUsage / 1024.0, stats.evictions);
+    SKSE::log::trace("<<<< Exiting BodyMorphManager::PruneAppliedMorphsIfDue");
+}
+
+void BodyMorphManager::OnGameSaved(SKSE::SerializationInterface* a_serialization) {
+    SKSE::log::trace(">>>> Entering BodyMorphManager::OnGameSaved");
+
+    SerializationCoSave coSave(a_serialization);
+    const auto states = GetSingleton().m_morphApplier.GetCommittedStates();
+    if (!MorphStateRecord::Write(coSave, HighHeelDetector::GetSingleton().GetClassifier().GetRuleHash(), states)) {
+        SKSE::log::error("BodyMorphManager::OnGameSaved - Failed to write the morph state record");
+    } else {
+        SKSE::log::info("Saved the morph state of {} actor(s).", states.size());
+    }
 
-    const char* actorName = a_actor->GetName() ? a_actor->GetName() : "unnamed";
-    SKSE::log::trace("BodyMorphManager::UpdateHighHeelMorph - Actor: {}", actorName);
+    SKSE::log::trace("<<<< Exiting BodyMorphManager::OnGameSaved");
+}
 
+void BodyMorphManager::OnGameLoaded(SKSE::SerializationInterface* a_serialization) {
+    SKSE::log::trace(">>>> Entering BodyMorphManager::OnGameLoaded");
+
+    SerializationCoSave coSave(a_serialization);
+    const std::uint64_t ruleHash = HighHeelDetector::GetSingleton().GetClassifier().GetRuleHash();
+    std::uint32_t type = 0;
+    std::uint32_t version = 0;
+    std::uint32_t length = 0;
+    while (coSave.GetNextRecordInfo(type, version, length)) {
+        if (type != MorphStateRecord::kType) {
+            SKSE::log::warn("BodyMorphManager::OnGameLoaded - Skipping unknown co-save record {:#x}", type);
+            continue;
+        }
+        std::vector<MorphStateRecord::Entry> states;
+        const auto result = MorphStateRecord::Read(coSave, version, length, ruleHash, states);
+        switch (result.status) {
+            case MorphStateRecord::Status::kLoaded:
+                GetSingleton().m_morphApplier.RestoreAppliedStates(states);
+                SKSE::log::info("Restored the morph state of {} actor(s); {} belonged to plugins no longer loaded.",
+                                states.size(), result.dropped);
+                break;
+            case MorphStateRecord::Status::kStale:
+                SKSE::log::info("The high heel rules changed since the save; every actor will be re-evaluated.");
+                break;
+            case MorphStateRecord::Status::kUnsupported:
+                SKSE::log::warn("Morph state record version {} is not supported; every actor will be re-evaluated.",
+                                version);
+                break;
+            case MorphStateRecord::Status::kCorrupt:
+                SKSE::log::error("Morph state record is corrupt; every actor will be re-evaluated.");
+                break;
+        }
+    }
+
+    SKSE::log::trace("<<<< Exiting BodyMorphManager::OnGameLoaded");
+}
+
+ActorHandle BodyMorphManager::MakeActorHandle(RE::Actor* a_actor) {
+    return {a_actor ? a_actor->GetFormID() : 0, a_actor};
+}
+
+void BodyMorphManager::SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                                float a_value) {
     if (!m_bodyMorphInterface) {
-        SKSE::log::error("BodyMorphManager::UpdateHighHeelMorph - BodyMorph interface not available");
-        SKSE::log::trace("<<<< Exiting BodyMorphManager::UpdateHighHeelMorph (no interface)");
         return;
     }
+    m_bodyMorphInterface->SetMorph(static_cast<RE::Actor*>(a_actor.native), a_morphName, a_morphKey, a_value);
+}
 
-    // clear lagacy morph with lagacy morph key
-    SKSE::log::trace("BodyMorphManager::UpdateHighHeelMorph - Clearing legacy morph keys");
-    m_bodyMorphInterface->ClearMorph(a_actor, "NoHeel", "CH_AdeptivePantyhoseMorphKey");
-
-    m_bodyMorphInterface->ClearMorph(a_actor, "NoHeel", "AdeptivePantyhoseMorphKey");
+void BodyMorphManager::ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) {
+    if (!m_bodyMorphInterface) {
+        return;
+    }
+    m_bodyMorphInterface->ClearMorph(static_cast<RE::Actor*>(a_actor.native), a_morphName, a_morphKey);
+}
 
-    if (!isHighHeel) {
-        SKSE::log::trace("BodyMorphManager::UpdateHighHeelMorph - Applying NoHeel morph");
-        m_bodyMorphInterface->SetMorph(a_actor, "NoHeel", "AdeptivePantyhoseMorphKey", 1.0f);
-    } else {
-        SKSE::log::trace("BodyMorphManager::UpdateHighHeelMorph - Clearing NoHeel morph");
+bool BodyMorphManager::HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) {
+    if (!m_bodyMorphInterface) {
+        return false;
     }
+    return m_bodyMorphInterface->HasBodyMorphKey(static_cast<RE::Actor*>(a_actor.native), a_morphKey);
+}
 
-    SKSE::log::trace("BodyMorphManager::UpdateHighHeelMorph - Updating model weight");
-    m_bodyMorphInterface->UpdateModelWeight(a_actor);
+float BodyMorphManager::GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) {
+    if (!m_bodyMorphInterface) {
+        return 0.0f;
+    }
+    return m_bodyMorphInterface->GetMorph(static_cast<RE::Actor*>(a_actor.native), a_morphName, a_morphKey);
+}
 
-    SKSE::log::trace("<<<< Exiting BodyMorphManager::UpdateHighHeelMorph");
+void BodyMorphManager::ApplyBodyMorphs(const ActorHandle& a_actor, bool a_deferUpdate) {
+    if (!m_bodyMorphInterface) {
+        return;
+    }
+    m_bodyMorphInterface->ApplyBodyMorphs(static_cast<RE::Actor*>(a_actor.native), a_deferUpdate);
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 // src/BodyMorphManager/BodyMorphManager.h
 #pragma once
+#include <chrono>
 #include "SKEE/IPluginInterface.h"
+#include "Core/MorphApplier.h"
 
-class BodyMorphManager {
+class BodyMorphManager : public IMorphBackend {
 private:
     BodyMorphManager();
     ~BodyMorphManager() = default;
@@ -11,10 +13,33 @@ private:
     BodyMorphManager& operator=(const BodyMorphManager&) = delete;
     BodyMorphManager& operator=(BodyMorphManager&&) = delete;
 
+    static constexpr std::chrono::minutes kPruneInterval{5};
+
     SKEE::IBodyMorphInterface* m_bodyMorphInterface;
+    MorphApplier m_morphApplier;
+    std::chrono::steady_clock::time_point m_nextPrune{};
 
 public:
+    static constexpr std::uint32_t kCoSaveID = 0x41504853;  // 'APHS'
+
     static BodyMorphManager& GetSingleton();
     bool Init();
-    void UpdateHighHeelMorph(RE::Actor* a_actor, bool isHighHeel);
+    void ResetAppliedMorphs();
+    // Forgets the applied state of actors SKEE no longer has morphs for, at most once per kPruneInterval. Game
+    // thread only.
+    void PruneAppliedMorphsIfDue();
+    MorphApplier& GetMorphApplier() { return m_morphApplier; }
+    // SKSE co-save callbacks: save the committed morph states with the game and restore them on load, under the
+    // current rule hash.
+    static void OnGameSaved(SKSE::SerializationInterface* a_serialization);
+    static void OnGameLoaded(SKSE::SerializationInterface* a_serialization);
+
+    static ActorHandle MakeActorHandle(RE::Actor* a_actor);
+
+    void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                  float a_value) override;
+    void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override;
+    bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override;
+    float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override;
+    void ApplyBodyMorphs(const ActorHandle& a_actor, bool a_deferUpdate) override;
 };
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "ActorStateStore.h"
+#include <algorithm>
+
+ActorStateStore::ActorStateStore(std::size_t a_memoryCap) : m_shards(std::make_unique<Shard[]>(kShardCount)) {
+    const std::size_t fixed = sizeof(ActorStateStore) + sizeof(Shard) * kShardCount;
+    const std::size_t buckets = a_memoryCap > fixed ? (a_memoryCap - fixed) / sizeof(Bucket) : 0;
+    m_bucketCount = std::max(buckets, kShardCount);
+    m_buckets = std::make_unique<Bucket[]>(m_bucketCount);
+}
+
+std::optional<std::uint8_t> ActorStateStore::Find(std::uint32_t a_formID) const {
+    if (a_formID == 0) {
+        return std::nullopt;
+    }
+    const Bucket& bucket = m_buckets[GetBucketIndex(a_formID)];
+    for (const auto& slot : bucket.slots) {
+        const std::uint64_t entry = slot.load(std::memory_order_acquire);
+        if ((entry >> 32) == a_formID) {
+            return static_cast<std::uint8_t>(entry);
+        }
+    }
+    return std::nullopt;
+}
+
+void ActorStateStore::Store(std::uint32_t a_formID, std::uint8_t a_value) {
+    if (a_formID == 0) {
+        return;
+    }
+    const std::size_t index = GetBucketIndex(a_formID);
+    Bucket& bucket = m_buckets[index];
+    Shard& shard = GetShard(index);
+
+    std::scoped_lock lock(shard.lock);
+    const std::uint32_t now = ++shard.clock & kStampMask;
+    const std::uint64_t desired = Pack(a_formID, now, a_value);
+
+    // The actor's own slot if it has one, else the first free slot, else the one written longest ago.
+    std::atomic<std::uint64_t>* free = nullptr;
+    std::atomic<std::uint64_t>* oldest = nullptr;
+    std::uint32_t oldestAge = 0;
+    for (auto& slot : bucket.slots) {
+        const std::uint64_t entry = slot.load(std::memory_order_relaxed);
+        if ((entry >> 32) == a_formID) {
+            slot.store(desired, std::memory_order_release);
+            return;
+        }
+        if (entry == 0) {
+            free = free ? free : &slot;
+            continue;
+        }
+        const std::uint32_t age = (now - static_cast<std::uint32_t>(entry >> 8)) & kStampMask;
+        if (!oldest || age > oldestAge) {
+            oldest = &slot;
+            oldestAge = age;
+        }
+    }
+
+    if (free) {
+        free->store(desired, std::memory_order_release);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    oldest->store(desired, std::memory_order_release);
+    m_evictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ActorStateStore::Erase(std::uint32_t a_formID) {
+    if (a_formID == 0) {
+        return false;
+    }
+    const std::size_t index = GetBucketIndex(a_formID);
+    Bucket& bucket = m_buckets[index];
+
+    std::scoped_lock lock(GetShard(index).lock);
+    for (auto& slot : bucket.slots) {
+        if ((slot.load(std::memory_order_relaxed) >> 32) == a_formID) {
+            slot.store(0, std::memory_order_release);
+            m_size.fetch_sub(1, std::memory_order_relaxed);
+            m_removals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t ActorStateStore::EraseIf(const std::function<bool(std::uint32_t)>& a_predicate) {
+    std::size_t erased = 0;
+    for (std::size_t shard = 0; shard < kShardCount; ++shard) {
+        std::scoped_lock lock(m_shards[shard].lock);
+        for (std::size_t index = shard; index < m_bucketCount; index += kShardCount) {
+            for (auto& slot : m_buckets[index].slots) {
+                const std::uint64_t entry = slot.load(std::memory_order_relaxed);
+                if (entry != 0 && a_predicate(static_cast<std::uint32_t>(entry >> 32))) {
+                    slot.store(0, std::memory_order_release);
+                    ++erased;
+                }
+            }
+        }
+    }
+    m_size.fetch_sub(erased, std::memory_order_relaxed);
+    m_removals.fetch_add(erased, std::memory_order_relaxed);
+    return erased;
+}
+
+void ActorStateStore::Clear() {
+    for (std::size_t shard = 0; shard < kShardCount; ++shard) {
+        std::scoped_lock lock(m_shards[shard].lock);
+        std::size_t cleared = 0;
+        for (std::size_t index = shard; index < m_bucketCount; index += kShardCount) {
+            for (auto& slot : m_buckets[index].slots) {
+                cleared += slot.exchange(0, std::memory_order_release) != 0 ? 1 : 0;
+            }
+        }
+        m_size.fetch_sub(cleared, std::memory_order_relaxed);
+    }
+}
+
+void ActorStateStore::ForEach(const std::function<void(std::uint32_t, std::uint8_t)>& a_visitor) const {
+    for (std::size_t shard = 0; shard < kShardCount; ++shard) {
+        std::scoped_lock lock(m_shards[shard].lock);
+        for (std::size_t index = shard; index < m_bucketCount; index += kShardCount) {
+            for (const auto& slot : m_buckets[index].slots) {
+                const std::uint64_t entry = slot.load(std::memory_order_relaxed);
+                if (entry != 0) {
+                    a_visitor(static_cast<std::uint32_t>(entry >> 32), static_cast<std::uint8_t>(entry));
+                }
+            }
+        }
+    }
+}
+
+std::size_t ActorStateStore::GetMemoryUsage() const {
+    return sizeof(*this) + sizeof(Shard) * kShardCount + sizeof(Bucket) * m_bucketCount;
+}
+
+ActorStateStore::Stats ActorStateStore::GetStats() const {
+    return {GetSize(), GetCapacity(), GetMemoryUsage(), m_evictions.load(std::memory_order_relaxed),
+            m_removals.load(std::memory_order_relaxed)};
+}
+
+std::uint64_t ActorStateStore::Pack(std::uint32_t a_formID, std::uint32_t a_stamp, std::uint8_t a_value) {
+    return (std::uint64_t{a_formID} << 32) | (std::uint64_t{a_stamp & kStampMask} << 8) | a_value;
+}
+
+std::size_t ActorStateStore::GetBucketIndex(std::uint32_t a_formID) const {
+    // Fibonacci hash to 32 bits, then scaled onto [0, m_bucketCount) without a division.
+    const std::uint64_t hash = (std::uint64_t{a_formID} * 0x9E3779B97F4A7C15ull) >> 32;
+    return static_cast<std::size_t>((hash * m_bucketCount) >> 32);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+// Per-actor state keyed by FormID, in a fixed amount of memory.
+//
+// Packed 64-bit slots (FormID in the high half; a 24-bit age stamp and an 8-bit value in the low half) grouped into
+// buckets of one cache line. The values are MorphStateMachine states, so a byte holds them and the rest of the low
+// half goes to the stamp: a shard takes 16 million writes before an old entry can pass for a new one. An actor lives
+// in one slot of its home bucket, so a lookup is a scan of eight atomic loads and never blocks. Writers lock one of
+// kShardCount shards, each owning every kShardCount-th bucket, which keeps an actor from being inserted twice and
+// lets writers to different shards run in parallel.
+//
+// The table never grows. When an actor's home bucket is full, the entry written longest ago is evicted, so the
+// memory cap given to the constructor is a hard one. Callers keep only state they can rebuild: an evicted actor
+// simply reads as unknown.
+//
+// A lookup racing with an erase and re-insert of the same actor may miss it, as if it ran just before the insert.
+class ActorStateStore {
+public:
+    struct Stats {
+        std::size_t size{};
+        std::size_t capacity{};
+        std::size_t memoryUsage{};  // bytes, fixed at construction
+        std::uint64_t evictions{};  // entries dropped to make room
+        std::uint64_t removals{};   // entries erased by the owner
+    };
+
+    static constexpr std::size_t kDefaultMemoryCap = 128 * 1024;
+
+    // Takes as many buckets as fit in a_memoryCap bytes, and at least one per shard.
+    explicit ActorStateStore(std::size_t a_memoryCap = kDefaultMemoryCap);
+
+    std::optional<std::uint8_t> Find(std::uint32_t a_formID) const;
+    // Inserts or overwrites. FormID 0 is never stored.
+    void Store(std::uint32_t a_formID, std::uint8_t a_value);
+    bool Erase(std::uint32_t a_formID);
+    // Erases every actor a_predicate returns true for, one shard at a time. a_predicate runs under the shard's lock
+    // and must not call back into the store. Returns the number erased.
+    std::size_t EraseIf(const std::function<bool(std::uint32_t)>& a_predicate);
+    void Clear();
+    // Calls a_visitor with every actor and its value, one shard at a time under the shard's lock. a_visitor must not
+    // call back into the store.
+    void ForEach(const std::function<void(std::uint32_t, std::uint8_t)>& a_visitor) const;
+
+    std::size_t GetSize() const { return m_size.load(std::memory_order_relaxed); }
+    std::size_t GetCapacity() const { return m_bucketCount * kSlotsPerBucket; }
+    std::size_t GetMemoryUsage() const;
+    Stats GetStats() const;
+
+private:
+    static constexpr std::size_t kSlotsPerBucket = 8;
+    static constexpr std::size_t kShardCount = 64;
+    static constexpr std::uint32_t kStampMask = 0xFFFFFF;
+
+    struct alignas(64) Bucket {
+        std::array<std::atomic<std::uint64_t>, kSlotsPerBucket> slots{};
+    };
+    static_assert(sizeof(Bucket) == 64);
+
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::uint32_t clock{};  // advances on every write to the shard; stamps record its low 24 bits
+    };
+
+    static std::uint64_t Pack(std::uint32_t a_formID, std::uint32_t a_stamp, std::uint8_t a_value);
+    std::size_t GetBucketIndex(std::uint32_t a_formID) const;
+    Shard& GetShard(std::size_t a_bucketIndex) const { return m_shards[a_bucketIndex % kShardCount]; }
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    std::size_t m_bucketCount;
+    std::unique_ptr<Shard[]> m_shards;
+    std::atomic<std::size_t> m_size{0};
+    std::atomic<std::uint64_t> m_evictions{0};
+    std::atomic<std::uint64_t> m_removals{0};
+};
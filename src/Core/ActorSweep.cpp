@@ -0,0 +1,92 @@
+#include "ActorSweep.h"
+#include "DeferredLog.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+bool ActorSweep::Enqueue(std::span<const Target> a_targets) {
+    std::scoped_lock lock(m_lock);
+    if (a_targets.empty()) {
+        return false;
+    }
+    if (!m_isFramePending) {
+        m_stats = {};
+    }
+    m_pending.insert(m_pending.end(), a_targets.begin(), a_targets.end());
+    m_isSorted = false;
+
+    const bool isScheduleNeeded = !m_isFramePending;
+    m_isFramePending = true;
+    return isScheduleNeeded;
+}
+
+bool ActorSweep::RunFrame() {
+    AP_LOG_TRACE(">>>> Entering ActorSweep::RunFrame");
+
+    std::size_t checked = 0;
+    std::size_t updated = 0;
+    while (updated < m_budget.updates && checked < m_budget.checks) {
+        Target target;
+        {
+            std::scoped_lock lock(m_lock);
+            if (m_pending.empty()) {
+                break;
+            }
+            if (!m_isSorted) {
+                SortPending();
+            }
+            target = m_pending.back();
+            m_pending.pop_back();
+        }
+
+        ++checked;
+        // The actor may have been unloaded since it was queued.
+        const ActorHandle actor = m_armorLookup.LookupActor(target.formID);
+        if (!actor) {
+            AP_LOG_TRACE("ActorSweep::RunFrame - Actor {:#x} no longer exists, skipping", target.formID);
+            continue;
+        }
+        if (m_pipeline.Sync(actor)) {
+            ++updated;
+        }
+    }
+
+    std::scoped_lock lock(m_lock);
+    m_stats.checked += checked;
+    m_stats.updated += updated;
+    ++m_stats.frames;
+    m_isFramePending = !m_pending.empty();
+    if (!m_isFramePending) {
+        spdlog::info("Actor sweep finished: {} actor(s) checked, {} updated, over {} frame(s).", m_stats.checked,
+                     m_stats.updated, m_stats.frames);
+    }
+
+    AP_LOG_TRACE("<<<< Exiting ActorSweep::RunFrame (checked: {}, updated: {})", checked, updated);
+    return m_isFramePending;
+}
+
+void ActorSweep::Clear() {
+    std::scoped_lock lock(m_lock);
+    m_pending.clear();
+    m_isSorted = true;
+}
+
+std::size_t ActorSweep::GetPendingCount() const {
+    std::scoped_lock lock(m_lock);
+    return m_pending.size();
+}
+
+ActorSweep::Stats ActorSweep::GetStats() const {
+    std::scoped_lock lock(m_lock);
+    return m_stats;
+}
+
+void ActorSweep::SortPending() {
+    // Keep the nearest entry of every actor, then order the queue farthest first.
+    std::ranges::sort(m_pending, [](const Target& a_lhs, const Target& a_rhs) {
+        return a_lhs.formID != a_rhs.formID ? a_lhs.formID < a_rhs.formID : a_lhs.distance < a_rhs.distance;
+    });
+    const auto duplicates = std::ranges::unique(m_pending, {}, &Target::formID);
+    m_pending.erase(duplicates.begin(), duplicates.end());
+    std::ranges::sort(m_pending, std::ranges::greater{}, &Target::distance);
+    m_isSorted = true;
+}
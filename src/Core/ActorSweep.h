@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "Adapters.h"
+#include "EquipPipeline.h"
+
+// Re-evaluates whole groups of actors, such as everything loaded after a game load or a cell attach, without
+// rebuilding all their meshes in the same frame.
+//
+// Enqueue() only records who to look at and how far from the camera they are. Each RunFrame() then works through the
+// queue nearest first and stops after Budget::updates morph writes (each one an ApplyBodyMorphs) or Budget::checks
+// actors, whichever comes first. Actors whose morphs already match cost a check but no update. The owner runs one
+// RunFrame() per frame for as long as it returns true; the plugin does that through the SKSE task queue.
+class ActorSweep {
+public:
+    struct Target {
+        std::uint32_t formID{};
+        float distance{};  // to the camera
+    };
+
+    struct Budget {
+        std::size_t updates = 4;
+        std::size_t checks = 64;
+    };
+
+    // Of the sweep in progress, or of the last one once the queue has drained.
+    struct Stats {
+        std::size_t checked{};
+        std::size_t updated{};
+        std::size_t frames{};
+    };
+
+    ActorSweep(IArmorLookup& a_armorLookup, EquipPipeline& a_pipeline)
+        : ActorSweep(a_armorLookup, a_pipeline, Budget{}) {}
+    ActorSweep(IArmorLookup& a_armorLookup, EquipPipeline& a_pipeline, Budget a_budget)
+        : m_armorLookup(a_armorLookup), m_pipeline(a_pipeline), m_budget(a_budget) {}
+
+    // An actor queued twice is checked once, at the nearer distance. Returns true when no frame is scheduled yet,
+    // meaning the caller has to schedule RunFrame().
+    bool Enqueue(std::span<const Target> a_targets);
+    // Returns true when actors are left and the caller has to schedule another frame.
+    bool RunFrame();
+    // Drops every queued actor, e.g. when another game is loaded. A frame already scheduled finds nothing to do.
+    void Clear();
+
+    std::size_t GetPendingCount() const;
+    Stats GetStats() const;
+    const Budget& GetBudget() const { return m_budget; }
+
+private:
+    // Nearest last, so RunFrame() pops from the back.
+    void SortPending();
+
+    IArmorLookup& m_armorLookup;
+    EquipPipeline& m_pipeline;
+    Budget m_budget;
+
+    mutable std::mutex m_lock;
+    std::vector<Target> m_pending;
+    bool m_isSorted{true};
+    bool m_isFramePending{false};
+    Stats m_stats;
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The only things the core needs from the game. The plugin implements these on top of CommonLibSSE and SKEE; the
+// host-side benchmarks implement them with fakes.
+
+// An actor as the core sees it. native is whatever the adapter needs to talk to the engine (an RE::Actor* in the
+// plugin) and is never dereferenced by the core; it is null when the actor no longer exists.
+struct ActorHandle {
+    std::uint32_t formID{};
+    void* native{};
+
+    explicit operator bool() const { return native != nullptr; }
+};
+
+// What the rules match an armor on, for classifying many at once. Same meaning and lifetimes as in ArmorInfo.
+struct ArmorKey {
+    std::string_view plugin{};
+    std::uint32_t localFormID{};
+    std::span<const std::uint32_t> keywords{};
+    std::string_view name{};
+    std::span<const std::string_view> modelPaths{};
+};
+
+// The parts of a TESObjectARMO the rules look at.
+struct ArmorInfo {
+    std::uint32_t formID{};
+    std::string_view plugin{};  // file that defines the armor, empty for forms created at runtime
+    std::uint32_t localFormID{};
+    std::span<const std::uint32_t> keywords{};  // keyword FormIDs, owned by the adapter
+    bool coversFeet{};
+    bool coversCalves{};
+    bool isDynamic{};  // 0xFF forms, whose FormIDs get recycled
+    std::string_view name{};                         // display name, empty when the armor has none
+    std::span<const std::string_view> modelPaths{};  // of its armor addons; the span is owned like keywords
+
+    ArmorKey GetKey() const { return {plugin, localFormID, keywords, name, modelPaths}; }
+};
+
+// Every armor of the load order that covers the feet, collected by the adapter once the data is loaded. Rebuilds
+// read it from the rule watcher's thread, so it should own what it points to: plugin names, armor names and model
+// paths into text, keyword spans into keywords and model path spans into modelPaths.
+struct ArmorCatalog {
+    std::vector<ArmorInfo> armors;
+    std::vector<std::uint32_t> keywords;
+    std::vector<std::string_view> modelPaths;
+    std::string text;
+};
+
+enum class ArmorSlot : std::uint8_t { kFeet, kCalves };
+
+class IArmorLookup {
+public:
+    virtual ~IArmorLookup() = default;
+
+    // Fill a_out for a base form. Returns false when the form does not exist or is not armor. The keyword span
+    // stays valid until the next call on the same thread.
+    virtual bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) = 0;
+    virtual ActorHandle LookupActor(std::uint32_t a_formID) = 0;
+    // Returns false when the slot is empty.
+    virtual bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) = 0;
+};
+
+// Mirrors the subset of SKEE::IBodyMorphInterface the plugin uses.
+class IMorphBackend {
+public:
+    virtual ~IMorphBackend() = default;
+
+    virtual void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                          float a_value) = 0;
+    virtual void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) = 0;
+    // True when the actor carries any morph under a_morphKey.
+    virtual bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) = 0;
+    // Returns 0 for a morph the actor does not carry.
+    virtual float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) = 0;
+    // Applies the actor's morphs. With a_deferUpdate, SKEE queues the mesh rebuild instead of doing it right away.
+    virtual void ApplyBodyMorphs(const ActorHandle& a_actor, bool a_deferUpdate) = 0;
+};
+
+// Mirrors the subset of SKSE::SerializationInterface the plugin uses: records of the co-save, which SKSE writes and
+// reads alongside the game's save.
+class ICoSave {
+public:
+    virtual ~ICoSave() = default;
+
+    virtual bool OpenRecord(std::uint32_t a_type, std::uint32_t a_version) = 0;
+    virtual bool WriteRecordData(const void* a_data, std::uint32_t a_length) = 0;
+    // Moves to the next record, skipping whatever of the current one was not read. Returns false after the last.
+    virtual bool GetNextRecordInfo(std::uint32_t& a_type, std::uint32_t& a_version, std::uint32_t& a_length) = 0;
+    // Returns the number of bytes read, short at the end of the record.
+    virtual std::uint32_t ReadRecordData(void* a_data, std::uint32_t a_length) = 0;
+    // Maps a FormID of the session that saved to the current load order. Returns false when its plugin is gone.
+    virtual bool ResolveFormID(std::uint32_t a_oldFormID, std::uint32_t& a_newFormID) = 0;
+};
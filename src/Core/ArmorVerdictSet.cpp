@@ -0,0 +1,55 @@
+#include "ArmorVerdictSet.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "ParallelFor.h"
+
+void ArmorVerdictSet::Build(std::span<const ArmorInfo> a_armors, const ClassifyBatch& a_classify) {
+    Clear();
+
+    std::vector<std::uint32_t> formIDs;
+    formIDs.reserve(a_armors.size());
+    for (const auto& armor : a_armors) {
+        formIDs.push_back(armor.formID);
+    }
+    m_bits.Reset(formIDs);
+
+    // Armors of one plugin sit next to each other in the catalog, so neighbouring chunks rarely share a word.
+    constexpr std::size_t kChunkSize = 1024;
+    std::atomic<std::size_t> armorCount{0};
+    std::atomic<std::size_t> highHeelCount{0};
+    ParallelFor((a_armors.size() + kChunkSize - 1) / kChunkSize, [&](std::size_t a_chunk) {
+        const std::size_t begin = a_chunk * kChunkSize;
+        const std::size_t end = std::min(begin + kChunkSize, a_armors.size());
+        std::vector<ArmorKey> keys(end - begin);
+        std::vector<std::uint8_t> verdicts(end - begin);
+        for (std::size_t i = begin; i < end; ++i) {
+            keys[i - begin] = a_armors[i].GetKey();
+        }
+        a_classify(keys, verdicts);
+
+        std::size_t armors = 0;
+        std::size_t highHeels = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint32_t formID = a_armors[i].formID;
+            if (!m_bits.Covers(formID)) {
+                continue;
+            }
+            ++armors;
+            if (verdicts[i - begin]) {
+                ++highHeels;
+                m_bits.Insert(formID);
+            }
+        }
+        armorCount.fetch_add(armors, std::memory_order_relaxed);
+        highHeelCount.fetch_add(highHeels, std::memory_order_relaxed);
+    });
+    m_armorCount = armorCount.load(std::memory_order_relaxed);
+    m_highHeelCount = highHeelCount.load(std::memory_order_relaxed);
+}
+
+void ArmorVerdictSet::Clear() {
+    m_bits.Clear();
+    m_armorCount = 0;
+    m_highHeelCount = 0;
+}
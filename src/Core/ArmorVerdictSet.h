@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include "Adapters.h"
+#include "FormIDBitset.h"
+
+// Verdicts for every armor of an ArmorCatalog, computed up front, one bit per FormID in a FormIDBitset sized to the
+// catalog. Find() is two array reads and a bit test.
+class ArmorVerdictSet {
+public:
+    // Sets a_out[i] to 1 when a_keys[i] is a high heel, else 0.
+    using ClassifyBatch = std::function<void(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out)>;
+
+    // Classifies a_armors in parallel, a chunk per call. a_classify must be safe to call from several threads at once.
+    void Build(std::span<const ArmorInfo> a_armors, const ClassifyBatch& a_classify);
+    void Clear();
+
+    // The verdict of a cataloged armor. nullopt outside every segment, e.g. for dynamic forms; inside a segment a
+    // FormID that was not cataloged reads as false, so only ask for armors that cover the feet.
+    std::optional<bool> Find(std::uint32_t a_formID) const { return m_bits.Find(a_formID); }
+
+    bool IsEmpty() const { return m_armorCount == 0; }
+    std::size_t GetArmorCount() const { return m_armorCount; }
+    std::size_t GetHighHeelCount() const { return m_highHeelCount; }
+    std::size_t GetSegmentCount() const { return m_bits.GetSegmentCount(); }
+    std::size_t GetMemoryUsage() const { return m_bits.GetMemoryUsage(); }  // bytes
+
+private:
+    FormIDBitset m_bits;
+    std::size_t m_armorCount{};
+    std::size_t m_highHeelCount{};
+};
@@ -0,0 +1,176 @@
+#include "DeferredLog.h"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t kCacheLine = 64;
+
+    // Single producer (the owning thread), single consumer (whoever drains, under g_drainLock).
+    struct Ring {
+        alignas(kCacheLine) std::atomic<std::uint64_t> head{0};
+        alignas(kCacheLine) std::atomic<std::uint64_t> tail{0};
+        alignas(kCacheLine) std::atomic<std::uint64_t> dropped{0};
+        std::atomic<bool> isOrphaned{false};
+        std::unique_ptr<DeferredLog::Record[]> records{new DeferredLog::Record[DeferredLog::kRingCapacity]};
+    };
+
+    std::mutex g_ringsLock;
+    std::vector<std::shared_ptr<Ring>> g_rings;
+
+    std::mutex g_drainLock;
+    std::uint64_t g_written = 0;  // guarded by g_drainLock
+    std::uint64_t g_retiredDropped = 0;
+
+    std::mutex g_threadLock;
+    std::condition_variable g_threadWake;
+    std::thread g_thread;
+    bool g_isStopping = false;
+
+    // Registers the ring on the thread's first record and marks it for removal when the thread exits.
+    struct RingOwner {
+        std::shared_ptr<Ring> ring = std::make_shared<Ring>();
+
+        RingOwner() {
+            std::scoped_lock lock(g_ringsLock);
+            g_rings.push_back(ring);
+        }
+        ~RingOwner() { ring->isOrphaned.store(true, std::memory_order_release); }
+    };
+
+    Ring& LocalRing() {
+        thread_local RingOwner owner;
+        return *owner.ring;
+    }
+
+}
+
+DeferredLog::Record* DeferredLog::Acquire() {
+    Ring& ring = LocalRing();
+    const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= kRingCapacity) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring.records[head % kRingCapacity];
+}
+
+void DeferredLog::Publish() {
+    Ring& ring = LocalRing();
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void DeferredLog::EncodeText(Record& a_record, std::size_t& a_offset, std::size_t& a_textBudget,
+                             std::string_view a_text) {
+    const std::size_t length = std::min({a_text.size(), a_textBudget, std::size_t{255}});
+    a_record.payload[a_offset] = static_cast<std::byte>(length);
+    std::memcpy(a_record.payload + a_offset + 1, a_text.data(), length);
+    a_offset += 1 + length;
+    a_textBudget -= length;
+}
+
+void DeferredLog::Drain() {
+    std::scoped_lock drainLock(g_drainLock);
+    DrainLocked();
+}
+
+bool DeferredLog::TryDrain() {
+    std::unique_lock drainLock(g_drainLock, std::try_to_lock);
+    if (!drainLock) {
+        return false;
+    }
+    DrainLocked();
+    return true;
+}
+
+void DeferredLog::DrainLocked() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::scoped_lock lock(g_ringsLock);
+        rings = g_rings;
+    }
+
+    // Per-thread order is already right; merging by timestamp keeps lines from different threads in order too.
+    std::vector<const Record*> pending;
+    std::vector<std::uint64_t> heads(rings.size());
+    for (std::size_t i = 0; i < rings.size(); ++i) {
+        Ring& ring = *rings[i];
+        heads[i] = ring.head.load(std::memory_order_acquire);
+        for (std::uint64_t pos = ring.tail.load(std::memory_order_relaxed); pos != heads[i]; ++pos) {
+            pending.push_back(&ring.records[pos % kRingCapacity]);
+        }
+    }
+    std::ranges::stable_sort(pending, {}, &Record::timestamp);
+
+    auto* logger = spdlog::default_logger_raw();
+    for (const Record* record : pending) {
+        const Site& site = *record->site;
+        std::string message;
+        try {
+            message = record->decoder(site, *record);
+        } catch (const std::exception& e) {
+            message = std::string("bad log format '") + site.format + "': " + e.what();
+        }
+        const std::chrono::system_clock::time_point time{std::chrono::system_clock::duration(record->timestamp)};
+        logger->log(time, spdlog::source_loc{site.file, site.line, nullptr}, site.level, message);
+    }
+    g_written += pending.size();
+
+    for (std::size_t i = 0; i < rings.size(); ++i) {
+        rings[i]->tail.store(heads[i], std::memory_order_release);
+    }
+
+    // A finished thread's ring goes once it has been emptied.
+    std::scoped_lock lock(g_ringsLock);
+    std::erase_if(g_rings, [&](const std::shared_ptr<Ring>& a_ring) {
+        if (!a_ring->isOrphaned.load(std::memory_order_acquire) ||
+            a_ring->tail.load(std::memory_order_relaxed) != a_ring->head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        g_retiredDropped += a_ring->dropped.load(std::memory_order_relaxed);
+        return true;
+    });
+}
+
+void DeferredLog::Start(std::chrono::milliseconds a_pollInterval) {
+    std::scoped_lock lock(g_threadLock);
+    if (g_thread.joinable()) {
+        return;
+    }
+    g_isStopping = false;
+    g_thread = std::thread([a_pollInterval]() {
+        std::unique_lock threadLock(g_threadLock);
+        while (!g_isStopping) {
+            g_threadWake.wait_for(threadLock, a_pollInterval, []() { return g_isStopping; });
+            threadLock.unlock();
+            Drain();
+            threadLock.lock();
+        }
+    });
+}
+
+void DeferredLog::Stop() {
+    {
+        std::scoped_lock lock(g_threadLock);
+        if (!g_thread.joinable()) {
+            return;
+        }
+        g_isStopping = true;
+    }
+    g_threadWake.notify_all();
+    g_thread.join();
+    Drain();
+}
+
+DeferredLog::Stats DeferredLog::GetStats() {
+    std::scoped_lock drainLock(g_drainLock);
+    std::scoped_lock lock(g_ringsLock);
+    Stats stats{g_written, g_retiredDropped};
+    for (const auto& ring : g_rings) {
+        stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
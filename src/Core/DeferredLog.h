@@ -0,0 +1,216 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Logging for the hot paths, where a formatted spdlog line per call is too expensive.
+//
+// A call site writes one fixed-size binary record into a ring owned by the calling thread: a pointer to the static
+// site (format string, level, source location), a pointer to a decoder instantiated for the argument types, a
+// timestamp and the raw argument bytes. Strings are copied into the record, truncated if they do not fit. A
+// background thread drains the rings, formats the records and hands them to the default spdlog logger, so the file
+// I/O and flushing happen off the calling thread. When a ring is full the record is dropped and counted, never
+// waited on.
+//
+// Sites below AP_LOG_LEVEL compile to nothing: their arguments only appear in an unevaluated sizeof, so they still
+// have to compile and count as used, but are never evaluated. Enabled sites check the logger's runtime level first,
+// so their arguments are only evaluated when the line will actually be written.
+#define AP_LOG_LEVEL_TRACE 0
+#define AP_LOG_LEVEL_DEBUG 1
+#define AP_LOG_LEVEL_INFO 2
+#define AP_LOG_LEVEL_OFF 6
+
+#ifndef AP_LOG_LEVEL
+    #if defined(_DEBUG) || !defined(NDEBUG)
+        #define AP_LOG_LEVEL AP_LOG_LEVEL_TRACE
+    #else
+        #define AP_LOG_LEVEL AP_LOG_LEVEL_INFO
+    #endif
+#endif
+
+namespace DeferredLogDetail {
+    // Names the arguments of a compiled-out site, inside sizeof only.
+    template <class... TArgs>
+    constexpr int Discard(const TArgs&...) {
+        return 0;
+    }
+
+    template <class T>
+    inline constexpr bool kIsString = std::is_convertible_v<const T&, std::string_view>;
+
+    template <class T>
+    auto StoredOf() {
+        if constexpr (kIsString<T>) {
+            return std::string_view{};
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return bool{};
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return double{};
+        } else if constexpr (std::is_enum_v<T>) {
+            return StoredOf<std::underlying_type_t<T>>();
+        } else if constexpr (std::is_signed_v<T>) {
+            return std::int64_t{};
+        } else {
+            return std::uint64_t{};
+        }
+    }
+
+    // The type an argument is stored as and handed to the formatter as.
+    template <class T>
+    using Stored = decltype(StoredOf<T>());
+}
+
+class DeferredLog {
+public:
+    struct Site {
+        const char* format;
+        spdlog::level::level_enum level;
+        const char* file;
+        int line;
+    };
+
+    static constexpr std::size_t kRecordSize = 128;
+    static constexpr std::size_t kRingCapacity = 4096;  // records per thread
+
+    struct Record;
+    using Decoder = std::string (*)(const Site& a_site, const Record& a_record);
+
+    struct Record {
+        static constexpr std::size_t kPayloadSize = kRecordSize - 32;
+
+        const Site* site;
+        Decoder decoder;
+        std::int64_t timestamp;  // system_clock ticks
+        std::uint16_t payloadSize;
+        std::byte payload[kPayloadSize];
+    };
+    static_assert(sizeof(Record) == kRecordSize);
+
+    struct Stats {
+        std::uint64_t written{};
+        std::uint64_t dropped{};
+    };
+
+    // Starts the background thread. Records written before this wait in their rings.
+    static void Start(std::chrono::milliseconds a_pollInterval = std::chrono::milliseconds(5));
+    // Drains every ring and stops the background thread.
+    static void Stop();
+    // Drains every ring on the calling thread.
+    static void Drain();
+    // Drain() unless someone else is draining. For exit handlers, where the background thread may already have been
+    // killed while holding the drain lock and must not be joined.
+    static bool TryDrain();
+    static Stats GetStats();
+
+    static bool IsEnabled(spdlog::level::level_enum a_level) {
+        return spdlog::default_logger_raw()->should_log(a_level);
+    }
+
+    template <class... TArgs>
+    static void Write(const Site& a_site, const TArgs&... a_args) {
+        static_assert(kFixedSize<std::decay_t<TArgs>...> <= Record::kPayloadSize, "Too many arguments for a record");
+        Record* record = Acquire();
+        if (!record) {
+            return;
+        }
+        record->site = &a_site;
+        record->decoder = &Decode<std::decay_t<TArgs>...>;
+        record->timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+        std::size_t offset = 0;
+        // Unused when the site has no arguments.
+        [[maybe_unused]] std::size_t textBudget = Record::kPayloadSize - kFixedSize<std::decay_t<TArgs>...>;
+        (Encode(*record, offset, textBudget, a_args), ...);
+        record->payloadSize = static_cast<std::uint16_t>(offset);
+        Publish();
+    }
+
+private:
+    template <class T>
+    static constexpr bool kIsString = DeferredLogDetail::kIsString<T>;
+    template <class T>
+    using Stored = DeferredLogDetail::Stored<T>;
+
+    // Bytes every argument takes no matter how long its text is: a number, or the length prefix of a string.
+    template <class... TArgs>
+    static constexpr std::size_t kFixedSize = ((kIsString<TArgs> ? 1 : sizeof(Stored<TArgs>)) + ... + 0);
+
+    static Record* Acquire();
+    static void DrainLocked();
+    static void Publish();
+
+    template <class T>
+    static void Encode(Record& a_record, std::size_t& a_offset, std::size_t& a_textBudget, const T& a_value) {
+        if constexpr (std::is_pointer_v<T>) {
+            EncodeText(a_record, a_offset, a_textBudget,
+                       a_value ? std::string_view(a_value) : std::string_view("(null)"));
+        } else if constexpr (kIsString<T>) {
+            EncodeText(a_record, a_offset, a_textBudget, std::string_view(a_value));
+        } else {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "DeferredLog only records numbers and text");
+            const Stored<T> value = static_cast<Stored<T>>(a_value);
+            std::memcpy(a_record.payload + a_offset, &value, sizeof(value));
+            a_offset += sizeof(value);
+        }
+    }
+
+    // Copies as much of a_text as the budget allows, behind a one-byte length.
+    static void EncodeText(Record& a_record, std::size_t& a_offset, std::size_t& a_textBudget,
+                           std::string_view a_text);
+
+    template <class T>
+    static Stored<T> DecodeOne(const Record& a_record, std::size_t& a_offset) {
+        if constexpr (kIsString<T>) {
+            std::uint8_t length = 0;
+            std::memcpy(&length, a_record.payload + a_offset, 1);
+            const auto* text = reinterpret_cast<const char*>(a_record.payload + a_offset + 1);
+            a_offset += 1 + length;
+            return std::string_view(text, length);
+        } else {
+            Stored<T> value{};
+            std::memcpy(&value, a_record.payload + a_offset, sizeof(value));
+            a_offset += sizeof(value);
+            return value;
+        }
+    }
+
+    template <class... TArgs>
+    static std::string Decode(const Site& a_site, const Record& a_record) {
+        [[maybe_unused]] std::size_t offset = 0;
+        // Braced initialisation keeps the decoding order left to right.
+        std::tuple<Stored<TArgs>...> values{DecodeOne<TArgs>(a_record, offset)...};
+        return std::apply(
+            [&](auto&... a_values) {
+                return spdlog::fmt_lib::vformat(std::string_view(a_site.format),
+                                                spdlog::fmt_lib::make_format_args(a_values...));
+            },
+            values);
+    }
+};
+
+#define AP_LOG_IMPL(level, format, ...)                                                          \
+    do {                                                                                         \
+        if (::DeferredLog::IsEnabled(level)) {                                                   \
+            static constexpr ::DeferredLog::Site apLogSite{format, level, __FILE__, __LINE__};  \
+            ::DeferredLog::Write(apLogSite __VA_OPT__(, ) __VA_ARGS__);                          \
+        }                                                                                        \
+    } while (false)
+
+#if AP_LOG_LEVEL <= AP_LOG_LEVEL_TRACE
+    #define AP_LOG_TRACE(format, ...) AP_LOG_IMPL(::spdlog::level::trace, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+    #define AP_LOG_TRACE(format, ...) ((void)sizeof(::DeferredLogDetail::Discard(format __VA_OPT__(, ) __VA_ARGS__)))
+#endif
+
+#if AP_LOG_LEVEL <= AP_LOG_LEVEL_DEBUG
+    #define AP_LOG_DEBUG(format, ...) AP_LOG_IMPL(::spdlog::level::debug, format __VA_OPT__(, ) __VA_ARGS__)
+#else
+    #define AP_LOG_DEBUG(format, ...) ((void)sizeof(::DeferredLogDetail::Discard(format __VA_OPT__(, ) __VA_ARGS__)))
+#endif
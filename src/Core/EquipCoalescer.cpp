@@ -0,0 +1,26 @@
+#include "EquipCoalescer.h"
+#include <algorithm>
+
+bool EquipCoalescer::MarkDirty(std::uint32_t a_actorFormID) {
+    std::scoped_lock lock(m_lock);
+
+    ++m_eventCount;
+    // Bursts touch a handful of actors, a linear scan beats hashing at that size.
+    if (std::ranges::find(m_dirty, a_actorFormID, &Entry::actorFormID) == m_dirty.end()) {
+        m_dirty.push_back({a_actorFormID});
+    }
+
+    const bool needsFlush = !m_isFlushPending;
+    m_isFlushPending = true;
+    return needsFlush;
+}
+
+EquipCoalescer::Batch EquipCoalescer::TakeDirty() {
+    std::scoped_lock lock(m_lock);
+
+    Batch batch{std::move(m_dirty), m_eventCount};
+    m_dirty.clear();
+    m_eventCount = 0;
+    m_isFlushPending = false;
+    return batch;
+}
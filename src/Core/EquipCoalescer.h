@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Collects the actors touched by a burst of equip events so that each one is resolved once, in a single deferred
+// flush. A boot swap (unequip + equip on the same slot) or a full outfit change costs one morph update for the net
+// change instead of one per event.
+//
+// Only the actors are tracked, not what the events did to them: the game does not order the events of a swap (the
+// new heels may report their equip before the old heels report their unequip), so the flush reads what each actor
+// is wearing by then. An event for an actor that arrives after its batch was taken marks it again for the next one.
+//
+// The owner decides how a flush is scheduled and what it does per actor.
+class EquipCoalescer {
+public:
+    struct Entry {
+        std::uint32_t actorFormID{};
+    };
+
+    struct Batch {
+        std::vector<Entry> entries;  // in the order actors were first marked
+        std::size_t eventCount{};
+    };
+
+    // Returns true when no flush is pending yet, meaning the caller has to schedule one.
+    bool MarkDirty(std::uint32_t a_actorFormID);
+    Batch TakeDirty();
+
+private:
+    std::mutex m_lock;
+    std::vector<Entry> m_dirty;
+    std::size_t m_eventCount{};
+    bool m_isFlushPending{false};
+};
@@ -0,0 +1,117 @@
+#include "EquipPipeline.h"
+#include "DeferredLog.h"
+#include "Metrics.h"
+#include <spdlog/spdlog.h>
+
+bool EquipPipeline::OnEquipEvent(const EquipEvent& a_event) {
+    AP_LOG_TRACE(">>>> Entering EquipPipeline::OnEquipEvent");
+
+    AP_METRICS_COUNT(kEventsSeen);
+
+    // Counted, not timed: two clock reads would cost more than the bit test. EquipPrefilterBench measures it.
+    if (!IsFootwearCandidate(a_event.baseFormID)) {
+        AP_METRICS_COUNT(kFilteredPrefilter);
+        AP_LOG_TRACE("<<<< Exiting EquipPipeline::OnEquipEvent (prefiltered)");
+        return false;
+    }
+    AP_METRICS_COUNT(kPassedPrefilter);
+
+    ArmorInfo armor;
+    {
+        AP_METRICS_TIME_SCOPE(kEventFilter);
+        if (!m_armorLookup.LookupArmor(a_event.baseFormID, armor)) {
+            AP_METRICS_COUNT(kFilteredNotArmor);
+            AP_LOG_TRACE("<<<< Exiting EquipPipeline::OnEquipEvent (not armor)");
+            return false;
+        }
+        if (!armor.coversFeet && !armor.coversCalves) {
+            AP_METRICS_COUNT(kFilteredNotFootwear);
+            AP_LOG_TRACE("EquipPipeline::OnEquipEvent - Armor is neither footwear nor legwear");
+            AP_LOG_TRACE("<<<< Exiting EquipPipeline::OnEquipEvent (not footwear)");
+            return false;
+        }
+    }
+
+    AP_LOG_TRACE("Processing equip event: actor={:#x}, armor={:#x}, equipped={}", a_event.actorFormID, armor.formID,
+                  a_event.isEquipped);
+
+    // Only mark the actor here. Its morphs are resolved once, from what it wears, in a deferred flush after the whole
+    // burst of equip events has been seen.
+    const bool result = m_equipCoalescer.MarkDirty(a_event.actorFormID);
+
+    AP_LOG_TRACE("<<<< Exiting EquipPipeline::OnEquipEvent (result: {})", result);
+    return result;
+}
+
+void EquipPipeline::SetFootwear(std::span<const std::uint32_t> a_formIDs) {
+    m_footwear.Reset(a_formIDs);
+    for (const std::uint32_t formID : a_formIDs) {
+        m_footwear.Insert(formID);
+    }
+    m_isFootwearKnown = true;
+    spdlog::info("Prefiltering equip events on {} footwear form(s) across {} plugin(s), {:.1f} KiB.",
+                 a_formIDs.size(), m_footwear.GetSegmentCount(), m_footwear.GetMemoryUsage() / 1024.0);
+}
+
+std::size_t EquipPipeline::Flush() {
+    AP_LOG_TRACE(">>>> Entering EquipPipeline::Flush");
+
+    AP_METRICS_COUNT(kFlushes);
+    const auto batch = m_equipCoalescer.TakeDirty();
+    AP_LOG_DEBUG("EquipPipeline::Flush - Resolving {} actor(s) for {} equip event(s)", batch.entries.size(),
+                  batch.eventCount);
+
+    std::size_t updated = 0;
+    for (const auto& entry : batch.entries) {
+        // The actor may have been unloaded or deleted between the event and this flush.
+        const ActorHandle actor = m_armorLookup.LookupActor(entry.actorFormID);
+        if (!actor) {
+            AP_LOG_TRACE("EquipPipeline::Flush - Actor {:#x} no longer exists, skipping", entry.actorFormID);
+            continue;
+        }
+
+        // The order of the events does not tell the final state, see EquipCoalescer.
+        const auto state = ResolveWornState(actor);
+        AP_LOG_TRACE("EquipPipeline::Flush - Resolved state {} for actor {:#x}", static_cast<int>(state),
+                      entry.actorFormID);
+        if (m_morphApplier.UpdateMorphState(actor, state)) {
+            ++updated;
+        }
+        AP_METRICS_COUNT(kActorsFlushed);
+    }
+    AP_METRICS_DUMP_IF_DUE("periodic");
+
+    AP_LOG_TRACE("<<<< Exiting EquipPipeline::Flush (result: {})", updated);
+    return updated;
+}
+
+MorphStateMachine::State EquipPipeline::ResolveWornState(const ActorHandle& a_actor) {
+    using Feet = MorphStateMachine::Feet;
+    using Calves = MorphStateMachine::Calves;
+
+    ArmorInfo feetArmor;
+    Feet feet = Feet::kBarefeet;
+    const bool hasFeet = m_armorLookup.GetWornArmor(a_actor, ArmorSlot::kFeet, feetArmor);
+    if (hasFeet) {
+        feet = m_classifier.IsHighHeel(feetArmor) ? Feet::kHighHeel : Feet::kLowHeel;
+    }
+
+    // Boots that also cover the calves occupy the slot without being pantyhose.
+    ArmorInfo calvesArmor;
+    const bool hasCalves = m_armorLookup.GetWornArmor(a_actor, ArmorSlot::kCalves, calvesArmor);
+    const Calves calves =
+        hasCalves && !(hasFeet && calvesArmor.formID == feetArmor.formID) ? Calves::kPantyhose : Calves::kBarelegs;
+
+    return MorphStateMachine::FromSlots(feet, calves);
+}
+
+bool EquipPipeline::Sync(const ActorHandle& a_actor) {
+    AP_LOG_TRACE(">>>> Entering EquipPipeline::Sync");
+
+    const auto state = ResolveWornState(a_actor);
+    AP_LOG_TRACE("EquipPipeline::Sync - Resolved state {} from worn armor", static_cast<int>(state));
+    const bool result = m_morphApplier.UpdateMorphState(a_actor, state);
+
+    AP_LOG_TRACE("<<<< Exiting EquipPipeline::Sync (result: {})", result);
+    return result;
+}
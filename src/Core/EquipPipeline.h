@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include "Adapters.h"
+#include "EquipCoalescer.h"
+#include "FormIDBitset.h"
+#include "HighHeelClassifier.h"
+#include "MorphApplier.h"
+
+// An equip event reduced to what the pipeline needs: which actor, which base form, on or off.
+struct EquipEvent {
+    std::uint32_t actorFormID{};
+    std::uint32_t baseFormID{};
+    bool isEquipped{};
+};
+
+// Equip event -> dirty actor -> worn state at flush -> morph write, without touching the game directly. The plugin
+// feeds it TESEquipEvents and runs Flush() from the task queue; replay_bench feeds it a recorded trace.
+class EquipPipeline {
+public:
+    EquipPipeline(IArmorLookup& a_armorLookup, const HighHeelClassifier& a_classifier, MorphApplier& a_morphApplier)
+        : m_armorLookup(a_armorLookup), m_classifier(a_classifier), m_morphApplier(a_morphApplier) {}
+
+    // Returns true when the caller has to schedule a Flush().
+    bool OnEquipEvent(const EquipEvent& a_event);
+
+    // Every armor of the load order that covers the feet or calves. From then on OnEquipEvent() drops events for any
+    // other base form, such as weapons, spells and body armor, before it looks the form up. Forms created at runtime
+    // always pass, and so does everything until this is called. Call it once the data is loaded, before any event.
+    void SetFootwear(std::span<const std::uint32_t> a_formIDs);
+    // False only for a base form that cannot change the feet or calves morphs.
+    bool IsFootwearCandidate(std::uint32_t a_baseFormID) const {
+        return !m_isFootwearKnown || (a_baseFormID >> 24) == FormIDBitset::kDynamicSlot ||
+               m_footwear.Find(a_baseFormID).value_or(false);
+    }
+    std::size_t GetFootwearMemoryUsage() const { return m_footwear.GetMemoryUsage(); }  // bytes
+    // Returns the number of actors whose morphs changed; the MorphApplier writes them at its next Commit().
+    std::size_t Flush();
+
+    MorphStateMachine::State ResolveWornState(const ActorHandle& a_actor);
+    // Applies what the actor is wearing right now. Returns true when its morphs changed.
+    bool Sync(const ActorHandle& a_actor);
+
+private:
+    IArmorLookup& m_armorLookup;
+    const HighHeelClassifier& m_classifier;
+    MorphApplier& m_morphApplier;
+    EquipCoalescer m_equipCoalescer;
+    FormIDBitset m_footwear;
+    bool m_isFootwearKnown{};
+};
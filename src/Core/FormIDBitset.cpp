@@ -0,0 +1,78 @@
+#include "FormIDBitset.h"
+#include <algorithm>
+#include <atomic>
+
+void FormIDBitset::Reset(std::span<const std::uint32_t> a_formIDs) {
+    Clear();
+
+    // Size every segment from the lowest and highest local ID it has to hold.
+    std::uint32_t lightCount = 0;
+    for (const std::uint32_t formID : a_formIDs) {
+        if ((formID >> 24) == kLightSlot) {
+            lightCount = std::max(lightCount, ((formID >> 12) & 0xFFF) + 1);
+        }
+    }
+    m_light.resize(lightCount);
+
+    std::array<std::uint32_t, kLightSlot> regularMax{};
+    std::vector<std::uint32_t> lightMax(lightCount);
+    for (const std::uint32_t formID : a_formIDs) {
+        Segment* segment = GetSegment(formID);
+        if (!segment) {
+            continue;
+        }
+        const std::uint32_t slot = formID >> 24;
+        auto& max = slot < kLightSlot ? regularMax[slot] : lightMax[(formID >> 12) & 0xFFF];
+        const std::uint32_t localID = LocalID(formID);
+        if (segment->count == 0) {
+            segment->base = localID;
+            segment->count = 1;
+            max = localID;
+        } else {
+            segment->base = std::min(segment->base, localID);
+            max = std::max(max, localID);
+        }
+    }
+
+    std::size_t wordCount = 0;
+    const auto place = [&](Segment& a_segment, std::uint32_t a_max) {
+        if (a_segment.count == 0) {
+            return;
+        }
+        a_segment.count = a_max - a_segment.base + 1;
+        a_segment.wordOffset = static_cast<std::uint32_t>(wordCount);
+        wordCount += (a_segment.count + 63) / 64;
+    };
+    for (std::size_t slot = 0; slot < m_regular.size(); ++slot) {
+        place(m_regular[slot], regularMax[slot]);
+    }
+    for (std::size_t slot = 0; slot < m_light.size(); ++slot) {
+        place(m_light[slot], lightMax[slot]);
+    }
+    m_words.assign(wordCount, 0);
+}
+
+void FormIDBitset::Clear() {
+    m_regular = {};
+    m_light.clear();
+    m_words.clear();
+}
+
+void FormIDBitset::Insert(std::uint32_t a_formID) {
+    if (!Covers(a_formID)) {
+        return;
+    }
+    const Segment* segment = GetSegment(a_formID);
+    const std::uint32_t bit = LocalID(a_formID) - segment->base;
+    std::atomic_ref(m_words[segment->wordOffset + bit / 64])
+        .fetch_or(std::uint64_t{1} << (bit % 64), std::memory_order_relaxed);
+}
+
+std::size_t FormIDBitset::GetSegmentCount() const {
+    const auto isUsed = [](const Segment& a_segment) { return a_segment.count != 0; };
+    return std::ranges::count_if(m_regular, isUsed) + std::ranges::count_if(m_light, isUsed);
+}
+
+std::size_t FormIDBitset::GetMemoryUsage() const {
+    return sizeof(m_regular) + m_light.capacity() * sizeof(Segment) + m_words.capacity() * sizeof(std::uint64_t);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// One bit per FormID of a fixed set of forms from the load order.
+//
+// FormIDs are split the way the engine assigns them: a regular plugin owns the top byte (load order slot 0x00-0xFD)
+// and 24 bits of local ID, a light plugin owns 12 bits under 0xFE and 12 bits of local ID. Every plugin that defines
+// one of the forms gets one segment, a bit range covering its lowest to its highest form, and all segments share one
+// word array. Regular plugins are indexed directly by their slot; light plugins by a compact table sized to the
+// highest light slot in use. Find() is two array reads and a bit test.
+class FormIDBitset {
+public:
+    // Sizes the segments to hold a_formIDs, with every bit clear. Dynamic forms (0xFF) are left out.
+    void Reset(std::span<const std::uint32_t> a_formIDs);
+    void Clear();
+
+    // Sets the bit of a FormID Reset() made room for; any other is ignored. Safe to call from several threads at once.
+    void Insert(std::uint32_t a_formID);
+
+    // nullopt outside every segment: for dynamic forms, and for plugins without any of the forms. Inside a segment a
+    // FormID that was never inserted reads as false.
+    std::optional<bool> Find(std::uint32_t a_formID) const {
+        const Segment* segment = GetSegment(a_formID);
+        if (!segment) {
+            return std::nullopt;
+        }
+        const std::uint32_t bit = LocalID(a_formID) - segment->base;
+        if (bit >= segment->count) {
+            return std::nullopt;
+        }
+        return ((m_words[segment->wordOffset + bit / 64] >> (bit % 64)) & 1) != 0;
+    }
+    // Whether Find() has a bit for a_formID, without reading it; safe while Insert() runs.
+    bool Covers(std::uint32_t a_formID) const {
+        const Segment* segment = GetSegment(a_formID);
+        return segment && LocalID(a_formID) - segment->base < segment->count;
+    }
+
+    std::size_t GetSegmentCount() const;
+    std::size_t GetMemoryUsage() const;  // bytes
+
+    static constexpr std::uint32_t kLightSlot = 0xFE;
+    static constexpr std::uint32_t kDynamicSlot = 0xFF;
+
+private:
+    struct Segment {
+        std::uint32_t base{};
+        std::uint32_t count{};  // bits; 0 marks a plugin without any of the forms
+        std::uint32_t wordOffset{};
+    };
+
+    static std::uint32_t LocalID(std::uint32_t a_formID) {
+        return (a_formID >> 24) == kLightSlot ? a_formID & 0xFFF : a_formID & 0xFFFFFF;
+    }
+
+    const Segment* GetSegment(std::uint32_t a_formID) const {
+        const std::uint32_t slot = a_formID >> 24;
+        if (slot < kLightSlot) {
+            return &m_regular[slot];
+        }
+        if (slot == kLightSlot) {
+            const std::uint32_t lightSlot = (a_formID >> 12) & 0xFFF;
+            return lightSlot < m_light.size() ? &m_light[lightSlot] : nullptr;
+        }
+        return nullptr;
+    }
+    Segment* GetSegment(std::uint32_t a_formID) {
+        return const_cast<Segment*>(std::as_const(*this).GetSegment(a_formID));
+    }
+
+    std::array<Segment, kLightSlot> m_regular{};
+    std::vector<Segment> m_light;
+    std::vector<std::uint64_t> m_words;
+};
@@ -0,0 +1,195 @@
+#include "FormIDRangeIndex.h"
+#include <algorithm>
+
+void FormIDRangeIndex::Clear() {
+    m_names.clear();
+    m_plugins.clear();
+    m_slots.clear();
+    m_mins.clear();
+    m_maxs.clear();
+    m_pending.clear();
+    m_ruleCount = 0;
+    m_view = {};
+}
+
+void FormIDRangeIndex::Add(std::string_view a_plugin, std::uint32_t a_min, std::uint32_t a_max) {
+    if (a_max < a_min) {
+        return;
+    }
+    const std::uint32_t pluginID = Intern(a_plugin);
+    m_pending[pluginID].push_back({a_min, a_max});
+    ++m_ruleCount;
+}
+
+void FormIDRangeIndex::Build() {
+    m_mins.clear();
+    m_maxs.clear();
+    m_pending.resize(m_plugins.size());
+
+    for (std::size_t pluginID = 0; pluginID < m_plugins.size(); ++pluginID) {
+        auto& pending = m_pending[pluginID];
+        std::ranges::sort(pending, {}, &Range::min);
+
+        auto& plugin = m_plugins[pluginID];
+        plugin.rangeBegin = static_cast<std::uint32_t>(m_mins.size());
+        for (const auto& range : pending) {
+            // Merge overlapping and adjacent ranges; the second test guards against max + 1 overflowing.
+            if (m_mins.size() > plugin.rangeBegin && (range.min <= m_maxs.back() || range.min - 1 == m_maxs.back())) {
+                m_maxs.back() = std::max(m_maxs.back(), range.max);
+            } else {
+                m_mins.push_back(range.min);
+                m_maxs.push_back(range.max);
+            }
+        }
+        plugin.rangeEnd = static_cast<std::uint32_t>(m_mins.size());
+    }
+
+    m_pending.clear();
+    m_pending.shrink_to_fit();
+    m_mins.shrink_to_fit();
+    m_maxs.shrink_to_fit();
+    m_view = {m_names, m_plugins, m_slots, m_mins, m_maxs, m_ruleCount};
+}
+
+bool FormIDRangeIndex::Attach(const View& a_view) {
+    Clear();
+
+    // The slot table must be a power of two with room to spare, or probing would never terminate.
+    const std::size_t slotCount = a_view.slots.size();
+    if (slotCount != 0 && ((slotCount & (slotCount - 1)) != 0 || slotCount <= a_view.plugins.size())) {
+        return false;
+    }
+    if ((slotCount == 0 && !a_view.plugins.empty()) || a_view.mins.size() != a_view.maxs.size()) {
+        return false;
+    }
+    for (const std::uint32_t slot : a_view.slots) {
+        if (slot > a_view.plugins.size()) {
+            return false;
+        }
+    }
+    for (const auto& plugin : a_view.plugins) {
+        if (std::uint64_t{plugin.nameOffset} + plugin.nameLength > a_view.names.size() ||
+            plugin.rangeBegin > plugin.rangeEnd || plugin.rangeEnd > a_view.mins.size()) {
+            return false;
+        }
+    }
+
+    m_view = a_view;
+    return true;
+}
+
+std::uint32_t FormIDRangeIndex::FindPluginID(std::string_view a_plugin) const { return Probe(m_view, a_plugin); }
+
+std::uint32_t FormIDRangeIndex::Probe(const View& a_view, std::string_view a_plugin) {
+    if (a_view.slots.empty()) {
+        return kInvalidPluginID;
+    }
+
+    const std::uint64_t hash = Hash(a_plugin);
+    const std::size_t mask = a_view.slots.size() - 1;
+    for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask) {
+        const std::uint32_t slot = a_view.slots[i];
+        if (slot == 0) {
+            return kInvalidPluginID;
+        }
+        const auto& plugin = a_view.plugins[slot - 1];
+        if (plugin.hash == hash &&
+            std::string_view(a_view.names.data() + plugin.nameOffset, plugin.nameLength) == a_plugin) {
+            return slot - 1;
+        }
+    }
+}
+
+std::optional<FormIDRangeIndex::Range> FormIDRangeIndex::Find(std::uint32_t a_pluginID,
+                                                              std::uint32_t a_localFormID) const {
+    if (a_pluginID >= m_view.plugins.size()) {
+        return std::nullopt;
+    }
+
+    const auto& plugin = m_view.plugins[a_pluginID];
+    const std::uint32_t* first = m_view.mins.data() + plugin.rangeBegin;
+    const std::uint32_t* last = m_view.mins.data() + plugin.rangeEnd;
+
+    // First range starting after the FormID; the only candidate is the one right before it.
+    const std::uint32_t* it = std::upper_bound(first, last, a_localFormID);
+    if (it == first) {
+        return std::nullopt;
+    }
+    const std::size_t range = it - m_view.mins.data() - 1;
+    if (a_localFormID > m_view.maxs[range]) {
+        return std::nullopt;
+    }
+    return Range{m_view.mins[range], m_view.maxs[range]};
+}
+
+std::optional<FormIDRangeIndex::Range> FormIDRangeIndex::Find(std::string_view a_plugin,
+                                                              std::uint32_t a_localFormID) const {
+    return Find(FindPluginID(a_plugin), a_localFormID);
+}
+
+void FormIDRangeIndex::FindBatch(std::span<const std::uint32_t> a_pluginIDs,
+                                 std::span<const std::uint32_t> a_localFormIDs, std::span<std::uint8_t> a_out) const {
+    const std::size_t count = std::min({a_pluginIDs.size(), a_localFormIDs.size(), a_out.size()});
+    for (std::size_t i = 0; i < count; ++i) {
+        a_out[i] = Find(a_pluginIDs[i], a_localFormIDs[i]) ? 1 : 0;
+    }
+}
+
+std::string_view FormIDRangeIndex::GetPluginName(std::uint32_t a_pluginID) const {
+    if (a_pluginID >= m_view.plugins.size()) {
+        return {};
+    }
+    const auto& plugin = m_view.plugins[a_pluginID];
+    return {m_view.names.data() + plugin.nameOffset, plugin.nameLength};
+}
+
+std::uint64_t FormIDRangeIndex::Hash(std::string_view a_name) {
+    // FNV-1a, plugin names are short so this is cheaper than anything fancier.
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    for (const char c : a_name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::uint32_t FormIDRangeIndex::Intern(std::string_view a_plugin) {
+    if (const std::uint32_t existing = Probe({m_names, m_plugins, m_slots, {}, {}, 0}, a_plugin);
+        existing != kInvalidPluginID) {
+        return existing;
+    }
+
+    // Keep the table at most half full so probe sequences stay short.
+    if ((m_plugins.size() + 1) * 2 > m_slots.size()) {
+        Rehash(std::max<std::size_t>(16, m_slots.size() * 2));
+    }
+
+    const auto pluginID = static_cast<std::uint32_t>(m_plugins.size());
+    Plugin plugin;
+    plugin.hash = Hash(a_plugin);
+    plugin.nameOffset = static_cast<std::uint32_t>(m_names.size());
+    plugin.nameLength = static_cast<std::uint32_t>(a_plugin.size());
+    m_names.insert(m_names.end(), a_plugin.begin(), a_plugin.end());
+    m_plugins.push_back(plugin);
+    m_pending.emplace_back();
+
+    const std::size_t mask = m_slots.size() - 1;
+    std::size_t i = static_cast<std::size_t>(plugin.hash) & mask;
+    while (m_slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    m_slots[i] = pluginID + 1;
+    return pluginID;
+}
+
+void FormIDRangeIndex::Rehash(std::size_t a_slotCount) {
+    m_slots.assign(a_slotCount, 0);
+    const std::size_t mask = a_slotCount - 1;
+    for (std::uint32_t pluginID = 0; pluginID < m_plugins.size(); ++pluginID) {
+        std::size_t i = static_cast<std::size_t>(m_plugins[pluginID].hash) & mask;
+        while (m_slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = pluginID + 1;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Compiled form of the "ByFormIDRange" rules.
+//
+// Plugin names are interned to small integer IDs through an open-addressing hash table, and the ranges of each
+// plugin are sorted and merged into one flat run of two parallel arrays, the lower and the upper bounds. A lookup is
+// therefore one hash probe plus a binary search over the ranges of a single plugin, independent of how many rules the
+// other plugins define.
+//
+// FindBatch() answers many (plugin ID, local FormID) queries at once, with plugin IDs resolved by the caller.
+//
+// Usage: Clear(), Add() every rule, Build(), then query. Queries are only valid after Build(). Alternatively Attach()
+// a view of tables built earlier, e.g. mapped from a rule image, and query those in place.
+class FormIDRangeIndex {
+public:
+    struct Range {
+        std::uint32_t min{};
+        std::uint32_t max{};
+    };
+
+    struct Plugin {
+        std::uint64_t hash{};
+        std::uint32_t nameOffset{};
+        std::uint32_t nameLength{};
+        std::uint32_t rangeBegin{};
+        std::uint32_t rangeEnd{};
+    };
+
+    // The built tables. Everything a lookup reads, and nothing else.
+    struct View {
+        std::span<const char> names;
+        std::span<const Plugin> plugins;
+        std::span<const std::uint32_t> slots;  // pluginID + 1, 0 marks an empty slot
+        std::span<const std::uint32_t> mins;   // lower bound of each range, sorted within a plugin
+        std::span<const std::uint32_t> maxs;   // upper bound of each range
+        std::uint64_t ruleCount{};
+    };
+
+    static constexpr std::uint32_t kInvalidPluginID = 0xFFFFFFFF;
+
+    void Clear();
+    void Add(std::string_view a_plugin, std::uint32_t a_min, std::uint32_t a_max);
+    void Build();
+
+    const View& GetView() const { return m_view; }
+    // Uses a_view in place. The memory behind it must outlive the index or the next Clear(). Returns false, leaving
+    // the index empty, when the tables are inconsistent.
+    bool Attach(const View& a_view);
+
+    std::uint32_t FindPluginID(std::string_view a_plugin) const;
+    std::optional<Range> Find(std::uint32_t a_pluginID, std::uint32_t a_localFormID) const;
+    std::optional<Range> Find(std::string_view a_plugin, std::uint32_t a_localFormID) const;
+    // a_out[i] = 1 when a_localFormIDs[i] falls in a range of plugin a_pluginIDs[i], else 0. Unknown plugin IDs,
+    // kInvalidPluginID included, never match. All three spans must have the same size.
+    void FindBatch(std::span<const std::uint32_t> a_pluginIDs, std::span<const std::uint32_t> a_localFormIDs,
+                   std::span<std::uint8_t> a_out) const;
+    std::string_view GetPluginName(std::uint32_t a_pluginID) const;
+
+    std::size_t GetPluginCount() const { return m_view.plugins.size(); }
+    std::size_t GetRangeCount() const { return m_view.mins.size(); }
+    std::size_t GetRuleCount() const { return m_view.ruleCount; }
+
+private:
+    static std::uint64_t Hash(std::string_view a_name);
+
+    std::uint32_t Intern(std::string_view a_plugin);
+    void Rehash(std::size_t a_slotCount);
+    static std::uint32_t Probe(const View& a_view, std::string_view a_plugin);
+
+    std::vector<char> m_names;
+    std::vector<Plugin> m_plugins;
+    std::vector<std::uint32_t> m_slots;  // pluginID + 1, 0 marks an empty slot
+    std::vector<std::uint32_t> m_mins;
+    std::vector<std::uint32_t> m_maxs;
+    std::vector<std::vector<Range>> m_pending;  // per plugin, only populated between Add() and Build()
+    std::size_t m_ruleCount{};
+    View m_view;  // the owned tables after Build(), or the attached ones
+};
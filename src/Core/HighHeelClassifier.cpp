@@ -0,0 +1,153 @@
+#include "HighHeelClassifier.h"
+#include "DeferredLog.h"
+#include "Metrics.h"
+#include "RuleWatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <spdlog/spdlog.h>
+
+bool HighHeelClassifier::Load(const std::filesystem::path& a_path) {
+    return Rebuild(
+        [a_path](RuleSnapshot& a_snapshot) {
+            // Taken before reading: a file saved in between changes the fingerprint again, so the watcher reloads it.
+            a_snapshot.sourceFingerprint = RuleWatcher::Fingerprint(a_path);
+            return a_snapshot.rules.Load(a_path);
+        },
+        false);
+}
+
+bool HighHeelClassifier::ParseJson(const nlohmann::json& j) {
+    return Rebuild([j](RuleSnapshot& a_snapshot) { return a_snapshot.rules.ParseJson(j); }, false);
+}
+
+void HighHeelClassifier::ResolveKeywords(const KeywordRuleSet::Resolver& a_resolver) {
+    {
+        std::scoped_lock lock(m_rebuildLock);
+        m_resolver = a_resolver;
+    }
+    Rebuild({}, false);
+}
+
+bool HighHeelClassifier::Reload() { return Rebuild({}, true); }
+
+void HighHeelClassifier::SetArmorCatalog(std::shared_ptr<const ArmorCatalog> a_catalog) {
+    std::scoped_lock lock(m_rebuildLock);
+    m_catalog = std::move(a_catalog);
+}
+
+bool HighHeelClassifier::Rebuild(const Source& a_source, bool a_isBlockingAllowed) {
+    spdlog::trace(">>>> Entering HighHeelClassifier::Rebuild");
+    std::scoped_lock lock(m_rebuildLock);
+
+    const Source& source = a_source ? a_source : m_source;
+    if (!source) {
+        spdlog::warn("No high heel rules have been loaded yet, nothing to rebuild.");
+        spdlog::trace("<<<< Exiting HighHeelClassifier::Rebuild (result: false)");
+        return false;
+    }
+
+    auto snapshot = std::make_unique<RuleSnapshot>();
+    if (!source(*snapshot)) {
+        spdlog::error("Failed to build high heel rules; keeping the rules currently in use.");
+        spdlog::trace("<<<< Exiting HighHeelClassifier::Rebuild (result: false)");
+        return false;
+    }
+    if (m_resolver) {
+        snapshot->rules.ResolveKeywords(m_resolver);
+    }
+    snapshot->ruleHash = snapshot->rules.GetHash();
+    if (m_catalog) {
+        const auto start = std::chrono::steady_clock::now();
+        const HighHeelRules& rules = snapshot->rules;
+        snapshot->verdicts.Build(m_catalog->armors,
+                                 [&rules](std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) {
+                                     rules.ClassifyBatch(a_keys, a_out);
+                                 });
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        spdlog::info(
+            "Pre-classified {} armor(s), {} high heel(s), in {:.1f} ms. Verdict bitset: {} segment(s), {} KiB.",
+            snapshot->verdicts.GetArmorCount(), snapshot->verdicts.GetHighHeelCount(), elapsed.count(),
+            snapshot->verdicts.GetSegmentCount(), (snapshot->verdicts.GetMemoryUsage() + 1023) / 1024);
+    }
+
+    snapshot->generation = m_nextGeneration;
+    m_nextGeneration = (m_nextGeneration + 1) & VerdictCache::kGenerationMask;
+    if (m_nextGeneration == 0) {
+        // Wrapped: the oldest cache entries would look current again.
+        m_verdictCache.Clear();
+        m_nextGeneration = 1;
+    }
+    if (a_source) {
+        m_source = a_source;
+    }
+
+    const std::uint32_t generation = snapshot->generation;
+    if (a_isBlockingAllowed) {
+        m_snapshot.Publish(std::move(snapshot));
+    } else {
+        m_snapshot.PublishDeferred(std::move(snapshot));
+    }
+    spdlog::info("Published high heel rule snapshot {}.", generation);
+    spdlog::trace("<<<< Exiting HighHeelClassifier::Rebuild (result: true)");
+    return true;
+}
+
+void HighHeelClassifier::ClassifyBatch(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) const {
+    const auto snapshot = m_snapshot.Read();
+    if (!snapshot) {
+        std::ranges::fill(a_out, 0);
+        return;
+    }
+    snapshot->rules.ClassifyBatch(a_keys, a_out);
+}
+
+bool HighHeelClassifier::IsHighHeel(const ArmorInfo& a_armor) const {
+    AP_LOG_TRACE(">>>> Entering HighHeelClassifier::IsHighHeel");
+    AP_METRICS_COUNT(kClassifications);
+
+    const auto snapshot = m_snapshot.Read();
+    if (!snapshot) {
+        AP_LOG_TRACE("<<<< Exiting HighHeelClassifier::IsHighHeel (no rules loaded)");
+        return false;
+    }
+
+    if (a_armor.coversFeet) {
+        if (const auto verdict = snapshot->verdicts.Find(a_armor.formID)) {
+            AP_LOG_TRACE("<<<< Exiting HighHeelClassifier::IsHighHeel (pre-classified: {})", *verdict);
+            return *verdict;
+        }
+    }
+
+    // Only the slow path is timed; two clock reads would cost more than the bit test above.
+    AP_METRICS_TIME_SCOPE(kClassification);
+
+    // Dynamic forms (0xFF) get their FormIDs recycled, so a cached verdict could outlive the armor it belongs to.
+    const bool isCacheable = !a_armor.isDynamic;
+
+    if (isCacheable) {
+        if (const auto cached = m_verdictCache.Lookup(a_armor.formID, snapshot->generation)) {
+            AP_LOG_DEBUG("Decision: {}. Cached verdict for armor FormID {:#x}.", *cached ? "YES" : "NO",
+                          a_armor.formID);
+            AP_LOG_TRACE("<<<< Exiting HighHeelClassifier::IsHighHeel (result: {})", *cached);
+            return *cached;
+        }
+    }
+
+    const bool result = snapshot->rules.Classify(a_armor);
+    if (isCacheable) {
+        m_verdictCache.Store(a_armor.formID, snapshot->generation, result);
+    }
+
+    AP_LOG_TRACE("<<<< Exiting HighHeelClassifier::IsHighHeel (result: {})", result);
+    return result;
+}
+
+std::uint64_t HighHeelClassifier::GetRuleHash() const {
+    const auto snapshot = m_snapshot.Read();
+    return snapshot ? snapshot->ruleHash : 0;
+}
+
+std::uint64_t HighHeelClassifier::GetSourceFingerprint() const {
+    const auto snapshot = m_snapshot.Read();
+    return snapshot ? snapshot->sourceFingerprint : 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "Adapters.h"
+#include "ArmorVerdictSet.h"
+#include "HighHeelRules.h"
+#include "SnapshotCell.h"
+#include "VerdictCache.h"
+
+// One immutable compiled rule set. Published whole, never changed once readers can see it.
+struct RuleSnapshot {
+    HighHeelRules rules;
+    ArmorVerdictSet verdicts;    // the cataloged armors, classified with rules
+    std::uint32_t generation{};  // keys the verdict cache; never 0
+    std::uint64_t ruleHash{};    // rules.GetHash()
+    // RuleWatcher::Fingerprint() of the files rules was parsed from, taken just before reading them; 0 for rules
+    // given as JSON.
+    std::uint64_t sourceFingerprint{};
+};
+
+// The current RuleSnapshot plus the per-FormID verdict memo in front of it.
+//
+// Once an ArmorCatalog is set, every snapshot also carries the verdicts of all cataloged armors, so IsHighHeel() on
+// footwear is a bit test. The rules and the memo remain for what the catalog does not hold, such as dynamic forms.
+//
+// Load(), ParseJson(), ResolveKeywords() and Reload() build a complete new snapshot on the calling thread and publish
+// it with one pointer swap; on failure the previous snapshot stays. IsHighHeel() reads whichever snapshot is current
+// without taking a lock, and its cache entries are tagged with that snapshot's generation.
+//
+// Load(), ParseJson() and ResolveKeywords() run on the game thread at startup and never wait for readers; the snapshots
+// they replace are freed by the next Reload(), which waits out the readers still using them and so belongs on a
+// loader thread.
+class HighHeelClassifier {
+public:
+    bool Load(const std::filesystem::path& a_path);
+    bool ParseJson(const nlohmann::json& j);
+    // a_resolver is kept and applied to every later snapshot, possibly from a reload thread.
+    void ResolveKeywords(const KeywordRuleSet::Resolver& a_resolver);
+    // Rebuilds the snapshot from the same source as the last successful Load() or ParseJson().
+    bool Reload();
+    // Used from the next rebuild on; call it before ResolveKeywords() to classify the catalog once.
+    void SetArmorCatalog(std::shared_ptr<const ArmorCatalog> a_catalog);
+
+    bool IsHighHeel(const ArmorInfo& a_armor) const;
+    // Classifies a_keys against the current rules in one pass, for bulk work. Neither reads nor fills the verdict
+    // cache.
+    void ClassifyBatch(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) const;
+
+    SnapshotCell<RuleSnapshot>::ReadGuard ReadSnapshot() const { return m_snapshot.Read(); }
+    // HighHeelRules::GetHash() of the current rules, 0 before any were loaded.
+    std::uint64_t GetRuleHash() const;
+    // RuleSnapshot::sourceFingerprint of the current rules, 0 before any were loaded.
+    std::uint64_t GetSourceFingerprint() const;
+    VerdictCache::Stats GetCacheStats() const { return m_verdictCache.GetStats(); }
+
+private:
+    // Fills a_snapshot.rules and a_snapshot.sourceFingerprint.
+    using Source = std::function<bool(RuleSnapshot& a_snapshot)>;
+
+    bool Rebuild(const Source& a_source, bool a_isBlockingAllowed);
+
+    std::mutex m_rebuildLock;  // one rebuild at a time; guards m_source, m_resolver and m_catalog
+    Source m_source;
+    KeywordRuleSet::Resolver m_resolver;
+    std::shared_ptr<const ArmorCatalog> m_catalog;
+    std::uint32_t m_nextGeneration{1};
+    SnapshotCell<RuleSnapshot> m_snapshot;
+    mutable VerdictCache m_verdictCache;
+};
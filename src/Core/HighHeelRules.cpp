@@ -0,0 +1,551 @@
+#include "HighHeelRules.h"
+#include "DeferredLog.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <spdlog/spdlog.h>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+    inline bool IsValidFormIDRangeRulesJson(const nlohmann::json& a_ruleJson) {
+        if (!a_ruleJson.is_object() || !a_ruleJson.contains("Plugin") || !a_ruleJson.contains("Min") ||
+            !a_ruleJson.contains("Max")) {
+            return false;
+        }
+        return true;
+    }
+
+    inline std::string_view Trim(std::string_view a_text) {
+        while (!a_text.empty() && std::isspace(static_cast<unsigned char>(a_text.front()))) {
+            a_text.remove_prefix(1);
+        }
+        while (!a_text.empty() && std::isspace(static_cast<unsigned char>(a_text.back()))) {
+            a_text.remove_suffix(1);
+        }
+        return a_text;
+    }
+
+    // Reads the leading hex digits, with an optional 0x prefix, and ignores the rest like std::stoul(..., 16) did, so
+    // rule files that loaded before keep loading.
+    inline bool ParseHexFormID(const nlohmann::json& a_json, std::uint32_t& a_out) {
+        if (!a_json.is_string()) {
+            return false;
+        }
+        std::string_view text = Trim(a_json.get_ref<const std::string&>());
+        if (text.starts_with("0x") || text.starts_with("0X")) {
+            text.remove_prefix(2);
+        }
+        return std::from_chars(text.data(), text.data() + text.size(), a_out, 16).ec == std::errc{};
+    }
+
+    inline std::string ToLower(std::string_view a_text) {
+        std::string result(a_text);
+        for (char& c : result) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return result;
+    }
+
+    struct SourceFile {
+        std::string name;
+        MappedFile file;
+        std::uint64_t hash{};
+    };
+}
+
+bool RuleFile::Parse(const nlohmann::json& j) {
+    spdlog::trace(">>>> Entering RuleFile::Parse");
+
+    bool keywordsParsed = ParseKeywords(j);
+    bool formIDRangeParsed = ParseFormIDRange(j);
+    bool namePatternsParsed = ParsePatterns(j, "ByNamePattern", namePatterns);
+    bool modelPathPatternsParsed = ParsePatterns(j, "ByModelPath", modelPathPatterns);
+
+    bool result = keywordsParsed && formIDRangeParsed && namePatternsParsed && modelPathPatternsParsed;
+    spdlog::trace("<<<< Exiting RuleFile::Parse (result: {})", result);
+    return result;
+}
+
+bool RuleFile::ParseFormIDRange(const nlohmann::json& j) {
+    spdlog::trace(">>>> Entering RuleFile::ParseFormIDRange");
+
+    if (!j.contains("ByFormIDRange")) {
+        spdlog::debug("'ByFormIDRange' section not found in '{}', skipping.", source);
+        spdlog::trace("<<<< Exiting RuleFile::ParseFormIDRange (result: true)");
+        return true;
+    }
+
+    const auto& formIDRangeRulesJson = j["ByFormIDRange"];
+    if (!formIDRangeRulesJson.is_array()) {
+        spdlog::error("'ByFormIDRange' in '{}' must be an array. JSON content: {}", source,
+                      formIDRangeRulesJson.dump());
+        spdlog::trace("<<<< Exiting RuleFile::ParseFormIDRange (result: false)");
+        return false;
+    }
+
+    ranges.reserve(ranges.size() + formIDRangeRulesJson.size());
+    for (const auto& ruleJson : formIDRangeRulesJson) {
+        if (!IsValidFormIDRangeRulesJson(ruleJson)) {
+            spdlog::error("Invalid FormID range rule found in '{}', skipping. Rule content: {}", source,
+                          ruleJson.dump());
+            continue;
+        }
+        const auto& pluginJson = ruleJson["Plugin"];
+        std::uint32_t min = 0;
+        std::uint32_t max = 0;
+        if (!pluginJson.is_string() || !ParseHexFormID(ruleJson["Min"], min) ||
+            !ParseHexFormID(ruleJson["Max"], max)) {
+            spdlog::error("Failed to parse FormIDRange rule in '{}', skipping. Content: {}", source, ruleJson.dump());
+            continue;
+        }
+        const auto plugin = Trim(pluginJson.get_ref<const std::string&>());
+
+        if (max < min) {
+            spdlog::warn(
+                "Invalid FormID range rule for plugin '{}' in '{}', skipping: Max ({:#x}) is lesser than Min ({:#x}). ",
+                plugin, source, max, min);
+            continue;
+        }
+
+        ranges.push_back({std::string(plugin), min, max});
+        spdlog::debug("Loaded FormID range rule from '{}': Plugin='{}', Min={:#x}, Max={:#x}", source, plugin, min,
+                      max);
+    }
+
+    spdlog::trace("<<<< Exiting RuleFile::ParseFormIDRange (result: true)");
+    return true;
+}
+
+bool RuleFile::ParseKeywords(const nlohmann::json& j) {
+    spdlog::trace(">>>> Entering RuleFile::ParseKeywords");
+
+    if (!j.contains("ByKeywords")) {
+        spdlog::debug("'ByKeywords' section not found in '{}', skipping.", source);
+        spdlog::trace("<<<< Exiting RuleFile::ParseKeywords (result: true)");
+        return true;
+    }
+
+    const auto& keywordsJson = j["ByKeywords"];
+    if (!keywordsJson.is_array()) {
+        spdlog::error("'ByKeywords' in '{}' must be an array. JSON content: {}", source, keywordsJson.dump());
+        spdlog::trace("<<<< Exiting RuleFile::ParseKeywords (result: false)");
+        return false;
+    }
+
+    for (const auto& kw : keywordsJson) {
+        if (!kw.is_string()) {
+            spdlog::error("Keyword in '{}' must be a string, skipping. Content: {}", source, kw.dump());
+            continue;
+        }
+        const auto keywordStr = Trim(kw.get_ref<const std::string&>());
+        keywords.emplace_back(keywordStr);
+        spdlog::debug("Loaded keyword rule from '{}': '{}'", source, keywordStr);
+    }
+    spdlog::trace("<<<< Exiting RuleFile::ParseKeywords (result: true)");
+    return true;
+}
+
+bool RuleFile::ParsePatterns(const nlohmann::json& j, const char* a_section, std::vector<std::string>& a_out) {
+    spdlog::trace(">>>> Entering RuleFile::ParsePatterns");
+
+    if (!j.contains(a_section)) {
+        spdlog::debug("'{}' section not found in '{}', skipping.", a_section, source);
+        spdlog::trace("<<<< Exiting RuleFile::ParsePatterns (result: true)");
+        return true;
+    }
+
+    const auto& patternsJson = j[a_section];
+    if (!patternsJson.is_array()) {
+        spdlog::error("'{}' in '{}' must be an array. JSON content: {}", a_section, source, patternsJson.dump());
+        spdlog::trace("<<<< Exiting RuleFile::ParsePatterns (result: false)");
+        return false;
+    }
+
+    for (const auto& patternJson : patternsJson) {
+        if (!patternJson.is_string()) {
+            spdlog::error("Pattern in '{}' of '{}' must be a string, skipping. Content: {}", a_section, source,
+                          patternJson.dump());
+            continue;
+        }
+        const auto pattern = Trim(patternJson.get_ref<const std::string&>());
+        if (pattern.find_first_not_of('*') == std::string_view::npos || pattern.find('\0') != std::string_view::npos) {
+            spdlog::error("Pattern '{}' in '{}' of '{}' would match every armor, skipping.", pattern, a_section,
+                          source);
+            continue;
+        }
+        a_out.emplace_back(pattern);
+        spdlog::debug("Loaded {} rule from '{}': '{}'", a_section, source, pattern);
+    }
+    spdlog::trace("<<<< Exiting RuleFile::ParsePatterns (result: true)");
+    return true;
+}
+
+std::vector<std::filesystem::path> HighHeelRules::ListRuleFiles(const std::filesystem::path& a_directory,
+                                                                std::error_code& a_ec) {
+    std::vector<std::filesystem::path> paths;
+    for (std::filesystem::directory_iterator it(a_directory, a_ec), end; !a_ec && it != end; it.increment(a_ec)) {
+        if (it->is_regular_file(a_ec) && ToLower(it->path().extension().string()) == ".json") {
+            paths.push_back(it->path());
+        }
+    }
+    std::ranges::sort(paths, {}, [](const std::filesystem::path& a_path) { return a_path.filename().u8string(); });
+    return paths;
+}
+
+bool HighHeelRules::Load(const std::filesystem::path& a_path) {
+    spdlog::trace(">>>> Entering HighHeelRules::Load");
+    spdlog::info("Loading high heel rules from '{}'...", a_path.string());
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(a_path, ec)) {
+        paths = ListRuleFiles(a_path, ec);
+        if (ec) {
+            spdlog::error("Failed to list rule directory '{}': {}", a_path.string(), ec.message());
+            spdlog::trace("<<<< Exiting HighHeelRules::Load (result: false)");
+            return false;
+        }
+    } else {
+        paths.push_back(a_path);
+    }
+
+    // Map and hash every file first: that is all a launch with an up-to-date image needs.
+    std::vector<SourceFile> sources(paths.size());
+    ParallelFor(paths.size(), [&](std::size_t a_index) {
+        auto& source = sources[a_index];
+        source.name = paths[a_index].filename().string();
+        if (source.file.Open(paths[a_index])) {
+            source.hash = RuleImage::Hash(source.file.GetBytes());
+        }
+    });
+    std::erase_if(sources, [](const SourceFile& a_source) {
+        if (!a_source.file.IsOpen()) {
+            spdlog::error("Failed to open high heel definition file: {}", a_source.name);
+        }
+        return !a_source.file.IsOpen();
+    });
+    if (sources.empty()) {
+        spdlog::error("No high heel definition file could be read from '{}'.", a_path.string());
+        spdlog::trace("<<<< Exiting HighHeelRules::Load (result: false)");
+        return false;
+    }
+
+    std::vector<std::uint64_t> hashes;
+    for (const auto& source : sources) {
+        hashes.push_back(RuleImage::Hash(std::as_bytes(std::span(source.name))));
+        hashes.push_back(source.hash);
+    }
+    const std::uint64_t sourceHash = RuleImage::Hash(std::as_bytes(std::span(hashes)));
+
+    const auto imagePath = GetImagePath(a_path);
+    switch (m_image.Load(imagePath, sourceHash, m_formIDRangeIndex, m_keywordRules, m_patternRules)) {
+        case RuleImage::Status::kLoaded:
+            LogLoaded(spdlog::fmt_lib::format("rule image '{}'", imagePath.string()));
+            spdlog::trace("<<<< Exiting HighHeelRules::Load (result: true)");
+            return true;
+        case RuleImage::Status::kMissing:
+            spdlog::debug("No rule image at '{}', parsing JSON.", imagePath.string());
+            break;
+        case RuleImage::Status::kStale:
+            spdlog::info("Rule image '{}' was built from other rule files, rebuilding.", imagePath.string());
+            break;
+        case RuleImage::Status::kCorrupt:
+            spdlog::warn("Rule image '{}' is corrupt, rebuilding.", imagePath.string());
+            break;
+    }
+
+    std::vector<RuleFile> files(sources.size());
+    std::vector<char> isParsed(sources.size());
+    ParallelFor(sources.size(), [&](std::size_t a_index) {
+        auto& file = files[a_index];
+        file.source = sources[a_index].name;
+        try {
+            const auto bytes = sources[a_index].file.GetBytes();
+            const auto* text = reinterpret_cast<const char*>(bytes.data());
+            isParsed[a_index] = file.Parse(nlohmann::json::parse(text, text + bytes.size()));
+        } catch (const nlohmann::json::exception& e) {
+            spdlog::error("Failed to parse JSON from '{}'. Details: {}", file.source, e.what());
+            file.keywords.clear();
+            file.ranges.clear();
+            file.namePatterns.clear();
+            file.modelPathPatterns.clear();
+        }
+        sources[a_index].file.Close();
+    });
+
+    Merge(files);
+    const std::size_t parsedCount = std::ranges::count(isParsed, 1);
+    if (parsedCount == 0) {
+        spdlog::error("Failed to process rules from high heel definition file(s).");
+        spdlog::trace("<<<< Exiting HighHeelRules::Load (result: false)");
+        return false;
+    }
+    LogLoaded(spdlog::fmt_lib::format("{} of {} file(s)", parsedCount, files.size()));
+
+    // A file with errors would not get reported again if the image skipped it next launch.
+    if (parsedCount == files.size() &&
+        !RuleImage::Write(imagePath, sourceHash, m_formIDRangeIndex, m_keywordRules, m_patternRules)) {
+        spdlog::warn("Failed to write rule image '{}'. The JSON will be parsed again next launch.",
+                     imagePath.string());
+    }
+    spdlog::trace("<<<< Exiting HighHeelRules::Load (result: true)");
+    return true;
+}
+
+std::filesystem::path HighHeelRules::GetImagePath(const std::filesystem::path& a_path) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(a_path, ec)) {
+        return a_path / kDirectoryImageName;
+    }
+    auto imagePath = a_path;
+    imagePath += ".bin";
+    return imagePath;
+}
+
+std::uint64_t HighHeelRules::GetHash() const {
+    // The plugin slots are hash table layout, not rules.
+    const auto& index = m_formIDRangeIndex.GetView();
+    const std::uint64_t parts[] = {
+        RuleImage::Hash(std::as_bytes(index.names)), RuleImage::Hash(std::as_bytes(index.plugins)),
+        RuleImage::Hash(std::as_bytes(index.mins)),  RuleImage::Hash(std::as_bytes(index.maxs)),
+        RuleImage::Hash(std::as_bytes(m_keywordRules.GetView().names)),
+        RuleImage::Hash(std::as_bytes(m_patternRules.GetView().names)),
+        RuleImage::Hash(std::as_bytes(m_patternRules.GetView().patterns)),
+    };
+    return RuleImage::Hash(std::as_bytes(std::span(parts)));
+}
+
+void HighHeelRules::LogLoaded(std::string_view a_from) const {
+    spdlog::info(
+        "High heel rules loaded successfully from {}. Loaded {} keyword rule(s), {} FormID range rule(s) ({} merged "
+        "range(s) across {} plugin(s)), {} name pattern(s) and {} model path pattern(s) ({} automaton state(s), {} "
+        "KiB).",
+        a_from, m_keywordRules.GetNameCount(), m_formIDRangeIndex.GetRuleCount(), m_formIDRangeIndex.GetRangeCount(),
+        m_formIDRangeIndex.GetPluginCount(), m_patternRules.GetPatternCount(PatternRuleSet::Target::kName),
+        m_patternRules.GetPatternCount(PatternRuleSet::Target::kModelPath), m_patternRules.GetStateCount(),
+        (m_patternRules.GetMemoryUsage() + 1023) / 1024);
+}
+
+bool HighHeelRules::ParseJson(const nlohmann::json& j) {
+    spdlog::trace(">>>> Entering HighHeelRules::ParseJson");
+
+    RuleFile file;
+    file.source = "<json>";
+    const bool result = file.Parse(j);
+    Merge({&file, 1});
+
+    spdlog::trace("<<<< Exiting HighHeelRules::ParseJson (result: {})", result);
+    return result;
+}
+
+void HighHeelRules::Merge(std::span<const RuleFile> a_files) {
+    spdlog::trace(">>>> Entering HighHeelRules::Merge");
+    m_keywordRules.Clear();
+    m_formIDRangeIndex.Clear();
+    m_patternRules.Clear();
+    m_image.Close();
+
+    // Keywords keep the order they first appear in.
+    std::unordered_map<std::string_view, std::size_t> keywordSources;
+    for (std::size_t fileIndex = 0; fileIndex < a_files.size(); ++fileIndex) {
+        for (const auto& keyword : a_files[fileIndex].keywords) {
+            const auto [it, isNew] = keywordSources.emplace(keyword, fileIndex);
+            if (isNew) {
+                m_keywordRules.Add(keyword);
+            } else {
+                spdlog::debug("Keyword rule '{}' from '{}' is already defined by '{}'.", keyword,
+                              a_files[fileIndex].source, a_files[it->second].source);
+            }
+        }
+    }
+
+    // Patterns too, per section: the same text in both sections is two rules.
+    const auto mergePatterns = [&](PatternRuleSet::Target a_target, std::vector<std::string> RuleFile::* a_patterns,
+                                   const char* a_section) {
+        std::unordered_map<std::string_view, std::size_t> sources;
+        for (std::size_t fileIndex = 0; fileIndex < a_files.size(); ++fileIndex) {
+            for (const auto& pattern : a_files[fileIndex].*a_patterns) {
+                const auto [it, isNew] = sources.emplace(pattern, fileIndex);
+                if (isNew) {
+                    m_patternRules.Add(a_target, pattern);
+                } else {
+                    spdlog::debug("{} rule '{}' from '{}' is already defined by '{}'.", a_section, pattern,
+                                  a_files[fileIndex].source, a_files[it->second].source);
+                }
+            }
+        }
+    };
+    mergePatterns(PatternRuleSet::Target::kName, &RuleFile::namePatterns, "ByNamePattern");
+    mergePatterns(PatternRuleSet::Target::kModelPath, &RuleFile::modelPathPatterns, "ByModelPath");
+    m_patternRules.Build();
+
+    struct Entry {
+        std::string_view plugin;
+        std::uint32_t min;
+        std::uint32_t max;
+        std::uint32_t fileIndex;
+    };
+    std::vector<Entry> entries;
+    for (std::size_t fileIndex = 0; fileIndex < a_files.size(); ++fileIndex) {
+        for (const auto& range : a_files[fileIndex].ranges) {
+            entries.push_back({range.plugin, range.min, range.max, static_cast<std::uint32_t>(fileIndex)});
+        }
+    }
+    std::ranges::sort(entries, {}, [](const Entry& a_entry) {
+        return std::tuple(a_entry.plugin, a_entry.min, a_entry.max, a_entry.fileIndex);
+    });
+
+    // Plugin names are matched exactly, so two spellings of one plugin mean one set of rules never applies.
+    std::unordered_map<std::string, const Entry*> spellings;
+    const Entry* previous = nullptr;
+    const Entry* widest = nullptr;  // the range reaching furthest so far within the current plugin
+    for (const auto& entry : entries) {
+        const auto& source = a_files[entry.fileIndex].source;
+        const bool isSamePlugin = previous && previous->plugin == entry.plugin;
+        if (!isSamePlugin) {
+            const auto [it, isNew] = spellings.emplace(ToLower(entry.plugin), &entry);
+            if (!isNew) {
+                spdlog::warn(
+                    "Conflicting plugin names: '{}' in '{}' and '{}' in '{}'. Only rules spelled like the plugin's "
+                    "file name will match.",
+                    it->second->plugin, a_files[it->second->fileIndex].source, entry.plugin, source);
+            }
+            widest = nullptr;
+        }
+
+        if (isSamePlugin && previous->min == entry.min && previous->max == entry.max) {
+            if (previous->fileIndex != entry.fileIndex) {
+                spdlog::debug("FormID range rule [{:#x} - {:#x}] for '{}' from '{}' is already defined by '{}'.",
+                              entry.min, entry.max, entry.plugin, source, a_files[previous->fileIndex].source);
+            }
+            previous = &entry;
+            continue;
+        }
+
+        if (widest && entry.min <= widest->max && widest->fileIndex != entry.fileIndex) {
+            spdlog::info(
+                "FormID range rule [{:#x} - {:#x}] for '{}' from '{}' overlaps [{:#x} - {:#x}] from '{}'; the ranges "
+                "are combined.",
+                entry.min, entry.max, entry.plugin, source, widest->min, widest->max,
+                a_files[widest->fileIndex].source);
+        }
+        if (!widest || entry.max > widest->max) {
+            widest = &entry;
+        }
+
+        m_formIDRangeIndex.Add(entry.plugin, entry.min, entry.max);
+        previous = &entry;
+    }
+
+    m_formIDRangeIndex.Build();
+    spdlog::debug("Compiled {} FormID range rule(s) into {} merged range(s) across {} plugin(s).",
+                  m_formIDRangeIndex.GetRuleCount(), m_formIDRangeIndex.GetRangeCount(),
+                  m_formIDRangeIndex.GetPluginCount());
+    spdlog::debug("Compiled {} pattern rule(s) into an automaton of {} state(s).", m_patternRules.GetPatternCount(),
+                  m_patternRules.GetStateCount());
+    spdlog::trace("<<<< Exiting HighHeelRules::Merge");
+}
+
+std::vector<std::string> HighHeelRules::ResolveKeywords(const KeywordRuleSet::Resolver& a_resolver) {
+    spdlog::trace(">>>> Entering HighHeelRules::ResolveKeywords");
+
+    auto unresolved = m_keywordRules.Resolve(a_resolver);
+    for (const auto& name : unresolved) {
+        spdlog::warn("Keyword rule '{}' does not name any loaded keyword and will never match.", name);
+    }
+
+    spdlog::info("Resolved {} of {} keyword rule(s).", m_keywordRules.GetNameCount() - unresolved.size(),
+                 m_keywordRules.GetNameCount());
+    spdlog::trace("<<<< Exiting HighHeelRules::ResolveKeywords");
+    return unresolved;
+}
+
+bool HighHeelRules::Classify(const ArmorInfo& a_armor) const {
+    AP_LOG_TRACE(">>>> Entering HighHeelRules::Classify");
+
+    AP_LOG_DEBUG("Checking if armor {:#x} is a high heel...", a_armor.formID);
+
+    // Keyword rules only match once resolved on kDataLoaded; nothing is equipped before that.
+    if (const auto* kw = m_keywordRules.Match(a_armor.keywords)) {
+        AP_LOG_DEBUG("Decision: YES. Matched keyword rule: '{}'.", kw);
+        AP_LOG_TRACE("<<<< Exiting HighHeelRules::Classify (result: true)");
+        return true;
+    }
+
+    if (a_armor.plugin.empty()) {
+        AP_LOG_TRACE("Cannot check by FormID: armor has an invalid file pointer.");
+    } else if (const auto range = m_formIDRangeIndex.Find(a_armor.plugin, a_armor.localFormID)) {
+        AP_LOG_DEBUG("Decision: YES. Matched FormID range rule. Plugin: '{}', FormID {:#x} is in [{:#x} - {:#x}].",
+                     a_armor.plugin, a_armor.localFormID, range->min, range->max);
+        AP_LOG_TRACE("<<<< Exiting HighHeelRules::Classify (result: true)");
+        return true;
+    }
+
+    if (const auto* pattern = MatchPatterns(a_armor.name, a_armor.modelPaths)) {
+        AP_LOG_DEBUG("Decision: YES. Matched pattern rule '{}' on name '{}'.", pattern, a_armor.name);
+        AP_LOG_TRACE("<<<< Exiting HighHeelRules::Classify (result: true)");
+        return true;
+    }
+
+    AP_LOG_DEBUG("Decision: NO. No matching rules found for armor {:#x}.", a_armor.formID);
+    AP_LOG_TRACE("<<<< Exiting HighHeelRules::Classify (result: false)");
+    return false;
+}
+
+void HighHeelRules::ClassifyBatch(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) const {
+    AP_LOG_TRACE(">>>> Entering HighHeelRules::ClassifyBatch");
+
+    // The range queries are staged in blocks that stay in the L1 cache, then answered a whole block at a time.
+    constexpr std::size_t kBlockSize = 256;
+    std::array<std::uint32_t, kBlockSize> pluginIDs;
+    std::array<std::uint32_t, kBlockSize> localFormIDs;
+    const std::size_t count = std::min(a_keys.size(), a_out.size());
+
+    std::string_view lastPlugin;
+    std::uint32_t lastPluginID = FormIDRangeIndex::kInvalidPluginID;
+    for (std::size_t begin = 0; begin < count; begin += kBlockSize) {
+        const std::size_t size = std::min(kBlockSize, count - begin);
+        for (std::size_t i = 0; i < size; ++i) {
+            const ArmorKey& key = a_keys[begin + i];
+            // Armors of one plugin usually come together and share its name, so most keys skip the hash probe.
+            if (key.plugin.data() != lastPlugin.data() || key.plugin.size() != lastPlugin.size()) {
+                lastPlugin = key.plugin;
+                lastPluginID = key.plugin.empty() ? FormIDRangeIndex::kInvalidPluginID
+                                                  : m_formIDRangeIndex.FindPluginID(key.plugin);
+            }
+            pluginIDs[i] = lastPluginID;
+            localFormIDs[i] = key.localFormID;
+        }
+
+        const auto out = a_out.subspan(begin, size);
+        m_formIDRangeIndex.FindBatch(std::span(pluginIDs).first(size), std::span(localFormIDs).first(size), out);
+        for (std::size_t i = 0; i < size; ++i) {
+            const ArmorKey& key = a_keys[begin + i];
+            if (!out[i] && (m_keywordRules.Match(key.keywords) || MatchPatterns(key.name, key.modelPaths))) {
+                out[i] = 1;
+            }
+        }
+    }
+
+    AP_LOG_TRACE("<<<< Exiting HighHeelRules::ClassifyBatch (armors: {})", count);
+}
+
+const char* HighHeelRules::MatchPatterns(std::string_view a_name,
+                                         std::span<const std::string_view> a_modelPaths) const {
+    if (m_patternRules.GetPatternCount() == 0) {
+        return nullptr;
+    }
+    if (const auto* pattern = m_patternRules.Match(PatternRuleSet::Target::kName, a_name)) {
+        return pattern;
+    }
+    for (const auto path : a_modelPaths) {
+        if (const auto* pattern = m_patternRules.Match(PatternRuleSet::Target::kModelPath, path)) {
+            return pattern;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <vector>
+#include "Adapters.h"
+#include "FormIDRangeIndex.h"
+#include "KeywordRuleSet.h"
+#include "PatternRuleSet.h"
+#include "RuleImage.h"
+
+// The rules of one JSON file, parsed but not compiled yet.
+struct RuleFile {
+    struct RangeRule {
+        std::string plugin;
+        std::uint32_t min{};
+        std::uint32_t max{};
+    };
+
+    std::string source;  // file name, for messages
+    std::vector<std::string> keywords;
+    std::vector<RangeRule> ranges;
+    std::vector<std::string> namePatterns;
+    std::vector<std::string> modelPathPatterns;
+
+    // Returns false when a section is malformed; the rules read up to that point are kept.
+    bool Parse(const nlohmann::json& j);
+
+private:
+    bool ParseKeywords(const nlohmann::json& j);
+    bool ParseFormIDRange(const nlohmann::json& j);
+    bool ParsePatterns(const nlohmann::json& j, const char* a_section, std::vector<std::string>& a_out);
+};
+
+// The rules of the rule directory (or of a single JSON file) in compiled form, and the decision of whether an armor
+// is a high heel.
+//
+// Load() reads and parses the *.json files of the directory on a worker pool, then merges them in file name order
+// into one rule set: duplicates dropped, overlapping ranges combined, and conflicts between files reported with the
+// files they come from. It keeps a RuleImage of the merged rules in the directory and uses it in place while it
+// matches every file.
+class HighHeelRules {
+public:
+    static constexpr const char* kDirectoryImageName = "RuleCache.bin";
+
+    bool Load(const std::filesystem::path& a_path);
+    // The *.json files directly inside a_directory, sorted by file name so the merge does not depend on the file
+    // system.
+    static std::vector<std::filesystem::path> ListRuleFiles(const std::filesystem::path& a_directory,
+                                                            std::error_code& a_ec);
+    static std::filesystem::path GetImagePath(const std::filesystem::path& a_path);
+    bool ParseJson(const nlohmann::json& j);
+    // Compiles a_files as if they had been loaded together, in this order.
+    void Merge(std::span<const RuleFile> a_files);
+
+    // Returns the keyword editor IDs that did not resolve.
+    std::vector<std::string> ResolveKeywords(const KeywordRuleSet::Resolver& a_resolver);
+
+    bool Classify(const ArmorInfo& a_armor) const;
+    // a_out[i] = 1 when a_keys[i] is a high heel, else 0; the same verdicts as Classify(), without its logging. The
+    // spans must have the same size.
+    void ClassifyBatch(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) const;
+
+    // Identifies the compiled rules: rule files that merge into the same rules hash the same, however they are split
+    // or formatted. Keywords count by editor ID, so the hash does not depend on the load order.
+    std::uint64_t GetHash() const;
+
+    const FormIDRangeIndex& GetFormIDRangeIndex() const { return m_formIDRangeIndex; }
+    const KeywordRuleSet& GetKeywordRules() const { return m_keywordRules; }
+    const PatternRuleSet& GetPatternRules() const { return m_patternRules; }
+
+private:
+    void LogLoaded(std::string_view a_from) const;
+    // The first pattern rule matching the armor name or one of its model paths, or nullptr.
+    const char* MatchPatterns(std::string_view a_name, std::span<const std::string_view> a_modelPaths) const;
+
+    FormIDRangeIndex m_formIDRangeIndex;
+    KeywordRuleSet m_keywordRules;
+    PatternRuleSet m_patternRules;
+    RuleImage m_image;  // backs the rule sets when loaded from an image
+};
@@ -0,0 +1,77 @@
+#include "KeywordRuleSet.h"
+#include <algorithm>
+
+void KeywordRuleSet::Clear() {
+    m_names.clear();
+    m_offsets.clear();
+    m_view = {};
+    m_resolved.clear();
+    m_isResolved = false;
+}
+
+void KeywordRuleSet::Add(std::string_view a_editorID) {
+    m_offsets.push_back(static_cast<std::uint32_t>(m_names.size()));
+    m_names.insert(m_names.end(), a_editorID.begin(), a_editorID.end());
+    m_names.push_back('\0');
+    m_view = {m_names, m_offsets};
+}
+
+bool KeywordRuleSet::Attach(const View& a_view) {
+    Clear();
+
+    if (!a_view.names.empty() && a_view.names.back() != '\0') {
+        return false;
+    }
+    for (const std::uint32_t offset : a_view.offsets) {
+        if (offset >= a_view.names.size()) {
+            return false;
+        }
+    }
+
+    m_view = a_view;
+    return true;
+}
+
+std::vector<std::string> KeywordRuleSet::Resolve(const Resolver& a_resolver) {
+    std::vector<std::string> unresolved;
+    m_resolved.clear();
+
+    for (std::uint32_t i = 0; i < GetNameCount(); ++i) {
+        const char* name = GetName(i);
+        if (const auto formID = a_resolver(name)) {
+            m_resolved.push_back({*formID, i});
+        } else {
+            unresolved.emplace_back(name);
+        }
+    }
+
+    // Duplicate names resolve to the same keyword; keep the first rule that named it.
+    std::ranges::stable_sort(m_resolved, {}, &Entry::formID);
+    const auto duplicates = std::ranges::unique(m_resolved, {}, &Entry::formID);
+    m_resolved.erase(duplicates.begin(), duplicates.end());
+
+    m_isResolved = true;
+    return unresolved;
+}
+
+void KeywordRuleSet::Unresolve() {
+    m_resolved.clear();
+    m_isResolved = false;
+}
+
+const char* KeywordRuleSet::Find(std::uint32_t a_keywordFormID) const {
+    const auto it = std::ranges::lower_bound(m_resolved, a_keywordFormID, {}, &Entry::formID);
+    if (it == m_resolved.end() || it->formID != a_keywordFormID) {
+        return nullptr;
+    }
+    return GetName(it->nameIndex);
+}
+
+const char* KeywordRuleSet::Match(std::span<const std::uint32_t> a_keywordFormIDs) const {
+    for (const std::uint32_t formID : a_keywordFormIDs) {
+        if (const auto* name = Find(formID)) {
+            return name;
+        }
+    }
+    return nullptr;
+}
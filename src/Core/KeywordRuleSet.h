@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compiled form of the "ByKeywords" rules.
+//
+// Rules are loaded as keyword editor IDs. Once the game data is loaded, Resolve() maps every name to its keyword
+// FormID a single time and keeps the result as a small sorted set, so matching an armor becomes an integer
+// intersection of its keyword FormIDs with that set instead of a string compare per keyword per rule.
+//
+// The names live in one blob of NUL-terminated strings, which can also be attached in place from a rule image.
+class KeywordRuleSet {
+public:
+    using Resolver = std::function<std::optional<std::uint32_t>(std::string_view a_editorID)>;
+
+    struct View {
+        std::span<const char> names;             // NUL-terminated editor IDs, back to back
+        std::span<const std::uint32_t> offsets;  // start of each name in names
+    };
+
+    void Clear();
+    void Add(std::string_view a_editorID);
+
+    const View& GetView() const { return m_view; }
+    // Uses a_view in place; see FormIDRangeIndex::Attach. Returns false, leaving the set empty, when it is malformed.
+    bool Attach(const View& a_view);
+
+    // Returns the editor IDs that did not resolve to a keyword. Those rules can never match.
+    std::vector<std::string> Resolve(const Resolver& a_resolver);
+    void Unresolve();
+
+    bool IsResolved() const { return m_isResolved; }
+    std::size_t GetNameCount() const { return m_view.offsets.size(); }
+    const char* GetName(std::size_t a_index) const { return m_view.names.data() + m_view.offsets[a_index]; }
+    std::size_t GetResolvedCount() const { return m_resolved.size(); }
+
+    // Return the name of the rule that matched, or nullptr. Only valid once resolved.
+    const char* Find(std::uint32_t a_keywordFormID) const;
+    const char* Match(std::span<const std::uint32_t> a_keywordFormIDs) const;
+
+private:
+    struct Entry {
+        std::uint32_t formID{};
+        std::uint32_t nameIndex{};
+    };
+
+    std::vector<char> m_names;
+    std::vector<std::uint32_t> m_offsets;
+    View m_view;
+    std::vector<Entry> m_resolved;  // sorted by formID
+    bool m_isResolved{false};
+};
@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& a_other) noexcept { *this = std::move(a_other); }
+
+MappedFile& MappedFile::operator=(MappedFile&& a_other) noexcept {
+    if (this != &a_other) {
+        Close();
+        m_data = std::exchange(a_other.m_data, nullptr);
+        m_size = std::exchange(a_other.m_size, 0);
+        m_isOpen = std::exchange(a_other.m_isOpen, false);
+#ifdef _WIN32
+        m_mapping = std::exchange(a_other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::filesystem::path& a_path) {
+    Close();
+
+    HANDLE file = ::CreateFileW(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (!::GetFileSizeEx(file, &size)) {
+        ::CloseHandle(file);
+        return false;
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // A mapping of an empty file cannot be created, and is not needed.
+    if (m_size != 0) {
+        m_mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping) {
+            m_data = static_cast<const std::byte*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    ::CloseHandle(file);
+
+    if (m_size != 0 && !m_data) {
+        Close();
+        return false;
+    }
+    m_isOpen = true;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        ::UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        ::CloseHandle(m_mapping);
+    }
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+#else
+bool MappedFile::Open(const std::filesystem::path& a_path) {
+    Close();
+
+    const int fd = ::open(a_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    // mmap rejects a zero length, and an empty file needs no mapping.
+    if (m_size != 0) {
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        m_data = data != MAP_FAILED ? static_cast<const std::byte*>(data) : nullptr;
+    }
+    ::close(fd);
+
+    if (m_size != 0 && !m_data) {
+        Close();
+        return false;
+    }
+    m_isOpen = true;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        ::munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+#endif
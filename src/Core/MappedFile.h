@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& a_other) noexcept;
+    MappedFile& operator=(MappedFile&& a_other) noexcept;
+
+    bool Open(const std::filesystem::path& a_path);
+    void Close();
+
+    bool IsOpen() const { return m_isOpen; }
+    std::span<const std::byte> GetBytes() const { return {m_data, m_size}; }
+
+private:
+    const std::byte* m_data{};
+    std::size_t m_size{};
+    bool m_isOpen{false};
+#ifdef _WIN32
+    void* m_mapping{};
+#endif
+};
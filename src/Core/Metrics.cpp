@@ -0,0 +1,137 @@
+#include "Metrics.h"
+
+#if AP_ENABLE_METRICS
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <bit>
+    #include <iterator>
+    #include <new>
+    #include <spdlog/spdlog.h>
+
+namespace {
+    constexpr std::size_t kCacheLine = 64;
+    constexpr std::size_t kBucketCount = 40;  // 2^39 ns is over nine minutes
+
+    struct alignas(kCacheLine) PaddedCounter {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    struct alignas(kCacheLine) Histogram {
+        std::atomic<std::uint64_t> totalNs{0};
+        std::array<std::atomic<std::uint64_t>, kBucketCount> buckets{};
+    };
+
+    constexpr std::array<const char*, static_cast<std::size_t>(Metrics::Counter::kCount)> kCounterNames{
+        "events seen",          "passed: prefilter",       "filtered: prefilter", "filtered: not an actor",
+        "filtered: not armor",  "filtered: not footwear",  "classifications",     "flushes",
+        "actors flushed",       "morph intents cancelled", "actors reconciled",   "reconcile mismatches",
+        "SKEE morph queries",   "SKEE SetMorph",           "SKEE ClearMorph",     "SKEE ApplyBodyMorphs"};
+    constexpr std::array<const char*, static_cast<std::size_t>(Metrics::Stage::kCount)> kStageNames{
+        "event filter", "classification", "morph apply"};
+
+    std::array<PaddedCounter, static_cast<std::size_t>(Metrics::Counter::kCount)> g_counters;
+    std::array<Histogram, static_cast<std::size_t>(Metrics::Stage::kCount)> g_histograms;
+    std::atomic<std::int64_t> g_nextDumpTicks{0};
+    std::atomic<std::int64_t> g_dumpIntervalTicks{
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(AP_METRICS_DUMP_INTERVAL_SECONDS))
+            .count()};
+
+    // Upper bound, in ns, of the bucket holding the a_fraction quantile.
+    std::uint64_t EstimateQuantile(const std::array<std::uint64_t, kBucketCount>& a_buckets, std::uint64_t a_count,
+                                   double a_fraction) {
+        const auto target = static_cast<std::uint64_t>(a_fraction * static_cast<double>(a_count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            seen += a_buckets[i];
+            if (seen >= target) {
+                return std::uint64_t{1} << i;
+            }
+        }
+        return std::uint64_t{1} << (kBucketCount - 1);
+    }
+}
+
+void Metrics::Increment(Counter a_counter) {
+    g_counters[static_cast<std::size_t>(a_counter)].value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::Record(Stage a_stage, std::chrono::nanoseconds a_elapsed) {
+    auto& histogram = g_histograms[static_cast<std::size_t>(a_stage)];
+    const auto ns = static_cast<std::uint64_t>(a_elapsed.count() > 0 ? a_elapsed.count() : 0);
+    const std::size_t bucket = std::min<std::size_t>(std::bit_width(ns), kBucketCount - 1);
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.totalNs.fetch_add(ns, std::memory_order_relaxed);
+}
+
+std::string Metrics::FormatSummary() {
+    using spdlog::fmt_lib::format_to;
+
+    std::string out;
+    auto inserter = std::back_inserter(out);
+
+    for (std::size_t i = 0; i < kCounterNames.size(); ++i) {
+        format_to(inserter, "  {:<24}{}\n", kCounterNames[i], g_counters[i].value.load(std::memory_order_relaxed));
+    }
+    const auto seen = g_counters[static_cast<std::size_t>(Counter::kEventsSeen)].value.load(std::memory_order_relaxed);
+    const auto rejected =
+        g_counters[static_cast<std::size_t>(Counter::kFilteredPrefilter)].value.load(std::memory_order_relaxed);
+    if (seen != 0) {
+        format_to(inserter, "  {:<24}{:.1f}%\n", "prefilter reject rate", 100.0 * rejected / seen);
+    }
+
+    for (std::size_t i = 0; i < kStageNames.size(); ++i) {
+        const auto& histogram = g_histograms[i];
+        std::array<std::uint64_t, kBucketCount> buckets;
+        std::uint64_t count = 0;
+        for (std::size_t b = 0; b < kBucketCount; ++b) {
+            buckets[b] = histogram.buckets[b].load(std::memory_order_relaxed);
+            count += buckets[b];
+        }
+        if (count == 0) {
+            format_to(inserter, "  {:<24}no samples\n", kStageNames[i]);
+            continue;
+        }
+        const std::uint64_t totalNs = histogram.totalNs.load(std::memory_order_relaxed);
+        format_to(inserter, "  {:<24}{} sample(s), mean {} ns, p50 <= {} ns, p99 <= {} ns, max <= {} ns\n",
+                  kStageNames[i], count, totalNs / count, EstimateQuantile(buckets, count, 0.50),
+                  EstimateQuantile(buckets, count, 0.99), EstimateQuantile(buckets, count, 1.0));
+    }
+    return out;
+}
+
+void Metrics::LogSummary(const char* a_reason) {
+    const std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    g_nextDumpTicks.store(now + g_dumpIntervalTicks.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    spdlog::info("Metrics ({}):\n{}", a_reason, FormatSummary());
+}
+
+void Metrics::DumpIfDue(const char* a_reason) {
+    const std::int64_t interval = g_dumpIntervalTicks.load(std::memory_order_relaxed);
+    if (interval <= 0) {
+        return;
+    }
+    const std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::int64_t next = g_nextDumpTicks.load(std::memory_order_relaxed);
+    if (now < next) {
+        return;
+    }
+
+    // Only the thread that moves the deadline logs. The first call just arms the timer.
+    if (!g_nextDumpTicks.compare_exchange_strong(next, now + interval, std::memory_order_relaxed) || next == 0) {
+        return;
+    }
+    LogSummary(a_reason);
+}
+
+void Metrics::SetDumpInterval(std::chrono::seconds a_interval) {
+    g_dumpIntervalTicks.store(std::chrono::duration_cast<std::chrono::steady_clock::duration>(a_interval).count(),
+                              std::memory_order_relaxed);
+    if (a_interval.count() == 0) {
+        spdlog::info("Periodic metrics summaries are off.");
+    } else {
+        spdlog::info("Logging a metrics summary every {} s.", a_interval.count());
+    }
+}
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Counters and latency histograms for the hot paths, reported through the plugin log.
+//
+// Recording is a relaxed atomic increment on a cache line of its own: no locks, no allocation. Histograms bucket
+// by log2 of the nanoseconds spent, so a summary reads as "how many samples took 2^k ns or less". With
+// AP_ENABLE_METRICS off, the AP_METRICS_* macros expand to nothing and no code touches this header's functions.
+#ifndef AP_ENABLE_METRICS
+    #define AP_ENABLE_METRICS 0
+#endif
+
+#ifndef AP_METRICS_DUMP_INTERVAL_SECONDS
+    #define AP_METRICS_DUMP_INTERVAL_SECONDS 300
+#endif
+
+namespace Metrics {
+    enum class Counter : std::uint8_t {
+        kEventsSeen,
+        kPassedPrefilter,
+        kFilteredPrefilter,
+        kFilteredNotActor,
+        kFilteredNotArmor,
+        kFilteredNotFootwear,
+        kClassifications,
+        kFlushes,
+        kActorsFlushed,
+        kMorphIntentsCancelled,
+        kActorsReconciled,
+        kReconcileMismatches,
+        kSkeeMorphQueries,
+        kSkeeSetMorph,
+        kSkeeClearMorph,
+        kSkeeApplyBodyMorphs,
+        kCount
+    };
+
+    enum class Stage : std::uint8_t { kEventFilter, kClassification, kMorphApply, kCount };
+
+    void Increment(Counter a_counter);
+    void Record(Stage a_stage, std::chrono::nanoseconds a_elapsed);
+
+    std::string FormatSummary();
+    // Logs a summary now, e.g. on save, and restarts the dump interval from here.
+    void LogSummary(const char* a_reason);
+    // Logs a summary under a_reason when the dump interval has passed since the last one. Cheap enough to call once
+    // per flush or frame.
+    void DumpIfDue(const char* a_reason);
+    // Replaces the AP_METRICS_DUMP_INTERVAL_SECONDS default, e.g. with the one from PluginSettings. Zero stops the
+    // periodic summaries.
+    void SetDumpInterval(std::chrono::seconds a_interval);
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage a_stage) : m_stage(a_stage), m_start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { Record(m_stage, std::chrono::steady_clock::now() - m_start); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Stage m_stage;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#if AP_ENABLE_METRICS
+    #define AP_METRICS_CONCAT_IMPL(a, b) a##b
+    #define AP_METRICS_CONCAT(a, b) AP_METRICS_CONCAT_IMPL(a, b)
+    #define AP_METRICS_COUNT(counter) ::Metrics::Increment(::Metrics::Counter::counter)
+    #define AP_METRICS_TIME_SCOPE(stage) \
+        const ::Metrics::ScopedTimer AP_METRICS_CONCAT(metricsTimer, __LINE__)(::Metrics::Stage::stage)
+    #define AP_METRICS_LOG_SUMMARY(reason) ::Metrics::LogSummary(reason)
+    #define AP_METRICS_DUMP_IF_DUE(reason) ::Metrics::DumpIfDue(reason)
+#else
+    #define AP_METRICS_COUNT(counter) ((void)0)
+    #define AP_METRICS_TIME_SCOPE(stage) ((void)0)
+    #define AP_METRICS_LOG_SUMMARY(reason) ((void)0)
+    #define AP_METRICS_DUMP_IF_DUE(reason) ((void)0)
+#endif
@@ -0,0 +1,190 @@
+#include "MorphApplier.h"
+#include "DeferredLog.h"
+#include "Metrics.h"
+#include <spdlog/spdlog.h>
+
+bool MorphApplier::UpdateMorphState(const ActorHandle& a_actor, MorphStateMachine::State a_state) {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::UpdateMorphState");
+    AP_METRICS_TIME_SCOPE(kMorphApply);
+
+    if (!a_actor) {
+        spdlog::warn("MorphApplier::UpdateMorphState - Actor is null");
+        AP_LOG_TRACE("<<<< Exiting MorphApplier::UpdateMorphState (no actor)");
+        return false;
+    }
+
+    if (a_state == MorphStateMachine::State::kInvalid) {
+        spdlog::warn("MorphApplier::UpdateMorphState - Refusing to apply the invalid state");
+        AP_LOG_TRACE("<<<< Exiting MorphApplier::UpdateMorphState (invalid state)");
+        return false;
+    }
+
+    AP_LOG_TRACE("MorphApplier::UpdateMorphState - Actor: {:#x}, state: {}", a_actor.formID,
+                  static_cast<int>(a_state));
+
+    std::scoped_lock lock(m_appliedMorphsLock);
+    const auto from = GetAppliedState(a_actor.formID);
+
+    if (from == a_state) {
+        AP_LOG_TRACE("MorphApplier::UpdateMorphState - State {} already applied, skipping", static_cast<int>(a_state));
+        AP_LOG_TRACE("<<<< Exiting MorphApplier::UpdateMorphState (unchanged)");
+        return false;
+    }
+
+    bool isMorphChanged = false;
+    if (from == MorphStateMachine::State::kInvalid) {
+        isMorphChanged = Reconcile(a_actor, a_state);
+    } else {
+        for (const auto& op : MorphStateMachine::Diff(from, a_state)) {
+            RecordMorph(a_actor, op);
+            isMorphChanged = true;
+        }
+    }
+    m_appliedStates.Store(a_actor.formID, static_cast<std::uint8_t>(a_state));
+
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::UpdateMorphState (result: {})", isMorphChanged);
+    return isMorphChanged;
+}
+
+bool MorphApplier::Reconcile(const ActorHandle& a_actor, MorphStateMachine::State a_state) {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::Reconcile");
+    AP_METRICS_COUNT(kActorsReconciled);
+
+    bool isMorphChanged = false;
+
+    // Morphs written by releases before the key was renamed.
+    AP_METRICS_COUNT(kSkeeMorphQueries);
+    if (m_backend.HasBodyMorphKey(a_actor, kLegacyMorphKey)) {
+        AP_LOG_TRACE("MorphApplier::Reconcile - Clearing legacy morph keys");
+        m_commands.ClearMorph(a_actor, "NoHeel", kLegacyMorphKey, true);
+        isMorphChanged = true;
+    }
+
+    // Without any morph under the key there is nothing to read morph by morph. A morph recorded but not committed
+    // yet, e.g. for an actor forgotten since, is what the backend will hold once it is.
+    AP_METRICS_COUNT(kSkeeMorphQueries);
+    const bool hasMorphs = m_backend.HasBodyMorphKey(a_actor, kMorphKey);
+    for (std::size_t i = 0; i < MorphStateMachine::kMorphCount; ++i) {
+        const auto morph = static_cast<MorphStateMachine::Morph>(i);
+        const char* morphName = MorphStateMachine::GetMorphName(morph);
+        bool isSet = false;
+        if (const auto pending = m_commands.FindIntent(a_actor.formID, morphName, kMorphKey)) {
+            isSet = *pending;
+        } else if (hasMorphs) {
+            AP_METRICS_COUNT(kSkeeMorphQueries);
+            isSet = m_backend.GetMorph(a_actor, morphName, kMorphKey) != 0.0f;
+        }
+        if (isSet != MorphStateMachine::IsMorphSet(a_state, morph)) {
+            RecordMorph(a_actor, {morph, !isSet});
+            isMorphChanged = true;
+        }
+    }
+
+    if (isMorphChanged) {
+        AP_METRICS_COUNT(kReconcileMismatches);
+    }
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::Reconcile (result: {})", isMorphChanged);
+    return isMorphChanged;
+}
+
+void MorphApplier::RecordMorph(const ActorHandle& a_actor, const MorphStateMachine::MorphOp& a_op) {
+    // Every op flips a morph whose current value is known, so a later op in the same tick may cancel it.
+    const char* morphName = MorphStateMachine::GetMorphName(a_op.morph);
+    if (a_op.isSet) {
+        AP_LOG_TRACE("MorphApplier::RecordMorph - Applying {} morph", morphName);
+        m_commands.SetMorph(a_actor, morphName, kMorphKey, 1.0f, true);
+    } else {
+        AP_LOG_TRACE("MorphApplier::RecordMorph - Clearing {} morph", morphName);
+        m_commands.ClearMorph(a_actor, morphName, kMorphKey, true);
+    }
+}
+
+bool MorphApplier::RequestCommit() {
+    std::scoped_lock lock(m_appliedMorphsLock);
+    if (m_isCommitRequested || m_commands.IsEmpty()) {
+        return false;
+    }
+    m_isCommitRequested = true;
+    return true;
+}
+
+std::size_t MorphApplier::Commit(IArmorLookup& a_actors) {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::Commit");
+
+    MorphCommandBuffer commands;
+    {
+        std::scoped_lock lock(m_appliedMorphsLock);
+        std::swap(commands, m_commands);
+        m_isCommitRequested = false;
+    }
+
+    // The backend is called without the lock, so equip events on other threads never wait for SKEE.
+    std::vector<std::uint32_t> vanished;
+    const std::size_t applied = commands.Flush(m_backend, a_actors, vanished);
+    if (!vanished.empty()) {
+        std::scoped_lock lock(m_appliedMorphsLock);
+        for (const std::uint32_t formID : vanished) {
+            m_appliedStates.Erase(formID);
+        }
+    }
+
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::Commit (result: {})", applied);
+    return applied;
+}
+
+MorphStateMachine::State MorphApplier::GetAppliedState(std::uint32_t a_actorFormID) const {
+    const auto state = m_appliedStates.Find(a_actorFormID);
+    return state ? static_cast<MorphStateMachine::State>(*state) : MorphStateMachine::State::kInvalid;
+}
+
+void MorphApplier::ResetAppliedMorphs() {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::ResetAppliedMorphs");
+
+    // SKEE restores morphs from the save being loaded, so nothing we remember about applied morphs still holds. The
+    // next update of every actor reads its morphs back instead.
+    std::scoped_lock lock(m_appliedMorphsLock);
+    AP_LOG_DEBUG("MorphApplier::ResetAppliedMorphs - Forgetting applied morphs of {} actor(s)",
+                  m_appliedStates.GetSize());
+    m_appliedStates.Clear();
+    m_commands = {};
+
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::ResetAppliedMorphs");
+}
+
+void MorphApplier::ForgetActor(std::uint32_t a_actorFormID) {
+    // Morphs still buffered for the actor are committed as usual; Reconcile() accounts for them if it comes back
+    // before that.
+    m_appliedStates.Erase(a_actorFormID);
+}
+
+std::size_t MorphApplier::RetainActors(const std::function<bool(std::uint32_t)>& a_isKept) {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::RetainActors");
+    const std::size_t forgotten =
+        m_appliedStates.EraseIf([&a_isKept](std::uint32_t a_formID) { return !a_isKept(a_formID); });
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::RetainActors (result: {})", forgotten);
+    return forgotten;
+}
+
+std::vector<MorphStateRecord::Entry> MorphApplier::GetCommittedStates() {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::GetCommittedStates");
+    std::vector<MorphStateRecord::Entry> states;
+    std::scoped_lock lock(m_appliedMorphsLock);
+    states.reserve(m_appliedStates.GetSize());
+    m_appliedStates.ForEach([this, &states](std::uint32_t a_formID, std::uint8_t a_state) {
+        // Saved now, the backend would restore the morphs from before the pending writes.
+        if (!m_commands.HasIntents(a_formID)) {
+            states.push_back({a_formID, static_cast<MorphStateMachine::State>(a_state)});
+        }
+    });
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::GetCommittedStates (result: {})", states.size());
+    return states;
+}
+
+void MorphApplier::RestoreAppliedStates(std::span<const MorphStateRecord::Entry> a_states) {
+    AP_LOG_TRACE(">>>> Entering MorphApplier::RestoreAppliedStates");
+    std::scoped_lock lock(m_appliedMorphsLock);
+    for (const auto& entry : a_states) {
+        m_appliedStates.Store(entry.formID, static_cast<std::uint8_t>(entry.state));
+    }
+    AP_LOG_TRACE("<<<< Exiting MorphApplier::RestoreAppliedStates (result: {})", a_states.size());
+}
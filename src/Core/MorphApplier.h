@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "ActorStateStore.h"
+#include "Adapters.h"
+#include "MorphCommandBuffer.h"
+#include "MorphStateMachine.h"
+#include "MorphStateRecord.h"
+
+// Writes MorphStateMachine states to actors through an IMorphBackend and remembers what it wrote, so that a state
+// that is already applied costs no backend call at all.
+//
+// UpdateMorphState() records the morph changes in a MorphCommandBuffer; Commit() sends everything recorded since the
+// last one, with one deferred ApplyBodyMorphs per actor. The owner commits once per tick: the plugin once per frame
+// in which anything was recorded, see RequestCommit().
+//
+// The first update of an actor after ResetAppliedMorphs(), e.g. after a game load, reads back the morphs SKEE
+// restored and records only those that differ from the requested state, so an actor saved with the right morphs
+// costs a few queries and no write. Forgetting an actor at any other time, e.g. when it unloads or when the state
+// store evicts it to stay within its memory cap, costs the same and nothing more.
+class MorphApplier {
+public:
+    static constexpr const char* kMorphKey = "AdeptivePantyhoseMorphKey";
+    static constexpr const char* kLegacyMorphKey = "CH_AdeptivePantyhoseMorphKey";
+
+    explicit MorphApplier(IMorphBackend& a_backend,
+                          std::size_t a_stateMemoryCap = ActorStateStore::kDefaultMemoryCap)
+        : m_backend(a_backend), m_appliedStates(a_stateMemoryCap) {}
+
+    // Returns true when anything was recorded.
+    bool UpdateMorphState(const ActorHandle& a_actor, MorphStateMachine::State a_state);
+    // Returns true when changes are waiting and no commit has been requested since the last Commit(), meaning the
+    // caller has to schedule one.
+    bool RequestCommit();
+    // Writes the recorded changes. a_actors finds the actors again; the applied state of those that vanished in the
+    // meantime is forgotten. Returns the number of actors written.
+    std::size_t Commit(IArmorLookup& a_actors);
+    // Never blocks.
+    MorphStateMachine::State GetAppliedState(std::uint32_t a_actorFormID) const;
+    void ResetAppliedMorphs();
+    // Forgets the applied state of an actor that unloaded or was deleted.
+    void ForgetActor(std::uint32_t a_actorFormID);
+    // Forgets every actor a_isKept returns false for. Returns the number forgotten.
+    std::size_t RetainActors(const std::function<bool(std::uint32_t)>& a_isKept);
+    ActorStateStore::Stats GetStateStats() const { return m_appliedStates.GetStats(); }
+
+    // The applied state of every actor whose morphs the backend already has, i.e. with nothing left to commit: what
+    // the backend saves along with the game.
+    std::vector<MorphStateRecord::Entry> GetCommittedStates();
+    // Takes a_states as applied, e.g. restored from the co-save right after the backend restored the morphs.
+    void RestoreAppliedStates(std::span<const MorphStateRecord::Entry> a_states);
+
+private:
+    // Records what the actor's morphs, as the backend reports them, need to reach a_state. Returns true when
+    // anything was recorded.
+    bool Reconcile(const ActorHandle& a_actor, MorphStateMachine::State a_state);
+    void RecordMorph(const ActorHandle& a_actor, const MorphStateMachine::MorphOp& a_op);
+
+    IMorphBackend& m_backend;
+    // The state machine state last recorded for each actor. SKEE keeps morphs across equips, so when the requested
+    // state matches this there is nothing to write and, more importantly, no mesh to rebuild.
+    ActorStateStore m_appliedStates;
+    MorphCommandBuffer m_commands;
+    bool m_isCommitRequested{false};
+    // Serializes updates, and guards m_commands and m_isCommitRequested. Lookups in m_appliedStates go without it.
+    std::mutex m_appliedMorphsLock;
+};
@@ -0,0 +1,100 @@
+#include "MorphCommandBuffer.h"
+#include "DeferredLog.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstring>
+
+void MorphCommandBuffer::SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                                  float a_value, bool a_isChange) {
+    Record(a_actor, {a_morphName, a_morphKey, a_value, true, a_isChange});
+}
+
+void MorphCommandBuffer::ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                                    bool a_isChange) {
+    Record(a_actor, {a_morphName, a_morphKey, 0.0f, false, a_isChange});
+}
+
+void MorphCommandBuffer::Record(const ActorHandle& a_actor, const Intent& a_intent) {
+    ++m_stats.recorded;
+
+    const auto [it, isNew] = m_actorIndex.try_emplace(a_actor.formID, m_actors.size());
+    if (isNew) {
+        m_actors.push_back({a_actor.formID, {}});
+    }
+    auto& intents = m_actors[it->second].intents;
+
+    const auto earlier = std::ranges::find_if(intents, [&](const Intent& a_earlier) {
+        return std::strcmp(a_earlier.morphName, a_intent.morphName) == 0 &&
+               std::strcmp(a_earlier.morphKey, a_intent.morphKey) == 0;
+    });
+    if (earlier == intents.end()) {
+        intents.push_back(a_intent);
+        return;
+    }
+    if (earlier->isChange && earlier->isSet != a_intent.isSet) {
+        // Back to where the tick started.
+        AP_LOG_TRACE("MorphCommandBuffer::Record - {} on actor {:#x} cancels out", a_intent.morphName,
+                     a_actor.formID);
+        intents.erase(earlier);
+        ++m_stats.cancelled;
+        AP_METRICS_COUNT(kMorphIntentsCancelled);
+        return;
+    }
+    // The value before the tick is whatever the first intent assumed it was.
+    earlier->value = a_intent.value;
+    earlier->isSet = a_intent.isSet;
+}
+
+bool MorphCommandBuffer::HasIntents(std::uint32_t a_formID) const {
+    const auto it = m_actorIndex.find(a_formID);
+    return it != m_actorIndex.end() && !m_actors[it->second].intents.empty();
+}
+
+std::optional<bool> MorphCommandBuffer::FindIntent(std::uint32_t a_formID, const char* a_morphName,
+                                                   const char* a_morphKey) const {
+    const auto it = m_actorIndex.find(a_formID);
+    if (it == m_actorIndex.end()) {
+        return std::nullopt;
+    }
+    for (const auto& intent : m_actors[it->second].intents) {
+        if (std::strcmp(intent.morphName, a_morphName) == 0 && std::strcmp(intent.morphKey, a_morphKey) == 0) {
+            return intent.isSet;
+        }
+    }
+    return std::nullopt;
+}
+
+std::size_t MorphCommandBuffer::Flush(IMorphBackend& a_backend, IArmorLookup& a_actors,
+                                      std::vector<std::uint32_t>& a_vanished) {
+    AP_LOG_TRACE(">>>> Entering MorphCommandBuffer::Flush");
+
+    std::size_t applied = 0;
+    for (const auto& entry : m_actors) {
+        if (entry.intents.empty()) {
+            continue;
+        }
+        const ActorHandle actor = a_actors.LookupActor(entry.formID);
+        if (!actor) {
+            AP_LOG_TRACE("MorphCommandBuffer::Flush - Actor {:#x} no longer exists, skipping", entry.formID);
+            a_vanished.push_back(entry.formID);
+            continue;
+        }
+        for (const auto& intent : entry.intents) {
+            if (intent.isSet) {
+                a_backend.SetMorph(actor, intent.morphName, intent.morphKey, intent.value);
+                AP_METRICS_COUNT(kSkeeSetMorph);
+            } else {
+                a_backend.ClearMorph(actor, intent.morphName, intent.morphKey);
+                AP_METRICS_COUNT(kSkeeClearMorph);
+            }
+        }
+        a_backend.ApplyBodyMorphs(actor, true);
+        AP_METRICS_COUNT(kSkeeApplyBodyMorphs);
+        ++applied;
+    }
+
+    m_actors.clear();
+    m_actorIndex.clear();
+    AP_LOG_TRACE("<<<< Exiting MorphCommandBuffer::Flush (result: {})", applied);
+    return applied;
+}
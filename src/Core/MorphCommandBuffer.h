@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Adapters.h"
+
+// Morph writes collected over one tick and sent to the backend together.
+//
+// SetMorph() and ClearMorph() only record an intent, at most one per actor, morph and key: a later intent replaces an
+// earlier one, and an intent that undoes a change recorded earlier in the same tick drops both. Flush() then sends
+// what is left actor by actor, each followed by a single ApplyBodyMorphs(actor, deferUpdate = true), so SKEE rebuilds
+// every mesh once, on its own schedule, however many morphs changed. An actor whose intents all cancelled out costs
+// no backend call at all.
+//
+// Actors are recorded by FormID and looked up again at Flush(), since they may unload in between. Not thread-safe;
+// the owner serializes access.
+class MorphCommandBuffer {
+public:
+    struct Stats {
+        std::size_t recorded{};
+        std::size_t cancelled{};  // pairs of intents dropped because the second undid the first
+    };
+
+    // a_isChange: the morph is known to be the other way right now. Only such intents can be cancelled; pass false
+    // when the current value is unknown, e.g. on an actor seen for the first time.
+    void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, float a_value,
+                  bool a_isChange);
+    void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey, bool a_isChange);
+
+    bool IsEmpty() const { return m_actors.empty(); }
+    // True when anything is recorded for the actor that has not cancelled out.
+    bool HasIntents(std::uint32_t a_formID) const;
+    // What is recorded for a morph: true for a set, false for a clear, nullopt for nothing.
+    std::optional<bool> FindIntent(std::uint32_t a_formID, const char* a_morphName, const char* a_morphKey) const;
+    const Stats& GetStats() const { return m_stats; }
+
+    // Sends every intent and empties the buffer. Actors a_actors no longer finds are skipped and appended to
+    // a_vanished. Returns the number of actors applied.
+    std::size_t Flush(IMorphBackend& a_backend, IArmorLookup& a_actors, std::vector<std::uint32_t>& a_vanished);
+
+private:
+    struct Intent {
+        const char* morphName{};
+        const char* morphKey{};
+        float value{};
+        bool isSet{};
+        bool isChange{};
+    };
+
+    struct ActorIntents {
+        std::uint32_t formID{};
+        std::vector<Intent> intents;
+    };
+
+    void Record(const ActorHandle& a_actor, const Intent& a_intent);
+
+    std::vector<ActorIntents> m_actors;  // in the order they were first recorded
+    std::unordered_map<std::uint32_t, std::size_t> m_actorIndex;
+    Stats m_stats;
+};
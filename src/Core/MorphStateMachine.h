@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "FSMTable.h"
+
+// Feet x calves state machine specified by docs/FSM.csv.
+//
+// The kFeet slot is Barefeet, LowHeel or HighHeel and the kCalves slot is Barelegs or Pantyhose, giving six states
+// numbered as in the CSV (0 is the impossible state). The numbers are saved in the co-save, so the CSV's numbering is
+// generated at build time and checked against FromSlots(). An actor's state is always resolved from everything it
+// wears, never by stepping through equip events, and moving between two states yields only the morph writes that
+// actually differ between them.
+class MorphStateMachine {
+public:
+    enum class State : std::uint8_t {
+        kInvalid = 0,
+        kBarefeetBarelegs,
+        kLowHeelBarelegs,
+        kHighHeelBarelegs,
+        kBarefeetPantyhose,
+        kLowHeelPantyhose,
+        kHighHeelPantyhose,
+    };
+
+    enum class Feet : std::uint8_t { kBarefeet, kLowHeel, kHighHeel };
+    enum class Calves : std::uint8_t { kBarelegs, kPantyhose };
+
+    enum class Morph : std::uint8_t { kHeel, kNoHeel };
+    static constexpr std::size_t kMorphCount = 2;
+
+    struct MorphOp {
+        Morph morph{};
+        bool isSet{};
+    };
+
+    struct MorphOps {
+        std::array<MorphOp, kMorphCount> ops{};
+        std::uint8_t count{};
+
+        constexpr const MorphOp* begin() const { return ops.data(); }
+        constexpr const MorphOp* end() const { return ops.data() + count; }
+        constexpr bool empty() const { return count == 0; }
+    };
+
+    static constexpr State FromSlots(Feet a_feet, Calves a_calves) {
+        return static_cast<State>(1 + static_cast<std::uint8_t>(a_feet) + 3 * static_cast<std::uint8_t>(a_calves));
+    }
+
+    static constexpr Feet GetFeet(State a_state) { return static_cast<Feet>((Index(a_state) - 1) % 3); }
+    static constexpr Calves GetCalves(State a_state) { return static_cast<Calves>((Index(a_state) - 1) / 3); }
+
+    // Morphs each state wants set. The Barelegs rows keep the behaviour the plugin always shipped with (NoHeel on
+    // everything but high heels); the Pantyhose rows follow the "Morph Action" column of docs/FSMbyGPT.csv.
+    static constexpr bool IsMorphSet(State a_state, Morph a_morph) {
+        constexpr std::array<std::array<bool, kMorphCount>, FSMTable::kStateCount> kTargets{{
+            // Heel, NoHeel
+            {false, false},  // Invalid
+            {false, true},   // Barefeet Barelegs
+            {false, true},   // LowHeel Barelegs
+            {false, false},  // HighHeel Barelegs
+            {false, true},   // Barefeet Pantyhose
+            {false, true},   // LowHeel Pantyhose
+            {true, false},   // HighHeel Pantyhose
+        }};
+        return kTargets[Index(a_state)][static_cast<std::size_t>(a_morph)];
+    }
+
+    // Minimal morph writes to go from one state to another. From kInvalid (nothing known about the actor) every
+    // morph is written explicitly.
+    static constexpr MorphOps Diff(State a_from, State a_to) {
+        MorphOps result;
+        for (std::size_t i = 0; i < kMorphCount; ++i) {
+            const auto morph = static_cast<Morph>(i);
+            const bool isSet = IsMorphSet(a_to, morph);
+            if (a_from == State::kInvalid || IsMorphSet(a_from, morph) != isSet) {
+                result.ops[result.count++] = {morph, isSet};
+            }
+        }
+        return result;
+    }
+
+    static constexpr const char* GetMorphName(Morph a_morph) { return a_morph == Morph::kHeel ? "Heel" : "NoHeel"; }
+
+    // Checks the generated state table against FromSlots(), so an edit to the CSV that renumbers the states fails
+    // the build instead of misreading older co-saves.
+    static consteval bool IsTableConsistent();
+
+private:
+    static constexpr std::size_t Index(State a_state) { return static_cast<std::size_t>(a_state); }
+
+    static constexpr std::string_view kFeetNames[] = {"Barefeet", "LowHeel", "HighHeel"};
+    static constexpr std::string_view kCalvesNames[] = {"Barelegs", "Pantyhose"};
+};
+
+consteval bool MorphStateMachine::IsTableConsistent() {
+    if (FSMTable::kStateCount != 7 || !FSMTable::kFeetNames[0].empty() || !FSMTable::kCalvesNames[0].empty()) {
+        return false;
+    }
+    for (std::size_t i = 1; i < FSMTable::kStateCount; ++i) {
+        const auto state = static_cast<State>(i);
+        if (FSMTable::kFeetNames[i] != kFeetNames[static_cast<std::size_t>(GetFeet(state))] ||
+            FSMTable::kCalvesNames[i] != kCalvesNames[static_cast<std::size_t>(GetCalves(state))]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(MorphStateMachine::IsTableConsistent(), "docs/FSM.csv does not describe the feet x calves state machine");
@@ -0,0 +1,80 @@
+#include "MorphStateRecord.h"
+
+namespace {
+    struct Header {
+        std::uint64_t ruleHash{};
+        std::uint32_t count{};
+        std::uint32_t reserved{};
+    };
+    static_assert(sizeof(Header) == 16);
+
+    constexpr std::size_t kEntrySize = sizeof(std::uint32_t) + sizeof(std::uint8_t);
+
+    bool ReadExactly(ICoSave& a_coSave, void* a_data, std::size_t a_length) {
+        return a_coSave.ReadRecordData(a_data, static_cast<std::uint32_t>(a_length)) == a_length;
+    }
+
+    bool IsValidState(std::uint8_t a_state) {
+        return a_state > static_cast<std::uint8_t>(MorphStateMachine::State::kInvalid) &&
+               a_state <= static_cast<std::uint8_t>(MorphStateMachine::State::kHighHeelPantyhose);
+    }
+}
+
+bool MorphStateRecord::Write(ICoSave& a_coSave, std::uint64_t a_ruleHash, std::span<const Entry> a_entries) {
+    Header header;
+    header.ruleHash = a_ruleHash;
+    header.count = static_cast<std::uint32_t>(a_entries.size());
+
+    std::vector<std::uint32_t> formIDs;
+    std::vector<std::uint8_t> states;
+    formIDs.reserve(a_entries.size());
+    states.reserve(a_entries.size());
+    for (const Entry& entry : a_entries) {
+        formIDs.push_back(entry.formID);
+        states.push_back(static_cast<std::uint8_t>(entry.state));
+    }
+
+    return a_coSave.OpenRecord(kType, kVersion) && a_coSave.WriteRecordData(&header, sizeof(header)) &&
+           a_coSave.WriteRecordData(formIDs.data(),
+                                    static_cast<std::uint32_t>(formIDs.size() * sizeof(std::uint32_t))) &&
+           a_coSave.WriteRecordData(states.data(), static_cast<std::uint32_t>(states.size()));
+}
+
+MorphStateRecord::ReadResult MorphStateRecord::Read(ICoSave& a_coSave, std::uint32_t a_version, std::uint32_t a_length,
+                                                    std::uint64_t a_ruleHash, std::vector<Entry>& a_out) {
+    if (a_version != kVersion) {
+        return {Status::kUnsupported};
+    }
+    Header header;
+    if (a_length < sizeof(Header) || !ReadExactly(a_coSave, &header, sizeof(header)) ||
+        (a_length - sizeof(Header)) / kEntrySize != header.count || (a_length - sizeof(Header)) % kEntrySize != 0) {
+        return {Status::kCorrupt};
+    }
+    if (header.ruleHash != a_ruleHash) {
+        return {Status::kStale};
+    }
+
+    std::vector<std::uint32_t> formIDs(header.count);
+    std::vector<std::uint8_t> states(header.count);
+    if (!ReadExactly(a_coSave, formIDs.data(), formIDs.size() * sizeof(std::uint32_t)) ||
+        !ReadExactly(a_coSave, states.data(), states.size())) {
+        return {Status::kCorrupt};
+    }
+
+    ReadResult result{Status::kLoaded};
+    a_out.clear();
+    a_out.reserve(header.count);
+    for (std::uint32_t i = 0; i < header.count; ++i) {
+        if (!IsValidState(states[i])) {
+            a_out.clear();
+            return {Status::kCorrupt};
+        }
+        std::uint32_t formID = 0;
+        if (!a_coSave.ResolveFormID(formIDs[i], formID) || formID == 0) {
+            ++result.dropped;
+            continue;
+        }
+        a_out.push_back({formID, static_cast<MorphStateMachine::State>(states[i])});
+    }
+    return result;
+}
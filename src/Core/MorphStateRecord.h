@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Adapters.h"
+#include "MorphStateMachine.h"
+
+// The co-save record of which state every actor's morphs were last committed in, so a load can take those actors as
+// already evaluated instead of looking up and classifying what they wear.
+//
+// Version 1, in the byte order of the machine that saved:
+//
+//   Header  ruleHash (u64), count (u32), reserved (u32)
+//   u32     formIDs[count]
+//   u8      states[count]    MorphStateMachine::State, never kInvalid
+//
+// The states only hold under the rules they were computed with, so a record saved under another rule hash is
+// ignored as a whole. FormIDs are those of the session that saved; Read() maps them through the co-save and drops
+// actors whose plugin is no longer loaded.
+class MorphStateRecord {
+public:
+    static constexpr std::uint32_t kType = 0x41504D53;  // 'APMS'
+    static constexpr std::uint32_t kVersion = 1;
+
+    enum class Status : std::uint8_t { kLoaded, kStale, kUnsupported, kCorrupt };
+
+    struct Entry {
+        std::uint32_t formID{};
+        MorphStateMachine::State state{};
+
+        bool operator==(const Entry&) const = default;
+    };
+
+    struct ReadResult {
+        Status status{};
+        std::size_t dropped{};  // actors whose plugin is gone
+    };
+
+    // Opens a record of kType and writes a_entries into it. Returns false when the co-save refused either.
+    static bool Write(ICoSave& a_coSave, std::uint64_t a_ruleHash, std::span<const Entry> a_entries);
+    // Reads the record GetNextRecordInfo() just reported with a_version and a_length. a_out is filled on kLoaded
+    // only.
+    static ReadResult Read(ICoSave& a_coSave, std::uint32_t a_version, std::uint32_t a_length, std::uint64_t a_ruleHash,
+                           std::vector<Entry>& a_out);
+};
@@ -0,0 +1,27 @@
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void ParallelFor(std::size_t a_count, const std::function<void(std::size_t a_index)>& a_func,
+                 std::size_t a_maxThreads) {
+    if (a_maxThreads == 0) {
+        a_maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const std::size_t threadCount = std::min(a_count, a_maxThreads);
+
+    std::atomic<std::size_t> next{0};
+    const auto work = [&]() {
+        for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < a_count;
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            a_func(i);
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+}
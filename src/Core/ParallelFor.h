@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Calls a_func(i) for every i in [0, a_count) on up to a_maxThreads threads, the calling thread included, and returns
+// once all calls have returned. Indices are handed out one at a time, so uneven work balances itself. a_func must not
+// throw.
+void ParallelFor(std::size_t a_count, const std::function<void(std::size_t a_index)>& a_func,
+                 std::size_t a_maxThreads = 0);
@@ -0,0 +1,254 @@
+#include "PatternRuleSet.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+    // Calls a_visitor with every non-empty run of a_pattern between '*'s.
+    template <class Visitor>
+    void ForEachFragment(std::string_view a_pattern, Visitor&& a_visitor) {
+        std::size_t begin = 0;
+        while (begin <= a_pattern.size()) {
+            const std::size_t end = std::min(a_pattern.find('*', begin), a_pattern.size());
+            if (end > begin) {
+                a_visitor(a_pattern.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+    }
+
+    // Of one multi-fragment pattern during a Match(): the fragment it waits for and where the last one ended.
+    struct Progress {
+        std::uint32_t next{};
+        std::size_t end{};
+    };
+}
+
+void PatternRuleSet::Clear() {
+    m_names.clear();
+    m_patterns.clear();
+    m_classes.clear();
+    m_transitions.clear();
+    m_nodes.clear();
+    m_outputs.clear();
+    m_view = {};
+}
+
+bool PatternRuleSet::Add(Target a_target, std::string_view a_pattern) {
+    std::uint32_t fragmentCount = 0;
+    ForEachFragment(a_pattern, [&fragmentCount](std::string_view) { ++fragmentCount; });
+    if (fragmentCount == 0 || a_pattern.find('\0') != std::string_view::npos) {
+        return false;
+    }
+
+    m_patterns.push_back({static_cast<std::uint32_t>(m_names.size()), fragmentCount, a_target});
+    m_names.insert(m_names.end(), a_pattern.begin(), a_pattern.end());
+    m_names.push_back('\0');
+    // Until the next Build() there is no automaton to view.
+    m_view = View{};
+    m_view.names = m_names;
+    m_view.patterns = m_patterns;
+    return true;
+}
+
+void PatternRuleSet::Build() {
+    m_classes.clear();
+    m_transitions.clear();
+    m_nodes.clear();
+    m_outputs.clear();
+    m_view = View{};
+    m_view.names = m_names;
+    m_view.patterns = m_patterns;
+    if (m_patterns.empty()) {
+        return;
+    }
+
+    // One column per folded byte that occurs in a fragment, column 0 for every other byte.
+    std::array<std::uint8_t, kByteCount> folded{};
+    std::size_t columns = 1;
+    for (std::size_t i = 0; i < m_patterns.size(); ++i) {
+        for (const char c : std::string_view(GetName(i))) {
+            auto& column = folded[static_cast<std::uint8_t>(Fold(c))];
+            if (c != '*' && column == 0) {
+                column = static_cast<std::uint8_t>(columns++);
+            }
+        }
+    }
+    m_classes.resize(kByteCount);
+    for (std::size_t byte = 0; byte < kByteCount; ++byte) {
+        m_classes[byte] = folded[static_cast<std::uint8_t>(Fold(static_cast<char>(byte)))];
+    }
+
+    // The trie of all fragments. State 0 is the root, which is never a child, so 0 marks a missing edge for now.
+    std::vector<std::uint32_t> trie(columns, 0);
+    std::vector<std::vector<Output>> outputs(1);
+    for (std::uint32_t pattern = 0; pattern < m_patterns.size(); ++pattern) {
+        std::uint32_t fragment = 0;
+        ForEachFragment(GetName(pattern), [&](std::string_view a_fragment) {
+            std::uint32_t state = 0;
+            for (const char c : a_fragment) {
+                const std::size_t edge = state * columns + m_classes[static_cast<std::uint8_t>(c)];
+                if (trie[edge] == 0) {
+                    trie[edge] = static_cast<std::uint32_t>(outputs.size());
+                    trie.resize(trie.size() + columns, 0);
+                    outputs.emplace_back();
+                }
+                state = trie[edge];
+            }
+            outputs[state].push_back({pattern, fragment++, static_cast<std::uint32_t>(a_fragment.size())});
+        });
+    }
+
+    // Breadth first, so every failure link points to a state already completed: missing edges take the edge of the
+    // failure state, and the states are renumbered in this order, shallow ones first.
+    const std::size_t stateCount = outputs.size();
+    std::vector<std::uint32_t> order{0};
+    std::vector<std::uint32_t> failure(stateCount, 0);
+    std::vector<std::uint32_t> outputLinks(stateCount, 0);
+    order.reserve(stateCount);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const std::uint32_t state = order[i];
+        const std::uint32_t fail = failure[state];
+        if (state != 0) {
+            outputLinks[state] = outputs[fail].empty() ? outputLinks[fail] : fail;
+        }
+        for (std::size_t column = 0; column < columns; ++column) {
+            std::uint32_t& next = trie[state * columns + column];
+            const std::uint32_t fallback = state == 0 ? 0 : trie[fail * columns + column];
+            if (next == 0) {
+                next = fallback;
+            } else {
+                failure[next] = fallback;
+                order.push_back(next);
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> renumbered(stateCount);
+    for (std::size_t i = 0; i < stateCount; ++i) {
+        renumbered[order[i]] = static_cast<std::uint32_t>(i);
+    }
+    m_transitions.resize(stateCount * columns);
+    m_nodes.resize(stateCount);
+    for (std::size_t i = 0; i < stateCount; ++i) {
+        const std::uint32_t state = order[i];
+        for (std::size_t column = 0; column < columns; ++column) {
+            m_transitions[i * columns + column] = renumbered[trie[state * columns + column]];
+        }
+        m_nodes[i] = {static_cast<std::uint32_t>(m_outputs.size()), static_cast<std::uint32_t>(outputs[state].size()),
+                      renumbered[outputLinks[state]]};
+        m_outputs.insert(m_outputs.end(), outputs[state].begin(), outputs[state].end());
+    }
+
+    m_view = {m_names, m_patterns, m_classes, m_transitions, m_nodes, m_outputs};
+}
+
+bool PatternRuleSet::Attach(const View& a_view) {
+    Clear();
+
+    if (!a_view.names.empty() && a_view.names.back() != '\0') {
+        return false;
+    }
+    for (const Pattern& pattern : a_view.patterns) {
+        if (pattern.nameOffset >= a_view.names.size() || pattern.fragmentCount == 0 ||
+            pattern.target > Target::kModelPath) {
+            return false;
+        }
+    }
+    if (a_view.patterns.empty()) {
+        if (!a_view.classes.empty() || !a_view.transitions.empty() || !a_view.nodes.empty() ||
+            !a_view.outputs.empty()) {
+            return false;
+        }
+        m_view = a_view;
+        return true;
+    }
+
+    if (a_view.classes.size() != kByteCount || a_view.nodes.empty() ||
+        a_view.transitions.size() % a_view.nodes.size() != 0) {
+        return false;
+    }
+    const std::size_t columns = a_view.transitions.size() / a_view.nodes.size();
+    const auto isState = [&a_view](std::uint32_t a_state) { return a_state < a_view.nodes.size(); };
+    if (!std::ranges::all_of(a_view.classes, [columns](std::uint8_t a_column) { return a_column < columns; }) ||
+        !std::ranges::all_of(a_view.transitions, isState)) {
+        return false;
+    }
+    // Output links only ever point to a shallower state, which comes first, so following them always ends.
+    for (std::size_t i = 0; i < a_view.nodes.size(); ++i) {
+        const Node& node = a_view.nodes[i];
+        if (node.outputBegin > a_view.outputs.size() || node.outputCount > a_view.outputs.size() - node.outputBegin ||
+            (node.outputLink != 0 && node.outputLink >= i)) {
+            return false;
+        }
+    }
+    for (const Output& output : a_view.outputs) {
+        if (output.pattern >= a_view.patterns.size() ||
+            output.fragment >= a_view.patterns[output.pattern].fragmentCount) {
+            return false;
+        }
+    }
+
+    m_view = a_view;
+    return true;
+}
+
+std::size_t PatternRuleSet::GetPatternCount(Target a_target) const {
+    return std::ranges::count(m_view.patterns, a_target, &Pattern::target);
+}
+
+std::size_t PatternRuleSet::GetMemoryUsage() const {
+    return m_view.names.size_bytes() + m_view.patterns.size_bytes() + m_view.classes.size_bytes() +
+           m_view.transitions.size_bytes() + m_view.nodes.size_bytes() + m_view.outputs.size_bytes();
+}
+
+const char* PatternRuleSet::Match(Target a_target, std::string_view a_text) const {
+    if (m_view.nodes.empty()) {
+        return nullptr;
+    }
+    const std::size_t columns = m_view.transitions.size() / m_view.nodes.size();
+
+    // Patterns of several fragments carry progress from one byte to the next; the touched ones are reset on return,
+    // so the buffer is all zeros between calls.
+    thread_local std::vector<Progress> progress;
+    thread_local std::vector<std::uint32_t> touched;
+    if (progress.size() < m_view.patterns.size()) {
+        progress.resize(m_view.patterns.size());
+    }
+    const auto finish = [](const char* a_result) {
+        for (const std::uint32_t pattern : touched) {
+            progress[pattern] = {};
+        }
+        touched.clear();
+        return a_result;
+    };
+
+    std::uint32_t state = 0;
+    for (std::size_t i = 0; i < a_text.size(); ++i) {
+        state = m_view.transitions[state * columns + m_view.classes[static_cast<std::uint8_t>(a_text[i])]];
+        for (std::uint32_t node = m_view.nodes[state].outputCount ? state : m_view.nodes[state].outputLink; node != 0;
+             node = m_view.nodes[node].outputLink) {
+            const Node& entry = m_view.nodes[node];
+            for (const Output& output : m_view.outputs.subspan(entry.outputBegin, entry.outputCount)) {
+                const Pattern& pattern = m_view.patterns[output.pattern];
+                if (pattern.target != a_target) {
+                    continue;
+                }
+                if (pattern.fragmentCount == 1) {
+                    return finish(GetName(output.pattern));
+                }
+                Progress& seen = progress[output.pattern];
+                if (output.fragment != seen.next || i + 1 - output.length < seen.end) {
+                    continue;
+                }
+                if (seen.next++ == 0) {
+                    touched.push_back(output.pattern);
+                }
+                seen.end = i + 1;
+                if (seen.next == pattern.fragmentCount) {
+                    return finish(GetName(output.pattern));
+                }
+            }
+        }
+    }
+    return finish(nullptr);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Compiled form of the "ByNamePattern" and "ByModelPath" rules.
+//
+// A pattern matches when its text appears anywhere in the string, ignoring ASCII case and with '/' and '\' taken as
+// the same character; a '*' stands for any run of characters, so "*\HighHeel*" is the same as "\HighHeel" and
+// "Armor\*\Heels" needs "armor\" somewhere before "\heels". Every pattern is split at its '*' into fragments, and the
+// fragments of all patterns, names and model paths alike, go into one Aho-Corasick automaton built by Build(). The
+// automaton is a dense table of next states over the bytes that occur in some fragment (any other byte leads back to
+// the root), so matching a string is one table lookup per byte, however many patterns there are.
+//
+// A fragment can end several patterns; each automaton state lists the fragments ending there and links to the
+// nearest shorter one, which is how overlapping patterns are all seen in the same pass. A single-fragment pattern
+// matches as soon as its fragment is seen, a longer one once its fragments have been seen in order without
+// overlapping.
+//
+// Like the other rule sets, the built tables can be attached in place from a rule image.
+class PatternRuleSet {
+public:
+    enum class Target : std::uint32_t { kName, kModelPath };
+
+    struct Pattern {
+        std::uint32_t nameOffset{};  // in View::names
+        std::uint32_t fragmentCount{};
+        Target target{};
+    };
+
+    struct Node {
+        std::uint32_t outputBegin{};  // in View::outputs
+        std::uint32_t outputCount{};
+        std::uint32_t outputLink{};  // nearest state on the failure chain that has outputs, 0 for none
+    };
+
+    struct Output {
+        std::uint32_t pattern{};
+        std::uint32_t fragment{};  // index within the pattern
+        std::uint32_t length{};    // bytes
+    };
+
+    // The built tables. Everything a match reads, and nothing else.
+    struct View {
+        std::span<const char> names;                 // the patterns as written, NUL-terminated, back to back
+        std::span<const Pattern> patterns;
+        std::span<const std::uint8_t> classes;       // byte -> column of transitions, kByteCount entries
+        std::span<const std::uint32_t> transitions;  // state * column count + column -> state
+        std::span<const Node> nodes;                 // one per state, the root first
+        std::span<const Output> outputs;
+    };
+
+    static constexpr std::size_t kByteCount = 256;
+
+    void Clear();
+    // Returns false, adding nothing, for a pattern without any text to match.
+    bool Add(Target a_target, std::string_view a_pattern);
+    void Build();
+
+    const View& GetView() const { return m_view; }
+    // Uses a_view in place; see FormIDRangeIndex::Attach. Returns false, leaving the set empty, when it is malformed.
+    bool Attach(const View& a_view);
+
+    std::size_t GetPatternCount() const { return m_view.patterns.size(); }
+    std::size_t GetPatternCount(Target a_target) const;
+    std::size_t GetStateCount() const { return m_view.nodes.size(); }
+    std::size_t GetMemoryUsage() const;  // bytes of the built tables
+    const char* GetName(std::size_t a_index) const { return m_view.names.data() + m_view.patterns[a_index].nameOffset; }
+
+    // Returns the first pattern for a_target found in a_text, or nullptr.
+    const char* Match(Target a_target, std::string_view a_text) const;
+
+    // The character Match() compares in place of a_byte.
+    static char Fold(char a_byte) {
+        return a_byte == '/' ? '\\' : (a_byte >= 'A' && a_byte <= 'Z' ? static_cast<char>(a_byte - 'A' + 'a') : a_byte);
+    }
+
+private:
+    std::vector<char> m_names;
+    std::vector<Pattern> m_patterns;
+    std::vector<std::uint8_t> m_classes;
+    std::vector<std::uint32_t> m_transitions;
+    std::vector<Node> m_nodes;
+    std::vector<Output> m_outputs;
+    View m_view;
+};
@@ -0,0 +1,78 @@
+#include "PluginSettings.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace {
+    std::string_view Trim(std::string_view a_text) {
+        const auto isSpace = [](char a_char) { return std::isspace(static_cast<unsigned char>(a_char)) != 0; };
+        while (!a_text.empty() && isSpace(a_text.front())) {
+            a_text.remove_prefix(1);
+        }
+        while (!a_text.empty() && isSpace(a_text.back())) {
+            a_text.remove_suffix(1);
+        }
+        return a_text;
+    }
+
+    bool IEquals(std::string_view a_lhs, std::string_view a_rhs) {
+        const auto lower = [](char a_char) { return std::tolower(static_cast<unsigned char>(a_char)); };
+        return std::ranges::equal(a_lhs, a_rhs,
+                                  [&](char a_left, char a_right) { return lower(a_left) == lower(a_right); });
+    }
+}
+
+PluginSettings PluginSettings::Load(const std::filesystem::path& a_path) {
+    PluginSettings settings;
+    std::ifstream file(a_path, std::ios::binary);
+    if (!file) {
+        spdlog::info("No {} found, using the default settings.", a_path.string());
+        return settings;
+    }
+    const std::string text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    settings.Parse(text, a_path.string());
+    return settings;
+}
+
+void PluginSettings::Parse(std::string_view a_text, std::string_view a_source) {
+    std::string_view section;
+    std::size_t lineNumber = 0;
+    while (!a_text.empty()) {
+        const std::size_t end = std::min(a_text.find('\n'), a_text.size());
+        const std::string_view line = Trim(a_text.substr(0, end));
+        a_text.remove_prefix(std::min(end + 1, a_text.size()));
+        ++lineNumber;
+
+        if (line.empty() || line.front() == ';' || line.front() == '#') {
+            continue;
+        }
+        if (line.front() == '[') {
+            section = line.back() == ']' ? Trim(line.substr(1, line.size() - 2)) : std::string_view{};
+            continue;
+        }
+        const std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            spdlog::warn("{}:{}: expected 'key = value', ignoring the line.", a_source, lineNumber);
+            continue;
+        }
+        const std::string_view key = Trim(line.substr(0, equals));
+        std::string_view value = Trim(line.substr(equals + 1));
+        value = Trim(value.substr(0, value.find(';')));
+
+        if (IEquals(section, "Metrics") && IEquals(key, "iDumpIntervalSeconds")) {
+            std::uint32_t seconds = 0;
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+            if (ec != std::errc{} || ptr != value.data() + value.size()) {
+                spdlog::warn("{}:{}: '{}' is not a number of seconds, keeping {}.", a_source, lineNumber, value,
+                             metricsDumpInterval.count());
+                continue;
+            }
+            metricsDumpInterval = std::chrono::seconds(seconds);
+        }
+    }
+}
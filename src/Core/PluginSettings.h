@@ -0,0 +1,22 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include "Metrics.h"
+
+// Settings read from kFileName in the plugin's data directory, next to the rule files:
+//
+//   [Metrics]
+//   iDumpIntervalSeconds = 300    ; 0 turns the periodic summaries off
+//
+// Sections and keys are case-insensitive; ';' and '#' start a comment line. A missing file, section or key keeps the
+// build's default, and a value that does not parse is reported and ignored.
+struct PluginSettings {
+    static constexpr const char* kFileName = "AdeptivePantyhose.ini";
+
+    std::chrono::seconds metricsDumpInterval{AP_METRICS_DUMP_INTERVAL_SECONDS};
+
+    static PluginSettings Load(const std::filesystem::path& a_path);
+    // Applies the INI text a_text on top of this.
+    void Parse(std::string_view a_text, std::string_view a_source);
+};
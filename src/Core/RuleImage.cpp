@@ -0,0 +1,201 @@
+#include "RuleImage.h"
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "MappedFile.h"
+
+namespace {
+    constexpr std::array<char, 8> kMagic{'A', 'P', 'R', 'U', 'L', 'E', 'S', '\x1A'};
+    constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+    enum Section : std::uint32_t {
+        kRangeNames,
+        kRangePlugins,
+        kRangeSlots,
+        kRangeMins,
+        kRangeMaxs,
+        kKeywordNames,
+        kKeywordOffsets,
+        kPatternNames,
+        kPatternList,
+        kPatternClasses,
+        kPatternTransitions,
+        kPatternNodes,
+        kPatternOutputs,
+        kSectionCount
+    };
+
+    struct SectionEntry {
+        std::uint64_t offset{};
+        std::uint64_t size{};  // bytes
+    };
+
+    struct Header {
+        std::array<char, 8> magic{};
+        std::uint32_t version{};
+        std::uint32_t byteOrder{};
+        std::uint64_t sourceHash{};
+        std::uint64_t payloadHash{};  // everything after the header
+        std::uint64_t ruleCount{};
+        std::array<SectionEntry, kSectionCount> sections{};
+    };
+
+    constexpr std::size_t kSectionAlignment = 8;
+
+    template <class T>
+    void Append(std::vector<std::byte>& a_out, SectionEntry& a_entry, std::span<const T> a_items) {
+        a_out.resize((a_out.size() + kSectionAlignment - 1) & ~(kSectionAlignment - 1));
+        a_entry.offset = a_out.size();
+        a_entry.size = a_items.size_bytes();
+        const auto* bytes = reinterpret_cast<const std::byte*>(a_items.data());
+        a_out.insert(a_out.end(), bytes, bytes + a_items.size_bytes());
+    }
+
+    // Returns false when the section is out of bounds or misaligned for T.
+    template <class T>
+    bool View(std::span<const std::byte> a_image, const SectionEntry& a_entry, std::span<const T>& a_out) {
+        if (a_entry.offset > a_image.size() || a_entry.size > a_image.size() - a_entry.offset ||
+            a_entry.offset % alignof(T) != 0 || a_entry.size % sizeof(T) != 0) {
+            return false;
+        }
+        a_out = {reinterpret_cast<const T*>(a_image.data() + a_entry.offset), a_entry.size / sizeof(T)};
+        return true;
+    }
+}
+
+std::uint64_t RuleImage::Hash(std::span<const std::byte> a_bytes) {
+    // Eight bytes per step so hashing a large JSON file stays far below the cost of parsing it.
+    constexpr std::uint64_t kPrime = 0x100000001B3ull;
+    std::uint64_t hash = 0xCBF29CE484222325ull ^ a_bytes.size();
+    std::size_t i = 0;
+    for (; i + 8 <= a_bytes.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, a_bytes.data() + i, 8);
+        hash = std::rotl((hash ^ word) * kPrime, 29);
+    }
+    for (; i < a_bytes.size(); ++i) {
+        hash = (hash ^ static_cast<std::uint8_t>(a_bytes[i])) * kPrime;
+    }
+    return hash ^ (hash >> 32);
+}
+
+bool RuleImage::Write(const std::filesystem::path& a_path, std::uint64_t a_sourceHash,
+                      const FormIDRangeIndex& a_formIDRangeIndex, const KeywordRuleSet& a_keywordRules,
+                      const PatternRuleSet& a_patternRules) {
+    const auto& index = a_formIDRangeIndex.GetView();
+    const auto& keywords = a_keywordRules.GetView();
+    const auto& patterns = a_patternRules.GetView();
+
+    Header header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.sourceHash = a_sourceHash;
+    header.ruleCount = index.ruleCount;
+
+    std::vector<std::byte> image(sizeof(Header));
+    Append(image, header.sections[kRangeNames], index.names);
+    Append(image, header.sections[kRangePlugins], index.plugins);
+    Append(image, header.sections[kRangeSlots], index.slots);
+    Append(image, header.sections[kRangeMins], index.mins);
+    Append(image, header.sections[kRangeMaxs], index.maxs);
+    Append(image, header.sections[kKeywordNames], keywords.names);
+    Append(image, header.sections[kKeywordOffsets], keywords.offsets);
+    Append(image, header.sections[kPatternNames], patterns.names);
+    Append(image, header.sections[kPatternList], patterns.patterns);
+    Append(image, header.sections[kPatternClasses], patterns.classes);
+    Append(image, header.sections[kPatternTransitions], patterns.transitions);
+    Append(image, header.sections[kPatternNodes], patterns.nodes);
+    Append(image, header.sections[kPatternOutputs], patterns.outputs);
+    header.payloadHash = Hash(std::span(image).subspan(sizeof(Header)));
+    std::memcpy(image.data(), &header, sizeof(Header));
+
+    // Write aside and rename, so a crash mid-write never leaves a truncated image that looks current.
+    auto tempPath = a_path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()))) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, a_path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+RuleImage::Status RuleImage::Load(const std::filesystem::path& a_path, std::uint64_t a_sourceHash,
+                                  FormIDRangeIndex& a_formIDRangeIndex, KeywordRuleSet& a_keywordRules,
+                                  PatternRuleSet& a_patternRules) {
+    Close();
+    {
+        MappedFile file;
+        if (!file.Open(a_path)) {
+            return Status::kMissing;
+        }
+
+        // Only the header is read from the mapping, so a stale image costs no copy.
+        const auto bytes = file.GetBytes();
+        Header header;
+        if (bytes.size() < sizeof(Header)) {
+            return Status::kCorrupt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(Header));
+        if (header.magic != kMagic || header.byteOrder != kByteOrderMark) {
+            return Status::kCorrupt;
+        }
+        if (header.version != kVersion || header.sourceHash != a_sourceHash) {
+            return Status::kStale;
+        }
+
+        m_words.resize((bytes.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        std::memcpy(m_words.data(), bytes.data(), bytes.size());
+        m_size = bytes.size();
+    }
+
+    // Checked on the copy, which is what the rule sets will point into.
+    const auto image = GetBytes();
+    Header header;
+    std::memcpy(&header, image.data(), sizeof(Header));
+    if (header.payloadHash != Hash(image.subspan(sizeof(Header)))) {
+        Close();
+        return Status::kCorrupt;
+    }
+
+    FormIDRangeIndex::View index;
+    KeywordRuleSet::View keywords;
+    PatternRuleSet::View patterns;
+    index.ruleCount = header.ruleCount;
+    if (!View(image, header.sections[kRangeNames], index.names) ||
+        !View(image, header.sections[kRangePlugins], index.plugins) ||
+        !View(image, header.sections[kRangeSlots], index.slots) ||
+        !View(image, header.sections[kRangeMins], index.mins) ||
+        !View(image, header.sections[kRangeMaxs], index.maxs) ||
+        !View(image, header.sections[kKeywordNames], keywords.names) ||
+        !View(image, header.sections[kKeywordOffsets], keywords.offsets) ||
+        !View(image, header.sections[kPatternNames], patterns.names) ||
+        !View(image, header.sections[kPatternList], patterns.patterns) ||
+        !View(image, header.sections[kPatternClasses], patterns.classes) ||
+        !View(image, header.sections[kPatternTransitions], patterns.transitions) ||
+        !View(image, header.sections[kPatternNodes], patterns.nodes) ||
+        !View(image, header.sections[kPatternOutputs], patterns.outputs) || !a_formIDRangeIndex.Attach(index) ||
+        !a_keywordRules.Attach(keywords) || !a_patternRules.Attach(patterns)) {
+        a_formIDRangeIndex.Clear();
+        a_keywordRules.Clear();
+        a_patternRules.Clear();
+        Close();
+        return Status::kCorrupt;
+    }
+    return Status::kLoaded;
+}
+
+void RuleImage::Close() {
+    m_words = {};
+    m_size = 0;
+}
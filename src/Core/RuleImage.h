@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include "FormIDRangeIndex.h"
+#include "KeywordRuleSet.h"
+#include "PatternRuleSet.h"
+
+// The compiled rules of one JSON file, saved next to it so later launches can skip the parse.
+//
+// The image is the built FormIDRangeIndex, KeywordRuleSet and PatternRuleSet tables laid out back to back behind a
+// header that records the format version, a hash of the JSON it was built from and a hash of its own payload. Loading
+// maps the file, copies it into one buffer owned by the image and unmaps it, then attaches the rule sets to the tables
+// in place: no parse, no per-rule allocation. The file is never left open, so a hot reload can write a new image over
+// it while rules loaded from the old one are still in use; Windows refuses to replace a mapped file. Anything that
+// does not check out (other version, other source, bad payload hash, tables that do not fit together) makes the caller
+// fall back to the JSON.
+class RuleImage {
+public:
+    static constexpr std::uint32_t kVersion = 3;  // 2: range bounds stored as two columns, 3: pattern rules
+
+    enum class Status : std::uint8_t { kLoaded, kMissing, kStale, kCorrupt };
+
+    static std::uint64_t Hash(std::span<const std::byte> a_bytes);
+    static bool Write(const std::filesystem::path& a_path, std::uint64_t a_sourceHash,
+                      const FormIDRangeIndex& a_formIDRangeIndex, const KeywordRuleSet& a_keywordRules,
+                      const PatternRuleSet& a_patternRules);
+
+    // On kLoaded the rule sets point into this image until Close() or the next Load().
+    Status Load(const std::filesystem::path& a_path, std::uint64_t a_sourceHash, FormIDRangeIndex& a_formIDRangeIndex,
+                KeywordRuleSet& a_keywordRules, PatternRuleSet& a_patternRules);
+    void Close();
+
+    bool IsLoaded() const { return m_size != 0; }
+    std::size_t GetSize() const { return m_size; }
+
+private:
+    std::span<const std::byte> GetBytes() const { return std::as_bytes(std::span(m_words)).first(m_size); }
+
+    std::vector<std::uint64_t> m_words;  // the file's bytes, in words so every section stays 8-byte aligned
+    std::size_t m_size{};                // bytes
+};
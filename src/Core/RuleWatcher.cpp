@@ -0,0 +1,63 @@
+#include "RuleWatcher.h"
+#include <spdlog/spdlog.h>
+#include <vector>
+#include "HighHeelRules.h"
+#include "RuleImage.h"
+
+void RuleWatcher::Start(const std::filesystem::path& a_path, std::uint64_t a_loaded,
+                        std::chrono::milliseconds a_interval, Callback a_onChange) {
+    std::scoped_lock lock(m_lock);
+    if (m_thread.joinable()) {
+        return;
+    }
+    m_isStopping = false;
+    m_thread = std::thread([this, a_path, a_loaded, a_interval, onChange = std::move(a_onChange)]() {
+        std::uint64_t loaded = a_loaded;
+        std::uint64_t pending = loaded;
+
+        std::unique_lock threadLock(m_lock);
+        while (!m_wake.wait_for(threadLock, a_interval, [this]() { return m_isStopping; })) {
+            threadLock.unlock();
+            const std::uint64_t current = Fingerprint(a_path);
+            if (current != loaded && current == pending) {
+                spdlog::info("High heel rules in '{}' changed, reloading.", a_path.string());
+                loaded = current;
+                onChange();
+            }
+            pending = current;
+            threadLock.lock();
+        }
+    });
+}
+
+void RuleWatcher::Stop() {
+    {
+        std::scoped_lock lock(m_lock);
+        if (!m_thread.joinable()) {
+            return;
+        }
+        m_isStopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+std::uint64_t RuleWatcher::Fingerprint(const std::filesystem::path& a_path) {
+    std::error_code ec;
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(a_path, ec)) {
+        paths = HighHeelRules::ListRuleFiles(a_path, ec);
+    } else {
+        paths.push_back(a_path);
+    }
+
+    std::vector<std::uint64_t> parts;
+    for (const auto& path : paths) {
+        const auto name = path.filename().u8string();
+        parts.push_back(RuleImage::Hash(std::as_bytes(std::span(name))));
+        parts.push_back(std::filesystem::file_size(path, ec));
+        const auto writeTime = std::filesystem::last_write_time(path, ec);
+        parts.push_back(static_cast<std::uint64_t>(writeTime.time_since_epoch().count()));
+    }
+    return RuleImage::Hash(std::as_bytes(std::span(parts)));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Polls the rule directory (or a single rule file) on a background thread and calls back when it changed.
+//
+// A change is the name, size or write time of any rule file, or a file appearing or going away, compared with the
+// fingerprint the running rules were parsed at. The callback runs on the polling thread, once the files have looked
+// the same for two polls in a row, so a file that is still being saved is not picked up half written.
+class RuleWatcher {
+public:
+    using Callback = std::function<void()>;
+
+    RuleWatcher() = default;
+    ~RuleWatcher() { Stop(); }
+    RuleWatcher(const RuleWatcher&) = delete;
+    RuleWatcher& operator=(const RuleWatcher&) = delete;
+
+    // a_loaded is the Fingerprint() of the files the current rules were parsed from.
+    void Start(const std::filesystem::path& a_path, std::uint64_t a_loaded, std::chrono::milliseconds a_interval,
+               Callback a_onChange);
+    void Stop();
+
+    // Changes whenever a reload could load something different.
+    static std::uint64_t Fingerprint(const std::filesystem::path& a_path);
+
+private:
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    bool m_isStopping{false};
+};
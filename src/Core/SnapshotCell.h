@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// An immutable T published through a single atomic pointer, with RCU-style reclamation.
+//
+// Readers register in the counter of the current epoch with one atomic increment, load the pointer and use the T
+// until their guard goes away: no locks, no retries, no waiting on writers. Publish() swaps the new T in with one
+// atomic exchange, so a reader sees either the old T or the new one, never a mix. The old T is retired: Publish()
+// moves the epoch on twice, each time waiting for the readers counted in the epoch it left, and only then deletes
+// it. Any reader that could still hold the old pointer has released it by then.
+//
+// Publish() may block for that grace period, so it belongs on a loader thread, not on the game thread. There,
+// PublishDeferred() swaps the same way but never waits: the old T is only queued, and freed by the next Publish() or
+// by the cell itself.
+template <class T>
+class SnapshotCell {
+public:
+    class ReadGuard {
+    public:
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() { m_readers.fetch_sub(1, std::memory_order_release); }
+
+        const T* Get() const { return m_snapshot; }
+        const T* operator->() const { return m_snapshot; }
+        const T& operator*() const { return *m_snapshot; }
+        explicit operator bool() const { return m_snapshot != nullptr; }
+
+    private:
+        friend class SnapshotCell;
+        ReadGuard(std::atomic<std::uint64_t>& a_readers, const T* a_snapshot)
+            : m_readers(a_readers), m_snapshot(a_snapshot) {}
+
+        std::atomic<std::uint64_t>& m_readers;
+        const T* m_snapshot;
+    };
+
+    SnapshotCell() = default;
+    ~SnapshotCell() { delete m_current.load(std::memory_order_acquire); }  // frees m_retired as well
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    ReadGuard Read() const {
+        auto& readers = m_readers[m_epoch.load(std::memory_order_seq_cst) & 1].count;
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        return ReadGuard(readers, m_current.load(std::memory_order_seq_cst));
+    }
+
+    void Publish(std::unique_ptr<const T> a_next) {
+        std::scoped_lock lock(m_publishLock);
+        std::unique_ptr<const T> previous(m_current.exchange(a_next.release(), std::memory_order_seq_cst));
+        if (previous || !m_retired.empty()) {
+            WaitForReaders();
+            m_retired.clear();
+        }
+    }
+
+    void PublishDeferred(std::unique_ptr<const T> a_next) {
+        std::scoped_lock lock(m_publishLock);
+        std::unique_ptr<const T> previous(m_current.exchange(a_next.release(), std::memory_order_seq_cst));
+        if (previous) {
+            m_retired.push_back(std::move(previous));
+        }
+    }
+
+    std::uint64_t GetEpoch() const { return m_epoch.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Readers {
+        std::atomic<std::uint64_t> count{0};
+    };
+
+    // A reader that registered before the exchange is counted in one of the two epochs; waiting for each in turn,
+    // while new readers go to the other one, catches it without ever blocking them.
+    void WaitForReaders() {
+        for (int phase = 0; phase < 2; ++phase) {
+            const std::uint64_t left = m_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+            while (m_readers[left].count.load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::atomic<const T*> m_current{nullptr};
+    std::atomic<std::uint64_t> m_epoch{0};
+    mutable std::array<Readers, 2> m_readers;
+    std::mutex m_publishLock;
+    std::vector<std::unique_ptr<const T>> m_retired;  // swapped out by PublishDeferred(), still possibly read
+};
@@ -0,0 +1,68 @@
+#include "VerdictCache.h"
+#include <bit>
+
+VerdictCache::VerdictCache(std::size_t a_capacity) {
+    const std::size_t capacity = std::bit_ceil(a_capacity < kMaxProbes ? kMaxProbes : a_capacity);
+    m_slots = std::make_unique<std::atomic<std::uint64_t>[]>(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+        m_slots[i].store(0, std::memory_order_relaxed);
+    }
+    m_mask = capacity - 1;
+}
+
+std::optional<bool> VerdictCache::Lookup(std::uint32_t a_formID, std::uint32_t a_generation) const {
+    const std::uint64_t expected = Pack(a_formID, a_generation, false);
+
+    std::size_t i = Home(a_formID);
+    for (std::size_t probe = 0; probe < kMaxProbes; ++probe, i = (i + 1) & m_mask) {
+        const std::uint64_t slot = m_slots[i].load(std::memory_order_acquire);
+        if ((slot & ~std::uint64_t{1}) == expected) {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return (slot & 1) != 0;
+        }
+        if (slot == 0) {
+            break;
+        }
+    }
+
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+void VerdictCache::Store(std::uint32_t a_formID, std::uint32_t a_generation, bool a_verdict) {
+    const std::uint32_t generation = a_generation & kGenerationMask;
+    const std::uint64_t desired = Pack(a_formID, generation, a_verdict);
+
+    const std::size_t home = Home(a_formID);
+    std::size_t i = home;
+    for (std::size_t probe = 0; probe < kMaxProbes; ++probe, i = (i + 1) & m_mask) {
+        std::uint64_t slot = m_slots[i].load(std::memory_order_relaxed);
+        const bool isFree = slot == 0 || ((slot >> 1) & kGenerationMask) != generation;
+        const bool isSame = (slot >> 32) == a_formID;
+        if ((isFree || isSame) && m_slots[i].compare_exchange_strong(slot, desired, std::memory_order_release)) {
+            return;
+        }
+    }
+
+    // Probe window is full of live entries; evict whatever sits in the home slot.
+    m_slots[home].store(desired, std::memory_order_release);
+}
+
+void VerdictCache::Clear() {
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+VerdictCache::Stats VerdictCache::GetStats() const {
+    return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed)};
+}
+
+std::uint64_t VerdictCache::Pack(std::uint32_t a_formID, std::uint32_t a_generation, bool a_verdict) {
+    return (std::uint64_t{a_formID} << 32) | (std::uint64_t{a_generation & kGenerationMask} << 1) |
+           (a_verdict ? 1u : 0u);
+}
+
+std::size_t VerdictCache::Home(std::uint32_t a_formID) const {
+    return static_cast<std::size_t>((std::uint64_t{a_formID} * 0x9E3779B97F4A7C15ull) >> 32) & m_mask;
+}
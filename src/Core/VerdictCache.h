@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+// FormID-keyed memo of high-heel verdicts.
+//
+// A fixed-size open-addressing table of packed 64-bit slots: FormID in the high half, the generation the entry was
+// written in and the verdict in the low half. Lookups are plain atomic loads and never block; a miss is filled with
+// a compare-exchange, and if every slot in the probe window is taken the home slot is overwritten.
+//
+// The caller passes the generation of the rules a verdict was computed with, so an entry stored from an older rule
+// snapshot, even one stored after a newer snapshot was published, never answers a lookup for the newer one. Entries
+// of other generations count as empty slots.
+class VerdictCache {
+public:
+    struct Stats {
+        std::uint64_t hits{};
+        std::uint64_t misses{};
+    };
+
+    explicit VerdictCache(std::size_t a_capacity = 4096);
+
+    static constexpr std::uint32_t kGenerationMask = 0x7FFFFFFF;
+
+    // a_generation must be non-zero after masking with kGenerationMask.
+    std::optional<bool> Lookup(std::uint32_t a_formID, std::uint32_t a_generation) const;
+    void Store(std::uint32_t a_formID, std::uint32_t a_generation, bool a_verdict);
+    // Empties every slot. Needed when generations wrap around, so an old entry cannot look current again.
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    static constexpr std::size_t kMaxProbes = 8;
+
+    static std::uint64_t Pack(std::uint32_t a_formID, std::uint32_t a_generation, bool a_verdict);
+    std::size_t Home(std::uint32_t a_formID) const;
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_slots;
+    std::size_t m_mask;
+    mutable std::atomic<std::uint64_t> m_hits{0};
+    mutable std::atomic<std::uint64_t> m_misses{0};
+};
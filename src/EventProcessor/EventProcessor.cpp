@@ -3,8 +3,15 @@
 #include "EventProcessor.h"
 
 #include "BodyMorphManager/BodyMorphManager.h"
+#include "Core/DeferredLog.h"
+#include "Core/Metrics.h"
 #include "HighHeelDetector/HighHeelDetector.h"
 
+EventProcessor::EventProcessor()
+    : m_equipPipeline(*this, HighHeelDetector::GetSingleton().GetClassifier(),
+                      BodyMorphManager::GetSingleton().GetMorphApplier()),
+      m_actorSweep(*this, m_equipPipeline) {}
+
 EventProcessor& EventProcessor::GetSingleton() {
     static EventProcessor instance;
     return instance;
@@ -12,17 +19,18 @@ EventProcessor& EventProcessor::GetSingleton() {
 
 RE::BSEventNotifyControl EventProcessor::ProcessEvent(const RE::TESEquipEvent* a_event,
                                                       RE::BSTEventSource<RE::TESEquipEvent>*) {
-    SKSE::log::trace(">>>> Entering EventProcessor::ProcessEvent");
+    AP_LOG_TRACE(">>>> Entering EventProcessor::ProcessEvent");
     if (!a_event) {
         SKSE::log::warn("EventProcessor::ProcessEvent - Received null event");
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (null event)");
+        AP_LOG_TRACE("<<<< Exiting EventProcessor::ProcessEvent (null event)");
         return RE::BSEventNotifyControl::kContinue;
     }
 
     RE::Actor* actor = a_event->actor->As<RE::Actor>();
     if (!actor) {
+        AP_METRICS_COUNT(kFilteredNotActor);
         SKSE::log::warn("EventProcessor::ProcessEvent - Actor reference is not an Actor");
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (not an actor)");
+        AP_LOG_TRACE("<<<< Exiting EventProcessor::ProcessEvent (not an actor)");
         return RE::BSEventNotifyControl::kContinue;
     }
 
@@ -36,43 +44,200 @@ RE::BSEventNotifyControl EventProcessor::ProcessEvent(const RE::TESEquipEvent* a
     // if (!race || !race->GetPlayable()) return RE::BSEventNotifyControl::kContinue;
     // Above two check is too strick according to user report by DemiGod4789
 
-    RE::TESForm* form = RE::TESForm::LookupByID(a_event->baseObject);
-    if (!form) {
-        SKSE::log::warn("EventProcessor::ProcessEvent - Form not found for ID: {:X}", a_event->baseObject);
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (no form)");
-        return RE::BSEventNotifyControl::kContinue;
+    AP_LOG_TRACE("Processing equip event: actor={}, baseObject={:#x}, equipped={}",
+                     actor->GetName() ? actor->GetName() : "unnamed", a_event->baseObject, a_event->equipped);
+
+    // Only advance the actor's pending state here. The morph is written once per actor in a deferred flush, after
+    // the whole burst of equip events has been seen.
+    if (m_equipPipeline.OnEquipEvent({actor->GetFormID(), a_event->baseObject, a_event->equipped})) {
+        AP_LOG_TRACE("EventProcessor::ProcessEvent - Scheduling flush of dirty actors");
+        const auto* taskInterface = SKSE::GetTaskInterface();
+        if (taskInterface) {
+            taskInterface->AddTask([]() { EventProcessor::GetSingleton().FlushDirtyActors(); });
+        } else {
+            SKSE::log::warn("EventProcessor::ProcessEvent - Task interface unavailable, flushing immediately");
+            FlushDirtyActors();
+        }
     }
-    if (!form->IsArmor()) {
-        SKSE::log::trace("EventProcessor::ProcessEvent - Form is not armor");
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (not armor)");
-        return RE::BSEventNotifyControl::kContinue;
+
+    AP_LOG_TRACE("<<<< Exiting EventProcessor::ProcessEvent");
+    return RE::BSEventNotifyControl::kContinue;
+};
+
+void EventProcessor::FlushDirtyActors() {
+    AP_LOG_TRACE(">>>> Entering EventProcessor::FlushDirtyActors");
+    m_equipPipeline.Flush();
+    ScheduleMorphCommit();
+    AP_LOG_TRACE("<<<< Exiting EventProcessor::FlushDirtyActors");
+}
+
+void EventProcessor::ScheduleMorphCommit() {
+    auto& morphApplier = BodyMorphManager::GetSingleton().GetMorphApplier();
+    if (!morphApplier.RequestCommit()) {
+        return;
+    }
+    // Queued from inside a task, the commit runs on the next frame and picks up every morph recorded until then.
+    if (const auto* taskInterface = SKSE::GetTaskInterface()) {
+        taskInterface->AddTask([]() {
+            auto& bodyMorphManager = BodyMorphManager::GetSingleton();
+            bodyMorphManager.GetMorphApplier().Commit(EventProcessor::GetSingleton());
+            bodyMorphManager.PruneAppliedMorphsIfDue();
+            AP_METRICS_DUMP_IF_DUE("periodic");
+        });
+    } else {
+        SKSE::log::warn("EventProcessor::ScheduleMorphCommit - Task interface unavailable, committing immediately");
+        morphApplier.Commit(*this);
     }
+}
 
-    RE::TESObjectARMO* armor = form->As<RE::TESObjectARMO>();
-    if (!armor) {
-        SKSE::log::warn("EventProcessor::ProcessEvent - Failed to cast form to armor");
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (cast failed)");
+void EventProcessor::CollectFootwear() {
+    SKSE::log::trace(">>>> Entering EventProcessor::CollectFootwear");
+
+    auto* dataHandler = RE::TESDataHandler::GetSingleton();
+    if (!dataHandler) {
+        SKSE::log::warn("EventProcessor::CollectFootwear - TESDataHandler not available, equip events are not "
+                        "prefiltered");
+        SKSE::log::trace("<<<< Exiting EventProcessor::CollectFootwear");
+        return;
+    }
+
+    using Slot = RE::BGSBipedObjectForm::BipedObjectSlot;
+    std::vector<std::uint32_t> formIDs;
+    for (const RE::TESObjectARMO* armor : dataHandler->GetFormArray<RE::TESObjectARMO>()) {
+        if (armor && (armor->HasPartOf(Slot::kFeet) || armor->HasPartOf(Slot::kCalves))) {
+            formIDs.push_back(armor->GetFormID());
+        }
+    }
+    GetSingleton().m_equipPipeline.SetFootwear(formIDs);
+    SKSE::log::trace("<<<< Exiting EventProcessor::CollectFootwear");
+}
+
+RE::BSEventNotifyControl EventProcessor::ProcessEvent(const RE::TESCellAttachDetachEvent* a_event,
+                                                      RE::BSTEventSource<RE::TESCellAttachDetachEvent>*) {
+    if (!a_event || !a_event->reference) {
+        return RE::BSEventNotifyControl::kContinue;
+    }
+    auto* actor = a_event->reference->As<RE::Actor>();
+    if (!actor) {
         return RE::BSEventNotifyControl::kContinue;
     }
-    if (!armor->HasPartOf(RE::BGSBipedObjectForm::BipedObjectSlot::kFeet)) {
-        SKSE::log::trace("EventProcessor::ProcessEvent - Armor is not footwear");
-        SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent (not footwear)");
+    if (!a_event->attached) {
+        // Queued again, and reconciled against SKEE, when it comes back.
+        BodyMorphManager::GetSingleton().GetMorphApplier().ForgetActor(actor->GetFormID());
         return RE::BSEventNotifyControl::kContinue;
-    }  // calve
+    }
+
+    AP_LOG_TRACE("EventProcessor::ProcessEvent - Actor {:#x} attached, queueing it for the actor sweep",
+                 actor->GetFormID());
+    const ActorSweep::Target target{actor->GetFormID(), actor->GetPosition().GetDistance(GetCameraPosition())};
+    EnqueueSweep({&target, 1});
+    return RE::BSEventNotifyControl::kContinue;
+}
+
+RE::BSEventNotifyControl EventProcessor::ProcessEvent(const RE::TESFormDeleteEvent* a_event,
+                                                      RE::BSTEventSource<RE::TESFormDeleteEvent>*) {
+    if (a_event && a_event->formID != 0) {
+        BodyMorphManager::GetSingleton().GetMorphApplier().ForgetActor(a_event->formID);
+    }
+    return RE::BSEventNotifyControl::kContinue;
+}
+
+void EventProcessor::SweepLoadedActors(bool a_isKnownSkipped) {
+    SKSE::log::trace(">>>> Entering EventProcessor::SweepLoadedActors");
+
+    const RE::NiPoint3 camera = GetCameraPosition();
+    const auto& morphApplier = BodyMorphManager::GetSingleton().GetMorphApplier();
+    std::vector<ActorSweep::Target> targets;
+    std::size_t skipped = 0;
+    const auto queue = [&](RE::Actor* a_actor) {
+        const RE::FormID formID = a_actor->GetFormID();
+        if (a_isKnownSkipped && morphApplier.GetAppliedState(formID) != MorphStateMachine::State::kInvalid) {
+            ++skipped;
+            return;
+        }
+        targets.push_back({formID, a_actor->GetPosition().GetDistance(camera)});
+    };
+    if (auto* player = RE::PlayerCharacter::GetSingleton()) {
+        queue(player);
+    }
+    if (auto* processLists = RE::ProcessLists::GetSingleton()) {
+        for (auto& handle : processLists->highActorHandles) {
+            if (const auto actor = handle.get()) {
+                queue(actor.get());
+            }
+        }
+    }
+
+    SKSE::log::info("Queued {} loaded actor(s) for the actor sweep, {} already known.", targets.size(), skipped);
+    GetSingleton().EnqueueSweep(targets);
+    SKSE::log::trace("<<<< Exiting EventProcessor::SweepLoadedActors");
+}
 
-    const char* actorName = actor->GetName() ? actor->GetName() : "unnamed";
-    const char* armorName = armor->GetName() ? armor->GetName() : "unnamed";
-    SKSE::log::trace("Processing equip event: actor={}, feetArmor={}, equipped={}", actorName, armorName,
-                     a_event->equipped);
+void EventProcessor::CancelActorSweep() { GetSingleton().m_actorSweep.Clear(); }
 
-    if (a_event->equipped) {
-        SKSE::log::trace("EventProcessor::ProcessEvent - Equipment equipped");
-        BodyMorphManager::GetSingleton().UpdateHighHeelMorph(actor, HighHeelDetector::GetSingleton().IsHighHeel(armor));
+void EventProcessor::EnqueueSweep(std::span<const ActorSweep::Target> a_targets) {
+    if (!m_actorSweep.Enqueue(a_targets)) {
+        return;
+    }
+    // SKSE runs a task added from inside a task on the next frame, so every RunSweepFrame() gets a frame of its own.
+    if (const auto* taskInterface = SKSE::GetTaskInterface()) {
+        taskInterface->AddTask([]() { EventProcessor::GetSingleton().RunSweepFrame(); });
     } else {
-        SKSE::log::trace("EventProcessor::ProcessEvent - Equipment unequipped");
-        BodyMorphManager::GetSingleton().UpdateHighHeelMorph(actor, false);
+        SKSE::log::warn("EventProcessor::EnqueueSweep - Task interface unavailable, sweeping in one go");
+        while (m_actorSweep.RunFrame()) {
+        }
+        ScheduleMorphCommit();
     }
+}
 
-    SKSE::log::trace("<<<< Exiting EventProcessor::ProcessEvent");
-    return RE::BSEventNotifyControl::kContinue;
-};
\ No newline at end of file
+void EventProcessor::RunSweepFrame() {
+    const bool isPending = m_actorSweep.RunFrame();
+    ScheduleMorphCommit();
+    if (!isPending) {
+        return;
+    }
+    if (const auto* taskInterface = SKSE::GetTaskInterface()) {
+        taskInterface->AddTask([]() { EventProcessor::GetSingleton().RunSweepFrame(); });
+    }
+}
+
+RE::NiPoint3 EventProcessor::GetCameraPosition() {
+    if (const auto* camera = RE::PlayerCamera::GetSingleton(); camera && camera->cameraRoot) {
+        return camera->cameraRoot->world.translate;
+    }
+    if (const auto* player = RE::PlayerCharacter::GetSingleton()) {
+        return player->GetPosition();
+    }
+    return {};
+}
+
+bool EventProcessor::LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) {
+    RE::TESForm* form = RE::TESForm::LookupByID(a_formID);
+    if (!form) {
+        SKSE::log::warn("EventProcessor::LookupArmor - Form not found for ID: {:X}", a_formID);
+        return false;
+    }
+    RE::TESObjectARMO* armor = form->As<RE::TESObjectARMO>();
+    if (!armor) {
+        AP_LOG_TRACE("EventProcessor::LookupArmor - Form is not armor");
+        return false;
+    }
+    HighHeelDetector::MakeArmorInfo(armor, a_out);
+    return true;
+}
+
+ActorHandle EventProcessor::LookupActor(std::uint32_t a_formID) {
+    return BodyMorphManager::MakeActorHandle(RE::TESForm::LookupByID<RE::Actor>(a_formID));
+}
+
+bool EventProcessor::GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) {
+    using Slot = RE::BGSBipedObjectForm::BipedObjectSlot;
+
+    auto* actor = static_cast<RE::Actor*>(a_actor.native);
+    RE::TESObjectARMO* armor = actor->GetWornArmor(a_slot == ArmorSlot::kFeet ? Slot::kFeet : Slot::kCalves);
+    if (!armor) {
+        return false;
+    }
+    HighHeelDetector::MakeArmorInfo(armor, a_out);
+    return true;
+}
@@ -1,17 +1,52 @@
 // src/EventProcessor/EventProcessor.h
 #pragma once
+#include "Core/ActorSweep.h"
+#include "Core/EquipPipeline.h"
 
-class EventProcessor : public RE::BSTEventSink<RE::TESEquipEvent> {
+class EventProcessor : public RE::BSTEventSink<RE::TESEquipEvent>,
+                       public RE::BSTEventSink<RE::TESCellAttachDetachEvent>,
+                       public RE::BSTEventSink<RE::TESFormDeleteEvent>,
+                       public IArmorLookup {
 private:
-    EventProcessor() = default;
+    EventProcessor();
     ~EventProcessor() = default;
     EventProcessor(const EventProcessor&) = delete;
     EventProcessor(EventProcessor&&) = delete;
     EventProcessor& operator=(const EventProcessor&) = delete;
     EventProcessor& operator=(EventProcessor&&) = delete;
 
+    EquipPipeline m_equipPipeline;
+    ActorSweep m_actorSweep;
+
+    void FlushDirtyActors();
+    // Queues a commit of the morphs recorded by the pipeline, unless one is already queued.
+    void ScheduleMorphCommit();
+    void EnqueueSweep(std::span<const ActorSweep::Target> a_targets);
+    // Runs one frame of the actor sweep and queues the next one while actors are left.
+    void RunSweepFrame();
+    static RE::NiPoint3 GetCameraPosition();
+
 public:
     static EventProcessor& GetSingleton();
     RE::BSEventNotifyControl ProcessEvent(const RE::TESEquipEvent* a_event,
                                           RE::BSTEventSource<RE::TESEquipEvent>*) override;
-};
\ No newline at end of file
+    // Queues actors that come into the loaded area for the actor sweep and forgets those that leave it.
+    RE::BSEventNotifyControl ProcessEvent(const RE::TESCellAttachDetachEvent* a_event,
+                                          RE::BSTEventSource<RE::TESCellAttachDetachEvent>*) override;
+    // Forgets deleted actors.
+    RE::BSEventNotifyControl ProcessEvent(const RE::TESFormDeleteEvent* a_event,
+                                          RE::BSTEventSource<RE::TESFormDeleteEvent>*) override;
+    // Hands the equip pipeline every armor that covers the feet or calves, so equip events for anything else return
+    // before the form lookup. Call on kDataLoaded.
+    static void CollectFootwear();
+    // Queues the player and every actor in high process for the actor sweep, nearest to the camera first, which
+    // re-evaluates a few of them per frame. With a_isKnownSkipped, actors whose applied state is already known, such
+    // as those just restored from the co-save, are left out. Game thread only.
+    static void SweepLoadedActors(bool a_isKnownSkipped = false);
+    // Drops the actors still queued, e.g. before another game is loaded.
+    static void CancelActorSweep();
+
+    bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override;
+    ActorHandle LookupActor(std::uint32_t a_formID) override;
+    bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override;
+};
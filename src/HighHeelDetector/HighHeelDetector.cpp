@@ -1,185 +1,202 @@
 // src/HighHeelDetector/HighHeelDetector.cpp
 #include "PCH.h"
 #include "HighHeelDetector.h"
-#include <fstream>
-#include <sstream>
+#include "Core/DeferredLog.h"
+
+namespace {
+    std::string ToLower(std::string_view a_text) {
+        std::string result(a_text);
+        for (char& c : result) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return result;
+    }
+}
 
 HighHeelDetector& HighHeelDetector::GetSingleton() {
     static HighHeelDetector instance;
     return instance;
 }
 
-bool HighHeelDetector::Init(const std::string& jsonPath) {
+bool HighHeelDetector::Init(const std::string& rulePath) {
     SKSE::log::trace(">>>> Entering HighHeelDetector::Init");
-    SKSE::log::info("Initializing HighHeelDetector from '{}'...", jsonPath);
 
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) {
-        SKSE::log::error("Failed to open high heel definition file: {}", jsonPath);
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::Init (result: false)");
-        return false;
-    }
+    rulePath_ = rulePath;
+    const bool result = classifier_.Load(rulePath_);
 
-    nlohmann::json j;
-    try {
-        file >> j;
-        SKSE::log::debug("JSON file parsed successfully.");
-    } catch (const nlohmann::json::parse_error& e) {
-        SKSE::log::error("Failed to parse JSON from '{}'. Details: {}", jsonPath, e.what());
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::Init (result: false)");
-        return false;
-    }
-
-    if (ParseJson(j)) {
-        SKSE::log::info(
-            "HighHeelDetector initialized successfully. Loaded {} keyword rule(s) and {} FormID range rule(s).",
-            keywordsRules_.size(), formIDRangeRules_.size());
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::Init (result: true)");
-        return true;
-    } else {
-        SKSE::log::error("Failed to process rules from high heel definition file.");
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::Init (result: false)");
-        return false;
-    }
+    SKSE::log::trace("<<<< Exiting HighHeelDetector::Init (result: {})", result);
+    return result;
 }
 
-namespace {
-    inline bool IsValidFormIDRangeRulesJson(const nlohmann::json& a_ruleJson) {
-        if (!a_ruleJson.is_object() || !a_ruleJson.contains("Plugin") || !a_ruleJson.contains("Min") ||
-            !a_ruleJson.contains("Max")) {
-            return false;
-        }
-        return true;
-    }
-};
-
-bool HighHeelDetector::ParseFormIDRange(const nlohmann::json& j) {
-    SKSE::log::trace(">>>> Entering HighHeelDetector::ParseFormIDRange");
+void HighHeelDetector::OnDataLoaded() {
+    SKSE::log::trace(">>>> Entering HighHeelDetector::OnDataLoaded");
 
-    if (!j.contains("ByFormIDRange")) {
-        SKSE::log::warn("'ByFormIDRange' section not found in JSON, skipping.");
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseFormIDRange (result: true)");
-        return true;
-    }
+    classifier_.SetArmorCatalog(CollectArmorCatalog());
 
-    const auto& formIDRangeRulesJson = j["ByFormIDRange"];
-    if (!formIDRangeRulesJson.is_array()) {
-        SKSE::log::error("'ByFormIDRange' must be an array. JSON content: {}", formIDRangeRulesJson.dump());
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseFormIDRange (result: false)");
-        return false;
+    // The resolver also runs on the rule watcher's thread for reloads, where the game's editor ID map must not be
+    // read. Copy the keywords here instead, keyed the way BSFixedString compares: ignoring case.
+    auto keywordIDs = std::make_shared<std::unordered_map<std::string, std::uint32_t>>();
+    if (auto* dataHandler = RE::TESDataHandler::GetSingleton()) {
+        for (const RE::BGSKeyword* keyword : dataHandler->GetFormArray<RE::BGSKeyword>()) {
+            const char* editorID = keyword ? keyword->GetFormEditorID() : nullptr;
+            if (editorID && *editorID) {
+                keywordIDs->insert_or_assign(ToLower(editorID), keyword->GetFormID());
+            }
+        }
     }
+    SKSE::log::debug("HighHeelDetector::OnDataLoaded - Copied {} keyword editor ID(s)", keywordIDs->size());
 
-    for (const auto& ruleJson : formIDRangeRulesJson) {
-        if (!IsValidFormIDRangeRulesJson(ruleJson)) {
-            SKSE::log::error("Invalid FormID range rule found, skipping. Rule content: {}", ruleJson.dump());
-            continue;
+    classifier_.ResolveKeywords([keywordIDs](std::string_view a_editorID) -> std::optional<std::uint32_t> {
+        const auto it = keywordIDs->find(ToLower(a_editorID));
+        if (it == keywordIDs->end()) {
+            return std::nullopt;
         }
-        try {
-            FormIDRangeRule rule;
-            rule.plugin = ruleJson["Plugin"].get<std::string>();
-            rule.min = static_cast<RE::FormID>(std::stoul(ruleJson["Min"].get<std::string>(), nullptr, 16));
-            rule.max = static_cast<RE::FormID>(std::stoul(ruleJson["Max"].get<std::string>(), nullptr, 16));
-
-            if (rule.max < rule.min) {
-                SKSE::log::warn(
-                    "Invalid FormID range rule for plugin '{}', skipping: Max ({:#x}) is lesser than Min ({:#x}). ",
-                    rule.plugin, rule.max, rule.min);
-                continue;
-            }
+        return it->second;
+    });
 
-            formIDRangeRules_.push_back(rule);
-            SKSE::log::debug("Loaded FormID range rule: Plugin='{}', Min={:#x}, Max={:#x}", rule.plugin, rule.min,
-                             rule.max);
-        } catch (const std::exception& e) {
-            SKSE::log::error("Failed to parse FormIDRange rule. Content: {}. Details: {}", ruleJson.dump(), e.what());
-            continue;
-        }
-    }
-    return true;
+    SKSE::log::trace("<<<< Exiting HighHeelDetector::OnDataLoaded");
 }
 
-bool HighHeelDetector::ParseKeywords(const nlohmann::json& j) {
-    SKSE::log::trace(">>>> Entering HighHeelDetector::ParseKeywords");
+void HighHeelDetector::WatchRules(std::function<void()> onReload) {
+    SKSE::log::trace(">>>> Entering HighHeelDetector::WatchRules");
 
-    if (!j.contains("ByKeywords")) {
-        SKSE::log::warn("'ByKeywords' section not found in JSON, skipping.");
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseKeywords (result: true)");
-        return true;
-    }
-
-    const auto& keywords = j["ByKeywords"];
-    if (!keywords.is_array()) {
-        SKSE::log::error("'ByKeywords' must be an array. JSON content: {}", keywords.dump());
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseKeywords (result: false)");
-        return false;
+    if (!ruleWatcher_) {
+        ruleWatcher_ = new RuleWatcher();
     }
-
-    for (const auto& kw : keywords) {
-        if (!kw.is_string()) {
-            SKSE::log::error("Keyword must be a string, skipping. Content: {}", kw.dump());
-            continue;
+    // Compared with the files as OnDataLoaded() parsed them, so an edit made since then is still picked up.
+    const std::uint64_t loaded = classifier_.GetSourceFingerprint();
+    ruleWatcher_->Start(rulePath_, loaded, std::chrono::seconds(2), [this, onReload = std::move(onReload)]() {
+        // The watcher's thread: the only place a publish may wait for readers of the rules it replaces.
+        if (classifier_.Reload()) {
+            onReload();
         }
-        auto keywordStr = kw.get<std::string>();
-        keywordsRules_.push_back(keywordStr);
-        SKSE::log::debug("Loaded keyword rule: '{}'", keywordStr);
-    }
-    SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseKeywords (result: true)");
-    return true;
-}
+    });
 
-bool HighHeelDetector::ParseJson(const nlohmann::json& j) {
-    SKSE::log::trace(">>>> Entering HighHeelDetector::ParseJson");
-    keywordsRules_.clear();
-    formIDRangeRules_.clear();
-
-    bool keywordsParsed = ParseKeywords(j);
-    bool formIDRangeParsed = ParseFormIDRange(j);
-
-    bool result = keywordsParsed && formIDRangeParsed;
-    SKSE::log::trace("<<<< Exiting HighHeelDetector::ParseJson (result: {})", result);
-    return result;
+    SKSE::log::trace("<<<< Exiting HighHeelDetector::WatchRules");
 }
 
 bool HighHeelDetector::IsHighHeel(RE::TESObjectARMO* a_armor) const {
-    SKSE::log::trace(">>>> Entering HighHeelDetector::IsHighHeel");
-
     if (!a_armor) {
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::IsHighHeel (result: false, armor is null)");
+        AP_LOG_TRACE("HighHeelDetector::IsHighHeel - Armor is null");
         return false;
     }
 
-    SKSE::log::debug("Checking if armor '{}' (FormID: {:#x}) is a high heel...", a_armor->GetName(),
-                     a_armor->GetFormID());
+    ArmorInfo armor;
+    MakeArmorInfo(a_armor, armor);
+    return classifier_.IsHighHeel(armor);
+}
+
+void HighHeelDetector::ClassifyBatch(std::span<const ArmorKey> a_keys, std::span<std::uint8_t> a_out) const {
+    classifier_.ClassifyBatch(a_keys, a_out);
+}
+
+VerdictCache::Stats HighHeelDetector::GetCacheStats() const { return classifier_.GetCacheStats(); }
 
-    for (const auto& kw : keywordsRules_) {
-        if (a_armor->HasKeywordString(kw)) {
-            SKSE::log::debug("Decision: YES. Matched keyword rule: '{}'.", kw);
-            SKSE::log::trace("<<<< Exiting HighHeelDetector::IsHighHeel (result: true)");
-            return true;
+void HighHeelDetector::MakeArmorInfo(RE::TESObjectARMO* a_armor, ArmorInfo& a_out) {
+    thread_local std::vector<std::uint32_t> keywords;
+    thread_local std::vector<std::string_view> modelPaths;
+
+    keywords.clear();
+    for (std::uint32_t i = 0; i < a_armor->numKeywords; ++i) {
+        if (const RE::BGSKeyword* keyword = a_armor->keywords[i]) {
+            keywords.push_back(keyword->GetFormID());
+        }
+    }
+    // The model strings belong to the forms, which live as long as the game.
+    modelPaths.clear();
+    for (const RE::TESObjectARMA* addon : a_armor->armorAddons) {
+        if (!addon) {
+            continue;
+        }
+        for (const auto& model : addon->bipedModels) {
+            if (const char* path = model.GetModel(); path && *path) {
+                modelPaths.emplace_back(path);
+            }
         }
     }
 
     const RE::TESFile* file = a_armor->GetFile(0);
-    if (!file) {
-        SKSE::log::trace("Cannot check by FormID: armor has an invalid file pointer.");
-        SKSE::log::trace("<<<< Exiting HighHeelDetector::IsHighHeel (result: false)");
-        return false;
-    }
+    a_out.formID = a_armor->GetFormID();
+    a_out.plugin = file ? file->GetFilename() : std::string_view{};
+    a_out.localFormID = a_armor->GetLocalFormID();
+    a_out.keywords = keywords;
+    a_out.coversFeet = a_armor->HasPartOf(RE::BGSBipedObjectForm::BipedObjectSlot::kFeet);
+    a_out.coversCalves = a_armor->HasPartOf(RE::BGSBipedObjectForm::BipedObjectSlot::kCalves);
+    a_out.isDynamic = a_armor->IsDynamicForm();
+    const char* name = a_armor->GetName();
+    a_out.name = name ? std::string_view(name) : std::string_view{};
+    a_out.modelPaths = modelPaths;
+}
 
-    std::string_view fileName = file->GetFilename();
-    const RE::FormID localFormID = a_armor->GetLocalFormID();
+std::shared_ptr<const ArmorCatalog> HighHeelDetector::CollectArmorCatalog() {
+    auto catalog = std::make_shared<ArmorCatalog>();
+    auto* dataHandler = RE::TESDataHandler::GetSingleton();
+    if (!dataHandler) {
+        SKSE::log::warn("HighHeelDetector::CollectArmorCatalog - TESDataHandler not available");
+        return catalog;
+    }
 
-    for (const auto& rule : formIDRangeRules_) {
-        if (fileName == rule.plugin && localFormID >= rule.min && localFormID <= rule.max) {
-            SKSE::log::debug(
-                "Decision: YES. Matched FormID range rule. Plugin: '{}', FormID {:#x} is in [{:#x} - {:#x}].",
-                rule.plugin, localFormID, rule.min, rule.max);
-            SKSE::log::trace("<<<< Exiting HighHeelDetector::IsHighHeel (result: true)");
-            return true;
+    // Strings are copied into catalog->text and located by offset until it has stopped growing.
+    struct TextRange {
+        std::size_t offset{};
+        std::size_t size{};
+    };
+    struct Pending {
+        TextRange plugin;
+        TextRange name;
+        std::size_t keywordBegin{};
+        std::size_t modelPathBegin{};
+    };
+    const auto copyText = [&catalog](std::string_view a_text) {
+        const TextRange range{catalog->text.size(), a_text.size()};
+        catalog->text.append(a_text);
+        return range;
+    };
+
+    std::vector<Pending> pending;
+    std::vector<TextRange> modelPaths;
+    std::unordered_map<std::string_view, TextRange> plugins;  // most plugins define many armors
+    for (RE::TESObjectARMO* armor : dataHandler->GetFormArray<RE::TESObjectARMO>()) {
+        if (!armor || !armor->HasPartOf(RE::BGSBipedObjectForm::BipedObjectSlot::kFeet)) {
+            continue;
+        }
+        ArmorInfo info;
+        MakeArmorInfo(armor, info);
+        Pending entry;
+        if (const auto it = plugins.find(info.plugin); it != plugins.end()) {
+            entry.plugin = it->second;
+        } else {
+            entry.plugin = plugins.emplace(info.plugin, copyText(info.plugin)).first->second;
         }
+        entry.name = copyText(info.name);
+        entry.keywordBegin = catalog->keywords.size();
+        catalog->keywords.insert(catalog->keywords.end(), info.keywords.begin(), info.keywords.end());
+        entry.modelPathBegin = modelPaths.size();
+        for (const auto path : info.modelPaths) {
+            modelPaths.push_back(copyText(path));
+        }
+        pending.push_back(entry);
+        catalog->armors.push_back(info);
     }
 
-    SKSE::log::debug("Decision: NO. No matching rules found for armor '{}'.", a_armor->GetName());
-    SKSE::log::trace("<<<< Exiting HighHeelDetector::IsHighHeel (result: false)");
-    return false;
-}
\ No newline at end of file
+    // Only point into the text, keyword and model path storage once it has stopped growing.
+    const std::string_view text = catalog->text;
+    const auto view = [&text](const TextRange& a_range) { return text.substr(a_range.offset, a_range.size); };
+    catalog->modelPaths.reserve(modelPaths.size());
+    for (const auto& path : modelPaths) {
+        catalog->modelPaths.push_back(view(path));
+    }
+    const std::span<const std::uint32_t> keywords = catalog->keywords;
+    const std::span<const std::string_view> modelPathViews = catalog->modelPaths;
+    for (std::size_t i = 0; i < catalog->armors.size(); ++i) {
+        auto& armor = catalog->armors[i];
+        armor.plugin = view(pending[i].plugin);
+        armor.name = view(pending[i].name);
+        armor.keywords = keywords.subspan(pending[i].keywordBegin, armor.keywords.size());
+        armor.modelPaths = modelPathViews.subspan(pending[i].modelPathBegin, armor.modelPaths.size());
+    }
+
+    SKSE::log::info("Collected {} armor(s) covering the feet, {:.1f} KiB of names and paths.", catalog->armors.size(),
+                    catalog->text.size() / 1024.0);
+    return catalog;
+}
@@ -1,34 +1,43 @@
 // src/HighHeelDetector/HighHeelDetector.h
 #pragma once
-#include <nlohmann/json.hpp>
-#include <vector>
+#include <functional>
 #include <string>
+#include "Core/HighHeelClassifier.h"
+#include "Core/RuleWatcher.h"
 
 class HighHeelDetector {
 private:
-    struct FormIDRangeRule {
-        std::string plugin{};
-        RE::FormID min{};
-        RE::FormID max{};
-    };
-
-    std::vector<FormIDRangeRule> formIDRangeRules_;
-    std::vector<std::string> keywordsRules_;
+    HighHeelClassifier classifier_;
+    std::string rulePath_;
+    // Never deleted: at exit its thread may already be gone, and joining it would hang.
+    RuleWatcher* ruleWatcher_ = nullptr;
 
 public:
     static HighHeelDetector& GetSingleton();
-    bool Init(const std::string& jsonPath);
+    // rulePath is the rule directory, whose *.json files are all loaded, or a single rule file.
+    bool Init(const std::string& rulePath);
+    // Resolves the keyword rules and pre-classifies every armor of the load order. Never waits for readers of the
+    // rules it replaces, so it is safe on the game thread.
+    void OnDataLoaded();
+    // Reloads the rules on a background thread whenever the rule files change, then calls onReload there.
+    void WatchRules(std::function<void()> onReload);
     bool IsHighHeel(RE::TESObjectARMO* armor) const;
+    // out[i] = 1 when keys[i] is a high heel, else 0. For bulk work such as scans over many armors at once.
+    void ClassifyBatch(std::span<const ArmorKey> keys, std::span<std::uint8_t> out) const;
+    VerdictCache::Stats GetCacheStats() const;
+    const HighHeelClassifier& GetClassifier() const { return classifier_; }
 
-private:
-    bool ParseJson(const nlohmann::json& j);
-    bool ParseKeywords(const nlohmann::json& j);
-    bool ParseFormIDRange(const nlohmann::json& j);
+    // The keyword span of a_out points into a thread-local buffer that the next call on the same thread reuses.
+    static void MakeArmorInfo(RE::TESObjectARMO* a_armor, ArmorInfo& a_out);
+    // Every armor covering the feet, with keywords, names and model paths copied out of the forms, so the catalog
+    // can be used off the game thread. Needs the data to be loaded.
+    static std::shared_ptr<const ArmorCatalog> CollectArmorCatalog();
 
+private:
     HighHeelDetector() = default;
     ~HighHeelDetector() = default;
     HighHeelDetector(const HighHeelDetector&) = delete;
     HighHeelDetector(HighHeelDetector&&) = delete;
     HighHeelDetector& operator=(const HighHeelDetector&) = delete;
     HighHeelDetector& operator=(HighHeelDetector&&) = delete;
-};
\ No newline at end of file
+};
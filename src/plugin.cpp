@@ -4,35 +4,14 @@
 #include <spdlog/sinks/basic_file_sink.h>
 #include "SKEE/IPluginInterface.h"
 #include "BodyMorphManager/BodyMorphManager.h"
+#include "Core/DeferredLog.h"
+#include "Core/Metrics.h"
+#include "Core/PluginSettings.h"
 #include "EventProcessor/EventProcessor.h"
 #include "HighHeelDetector/HighHeelDetector.h"
 
 namespace {
-    static bool g_firstTimePostLoadGame = true;
-}
-
-void HandleFirstTimePostLoadGame() {
-    SKSE::log::trace(">>>> Entering HandleFirstTimePostLoadGame");
-
-    RE::PlayerCharacter* player = RE::PlayerCharacter::GetSingleton();
-    if (!player) {
-        SKSE::log::warn("HandleFirstTimePostLoadGame: PlayerCharacter not found");
-        SKSE::log::trace("<<<< Exiting HandleFirstTimePostLoadGame (no player)");
-    }
-    SKSE::log::trace("HandleFirstTimePostLoadGame: Player found: {}", player->GetName());
-
-    RE::TESObjectARMO* feetArmor = player->GetWornArmor(RE::BGSBipedObjectForm::BipedObjectSlot::kFeet);
-    if (!feetArmor) {
-        SKSE::log::trace("HandleFirstTimePostLoadGame: Player is barefoot");
-        BodyMorphManager::GetSingleton().UpdateHighHeelMorph(player, false);
-        SKSE::log::trace("<<<< Exiting HandleFirstTimePostLoadGame (barefoot)");
-        return;
-    }
-
-    BodyMorphManager::GetSingleton().UpdateHighHeelMorph(player,
-                                                         HighHeelDetector::GetSingleton().IsHighHeel(feetArmor));
-
-    SKSE::log::trace("<<<< Exiting HandleFirstTimePostLoadGame");
+    constexpr const char* kDataDirectory = "Data/SKSE/AdeptivePantyhose";
 }
 
 void MessagingInterfaceEventCallback(SKSE::MessagingInterface::Message* a_msg) {
@@ -53,20 +32,55 @@ void MessagingInterfaceEventCallback(SKSE::MessagingInterface::Message* a_msg) {
         }
 
         break;
-        case SKSE::MessagingInterface::kPostLoadGame: {
-            SKSE::log::trace("Handling kPostLoadGame message");
-
-            if (!g_firstTimePostLoadGame) {
-                SKSE::log::trace("Not first time post-load game, skipping");
-            } else {
-                SKSE::log::trace("First time post-load game detected");
+        case SKSE::MessagingInterface::kDataLoaded: {
+            SKSE::log::trace("Handling kDataLoaded message");
+
+            SKSE::log::trace("Resolving HighHeelDetector keyword rules and pre-classifying armors...");
+            HighHeelDetector::GetSingleton().OnDataLoaded();
+            EventProcessor::CollectFootwear();
+
+            SKSE::log::trace("Watching high heel rules for changes...");
+            HighHeelDetector::GetSingleton().WatchRules([]() {
+                if (const auto* taskInterface = SKSE::GetTaskInterface()) {
+                    taskInterface->AddTask([]() {
+                        // States decided under the old rules must not reach a co-save under the new rule hash. The
+                        // sweep reads the loaded actors' morphs back; the others are re-evaluated when they load.
+                        BodyMorphManager::GetSingleton().GetMorphApplier().RetainActors(
+                            [](std::uint32_t) { return false; });
+                        EventProcessor::SweepLoadedActors();
+                    });
+                }
+            });
+        } break;
+        case SKSE::MessagingInterface::kPreLoadGame: {
+            SKSE::log::trace("Handling kPreLoadGame message");
 
-                g_firstTimePostLoadGame = false;
-                HandleFirstTimePostLoadGame();
+            EventProcessor::CancelActorSweep();
+            BodyMorphManager::GetSingleton().ResetAppliedMorphs();
+        } break;
+        case SKSE::MessagingInterface::kNewGame:
+        case SKSE::MessagingInterface::kPostLoadGame: {
+            SKSE::log::trace("Handling kNewGame/kPostLoadGame message");
 
-                SKSE::log::trace("HandleFirstTimePostLoadGame completed");
+            if (a_msg->type == SKSE::MessagingInterface::kNewGame) {
+                EventProcessor::CancelActorSweep();
+                BodyMorphManager::GetSingleton().ResetAppliedMorphs();
             }
 
+            // Every loaded actor, the player first, carries whatever morphs SKEE restored. Actors restored from our
+            // co-save record are known to match already; the sweep reads the others back and only writes to those
+            // whose morphs do not match what they wear, on every load of the session.
+            SKSE::log::trace("Reconciling loaded actors...");
+            EventProcessor::SweepLoadedActors(a_msg->type == SKSE::MessagingInterface::kPostLoadGame);
+        } break;
+        case SKSE::MessagingInterface::kSaveGame: {
+            SKSE::log::trace("Handling kSaveGame message");
+
+            const auto stats = HighHeelDetector::GetSingleton().GetCacheStats();
+            const auto lookups = stats.hits + stats.misses;
+            SKSE::log::info("HighHeelDetector verdict cache: {} hit(s), {} miss(es), {:.1f}% hit rate.", stats.hits,
+                            stats.misses, lookups ? 100.0 * stats.hits / lookups : 0.0);
+            AP_METRICS_LOG_SUMMARY("save");
         } break;
         default:
             break;
@@ -88,8 +102,11 @@ void InitLog() {
     spdlog::set_default_logger(std::move(loggerPtr));
 
 #ifdef _DEBUG
+    // Hot-path trace lines go through DeferredLog and reach the file from its background thread; flushing every
+    // line there would only hold the sink lock longer.
     spdlog::set_level(spdlog::level::trace);
-    spdlog::flush_on(spdlog::level::trace);
+    spdlog::flush_on(spdlog::level::warn);
+    spdlog::flush_every(std::chrono::seconds(1));
 #else
     spdlog::set_level(spdlog::level::info);
     spdlog::flush_on(spdlog::level::warn);
@@ -107,6 +124,22 @@ SKSEPluginLoad(const SKSE::LoadInterface* a_skse) {
     const auto supportEmail = plugin->GetSupportEmail();
 
     InitLog();
+    [[maybe_unused]] const auto settings =
+        PluginSettings::Load(std::filesystem::path(kDataDirectory) / PluginSettings::kFileName);
+    DeferredLog::Start();
+    // Never join the writer thread here: at exit it may already be gone.
+    std::atexit([]() {
+        DeferredLog::TryDrain();
+        spdlog::default_logger()->flush();
+    });
+#if AP_ENABLE_METRICS
+    Metrics::SetDumpInterval(settings.metricsDumpInterval);
+    // The logger outlives this: spdlog's registry was constructed before the handler was registered.
+    std::atexit([]() {
+        Metrics::LogSummary("exit");
+        spdlog::default_logger()->flush();
+    });
+#endif
 
     SKSE::log::info("==================================================");
     SKSE::log::info("Loading plugin: {}", pluginName);
@@ -132,15 +165,34 @@ SKSEPluginLoad(const SKSE::LoadInterface* a_skse) {
     SKSE::log::trace("Message listener registered successfully");
 
     SKSE::log::trace("Initializing HighHeelDetector...");
-    if (!HighHeelDetector::GetSingleton().Init("Data/SKSE/AdeptivePantyhose/DefineHighHeel.json")) {
+    if (!HighHeelDetector::GetSingleton().Init(kDataDirectory)) {
         SKSE::log::critical("Failed to initialize HighHeelDetector");
         SKSE::stl::report_and_fail(std::format("{} failed to init high heel detector", pluginName));
     }
 
+    SKSE::log::trace("Registering co-save callbacks...");
+    if (auto* serialization = SKSE::GetSerializationInterface()) {
+        serialization->SetUniqueID(BodyMorphManager::kCoSaveID);
+        serialization->SetSaveCallback(BodyMorphManager::OnGameSaved);
+        serialization->SetLoadCallback(BodyMorphManager::OnGameLoaded);
+        SKSE::log::trace("Co-save callbacks registered");
+    } else {
+        SKSE::log::warn("Failed to get serialization interface; every load will re-evaluate all actors");
+    }
+
     SKSE::log::trace("Registering equip event sink...");
     RE::ScriptEventSourceHolder::GetSingleton()->AddEventSink<RE::TESEquipEvent>(&EventProcessor::GetSingleton());
     SKSE::log::trace("Equip event sink registered");
 
+    SKSE::log::trace("Registering cell attach event sink...");
+    RE::ScriptEventSourceHolder::GetSingleton()->AddEventSink<RE::TESCellAttachDetachEvent>(
+        &EventProcessor::GetSingleton());
+    SKSE::log::trace("Cell attach event sink registered");
+
+    SKSE::log::trace("Registering form delete event sink...");
+    RE::ScriptEventSourceHolder::GetSingleton()->AddEventSink<RE::TESFormDeleteEvent>(&EventProcessor::GetSingleton());
+    SKSE::log::trace("Form delete event sink registered");
+
     SKSE::log::info("Plugin loaded successfully");
 
     return true;
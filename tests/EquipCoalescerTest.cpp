@@ -0,0 +1,305 @@
+// Equip event coalescing through EquipPipeline, with a fake event source and a fake flush tick.
+//
+// The event source changes what an actor wears and then reports the equip events for it, in the order the test
+// gives, the way TESEquipEvents arrive; the first event of a burst asks for a flush, which the fake tick runs like
+// the plugin's task queue, followed by MorphApplier::Commit(). The test checks that:
+//
+//   - a burst of N events costs one flush and one evaluation (worn armor read) per actor, for any N;
+//   - an event that arrives after the actor's batch was taken, even in the middle of the flush, marks the actor
+//     again and the next tick evaluates it once more;
+//   - a heel swap whose equip arrives before the unequip of the old heels keeps the high heel morphs;
+//
+// and that every tick ends with each actor carrying exactly the morphs of what it wears.
+//
+//   EquipCoalescerTest
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EquipPipeline.h"
+
+namespace {
+    constexpr std::uint32_t kHeelKeyword = 0x0A0B0C0D;
+
+    enum Armor : std::uint32_t {
+        kNone = 0,
+        kHighHeels = 0x00012E46,
+        kOtherHighHeels = 0x00012E47,
+        kLowHeels = 0x00012E4B,
+        kPantyhose = 0x00013EE1,
+        kCuirass = 0x00012E49,
+    };
+
+    struct Actor {
+        std::uint32_t feet{};
+        std::uint32_t calves{};
+    };
+
+    class FakeWorld : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t a_formID, ArmorInfo& a_out) override {
+            static const std::uint32_t heel[] = {kHeelKeyword};
+            const bool isHighHeel = a_formID == kHighHeels || a_formID == kOtherHighHeels;
+            a_out = {};
+            a_out.formID = a_formID;
+            a_out.plugin = "Skyrim.esm";
+            a_out.localFormID = a_formID & 0xFFFFFF;
+            a_out.keywords = isHighHeel ? std::span<const std::uint32_t>(heel) : std::span<const std::uint32_t>{};
+            a_out.coversFeet = a_formID != kPantyhose && a_formID != kCuirass;
+            a_out.coversCalves = a_formID == kPantyhose;
+            return a_formID != kNone;
+        }
+
+        ActorHandle LookupActor(std::uint32_t a_formID) override {
+            const auto it = actors.find(a_formID);
+            return it != actors.end() ? ActorHandle{a_formID, &it->second} : ActorHandle{};
+        }
+
+        // Reading the feet slot is where the flush evaluates an actor.
+        bool GetWornArmor(const ActorHandle& a_actor, ArmorSlot a_slot, ArmorInfo& a_out) override {
+            const auto* actor = static_cast<const Actor*>(a_actor.native);
+            if (a_slot == ArmorSlot::kFeet) {
+                ++evaluations[a_actor.formID];
+                if (onEvaluate) {
+                    onEvaluate(a_actor.formID);
+                }
+            }
+            return LookupArmor(a_slot == ArmorSlot::kFeet ? actor->feet : actor->calves, a_out);
+        }
+
+        std::map<std::uint32_t, Actor> actors;
+        std::map<std::uint32_t, std::size_t> evaluations;
+        std::function<void(std::uint32_t)> onEvaluate;
+    };
+
+    class FakeSkee : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char*, float) override {
+            morphs[a_actor.formID].insert(a_morphName);
+        }
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char*) override {
+            morphs[a_actor.formID].erase(a_morphName);
+        }
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char*) override {
+            return !morphs[a_actor.formID].empty();
+        }
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char*) override {
+            return morphs[a_actor.formID].contains(a_morphName) ? 1.0f : 0.0f;
+        }
+        void ApplyBodyMorphs(const ActorHandle&, bool) override { ++applyBodyMorphsCalls; }
+
+        std::map<std::uint32_t, std::set<std::string>> morphs;
+        std::size_t applyBodyMorphsCalls{};
+    };
+
+    // What an equip event reports, applied to the world before the event is sent.
+    struct Change {
+        std::uint32_t actor;
+        std::uint32_t armor;
+        bool isEquipped;
+    };
+
+    class Harness {
+    public:
+        Harness() : m_morphApplier(m_skee), m_pipeline(m_world, m_classifier, m_morphApplier) {
+            m_classifier.ParseJson({{"ByKeywords", {"SyntheticHeelKeyword"}}});
+            m_classifier.ResolveKeywords([](std::string_view) -> std::optional<std::uint32_t> { return kHeelKeyword; });
+        }
+
+        void AddActor(std::uint32_t a_formID, std::uint32_t a_feet, std::uint32_t a_calves) {
+            Actor& actor = m_world.actors[a_formID];
+            actor = {a_feet, a_calves};
+            m_pipeline.Sync({a_formID, &actor});
+            m_morphApplier.Commit(m_world);
+        }
+
+        // The event source: updates the slot, then reports it.
+        void Send(const Change& a_change) {
+            Actor& actor = m_world.actors.at(a_change.actor);
+            ArmorInfo armor;
+            m_world.LookupArmor(a_change.armor, armor);
+            if (armor.coversFeet) {
+                actor.feet = a_change.isEquipped ? a_change.armor : (actor.feet == a_change.armor ? kNone : actor.feet);
+            } else if (armor.coversCalves) {
+                actor.calves =
+                    a_change.isEquipped ? a_change.armor : (actor.calves == a_change.armor ? kNone : actor.calves);
+            }
+            if (m_pipeline.OnEquipEvent({a_change.actor, a_change.armor, a_change.isEquipped})) {
+                ++flushRequests;
+                m_isFlushScheduled = true;
+            }
+        }
+
+        // The fake tick: runs the flush if one was requested, then commits. Returns the actors evaluated.
+        std::map<std::uint32_t, std::size_t> Tick() {
+            m_world.evaluations.clear();
+            if (m_isFlushScheduled) {
+                m_isFlushScheduled = false;
+                m_pipeline.Flush();
+            }
+            m_morphApplier.Commit(m_world);
+            return m_world.evaluations;
+        }
+
+        // Every actor carries exactly the morphs of what it wears: NoHeel unless in high heels, Heel for high
+        // heels over pantyhose.
+        bool HasWornMorphs() const {
+            for (const auto& [formID, actor] : m_world.actors) {
+                const bool isHighHeel = actor.feet == kHighHeels || actor.feet == kOtherHighHeels;
+                std::set<std::string> expected;
+                if (!isHighHeel) {
+                    expected.insert("NoHeel");
+                } else if (actor.calves == kPantyhose) {
+                    expected.insert("Heel");
+                }
+                const auto it = m_skee.morphs.find(formID);
+                if ((it != m_skee.morphs.end() ? it->second : std::set<std::string>{}) != expected) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        FakeWorld& GetWorld() { return m_world; }
+        std::size_t GetApplyBodyMorphsCalls() const { return m_skee.applyBodyMorphsCalls; }
+
+        std::size_t flushRequests{};
+
+    private:
+        FakeWorld m_world;
+        FakeSkee m_skee;
+        HighHeelClassifier m_classifier;
+        MorphApplier m_morphApplier;
+        EquipPipeline m_pipeline;
+        bool m_isFlushScheduled{};
+    };
+
+    constexpr std::uint32_t kLydia = 0x000A2C94;
+    constexpr std::uint32_t kSerana = 0x02002B74;
+    constexpr std::uint32_t kPlayer = 0x00000014;
+
+    std::size_t g_checks = 0;
+    std::size_t g_failures = 0;
+
+    void Check(bool a_isOk, const std::string& a_what) {
+        ++g_checks;
+        if (!a_isOk) {
+            ++g_failures;
+            std::fprintf(stderr, "FAIL: %s\n", a_what.c_str());
+        }
+    }
+
+    // Three actors each get a burst of a_events: shoes swapped back and forth, pantyhose on and off, with some
+    // body armor in between that the pipeline drops.
+    void TestBurst(std::size_t a_events) {
+        const std::string name = "burst of " + std::to_string(a_events) + " event(s) per actor";
+        Harness harness;
+        harness.AddActor(kLydia, kLowHeels, kNone);
+        harness.AddActor(kSerana, kHighHeels, kPantyhose);
+        harness.AddActor(kPlayer, kNone, kNone);
+
+        static constexpr Change kCycle[] = {
+            {0, kLowHeels, false},  {0, kHighHeels, true},  {0, kPantyhose, true},  {0, kCuirass, true},
+            {0, kHighHeels, false}, {0, kLowHeels, true},   {0, kPantyhose, false}, {0, kCuirass, false},
+        };
+        std::size_t sent = 0;
+        for (std::size_t i = 0; i < a_events; ++i) {
+            for (const std::uint32_t actor : {kLydia, kSerana, kPlayer}) {
+                Change change = kCycle[(i + actor) % std::size(kCycle)];
+                change.actor = actor;
+                harness.Send(change);
+                ++sent;
+            }
+        }
+        Check(sent == 0 || harness.flushRequests == 1, name + ": more than one flush requested");
+
+        const auto evaluations = harness.Tick();
+        for (const std::uint32_t actor : {kLydia, kSerana, kPlayer}) {
+            const auto it = evaluations.find(actor);
+            const std::size_t count = it != evaluations.end() ? it->second : 0;
+            Check(count == (a_events > 0 ? 1u : 0u), name + ": actor evaluated " + std::to_string(count) + " time(s)");
+        }
+        Check(harness.HasWornMorphs(), name + ": wrong morphs after the tick");
+        Check(harness.Tick().empty(), name + ": actors evaluated again without new events");
+    }
+
+    // An event for Lydia arrives after the batch was taken: once between ticks, once while the flush evaluates
+    // Serana.
+    void TestLateEvent() {
+        Harness harness;
+        harness.AddActor(kLydia, kLowHeels, kNone);
+        harness.AddActor(kSerana, kLowHeels, kNone);
+
+        harness.Send({kLydia, kLowHeels, false});
+        harness.Send({kLydia, kHighHeels, true});
+        auto evaluations = harness.Tick();
+        Check(evaluations[kLydia] == 1, "late event: first burst not evaluated once");
+        Check(harness.HasWornMorphs(), "late event: wrong morphs after the first burst");
+
+        harness.Send({kLydia, kHighHeels, false});
+        Check(harness.flushRequests == 2, "late event between ticks: no new flush requested");
+        evaluations = harness.Tick();
+        Check(evaluations[kLydia] == 1, "late event between ticks: actor not evaluated again");
+        Check(harness.HasWornMorphs(), "late event between ticks: wrong morphs");
+
+        harness.Send({kSerana, kPantyhose, true});
+        harness.Send({kLydia, kHighHeels, true});
+        bool isSent = false;
+        harness.GetWorld().onEvaluate = [&](std::uint32_t a_actor) {
+            if (a_actor == kSerana && !isSent) {
+                isSent = true;
+                harness.Send({kLydia, kHighHeels, false});
+            }
+        };
+        harness.Tick();
+        harness.GetWorld().onEvaluate = nullptr;
+        Check(harness.flushRequests == 4, "late event during the flush: no new flush requested");
+        evaluations = harness.Tick();
+        Check(evaluations.size() == 1 && evaluations[kLydia] == 1,
+              "late event during the flush: only the late actor must be evaluated again");
+        Check(harness.HasWornMorphs(), "late event during the flush: wrong morphs");
+    }
+
+    // New heels report their equip before the old heels report their unequip. Replaying the events would go
+    // HighHeel -> (equip high heel) HighHeel -> (unequip high heel) no high heel and set NoHeel in high heels.
+    void TestHeelSwap(std::uint32_t a_calves) {
+        const std::string name = a_calves == kPantyhose ? "heel swap over pantyhose" : "heel swap";
+        Harness harness;
+        harness.AddActor(kLydia, kHighHeels, a_calves);
+        const std::size_t applied = harness.GetApplyBodyMorphsCalls();
+
+        harness.Send({kLydia, kOtherHighHeels, true});
+        harness.Send({kLydia, kHighHeels, false});
+        harness.Tick();
+        Check(harness.HasWornMorphs(), name + ": morphs do not match the new heels");
+        Check(harness.GetApplyBodyMorphsCalls() == applied, name + ": morphs rewritten for an unchanged state");
+
+        // And back, in the order the game usually reports it.
+        harness.Send({kLydia, kOtherHighHeels, false});
+        harness.Send({kLydia, kHighHeels, true});
+        harness.Tick();
+        Check(harness.HasWornMorphs(), name + ": morphs do not match the old heels");
+        Check(harness.GetApplyBodyMorphsCalls() == applied, name + ": morphs rewritten for an unchanged state");
+    }
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    for (const std::size_t events : {0, 1, 2, 3, 8, 64, 1000}) {
+        TestBurst(events);
+    }
+    TestLateEvent();
+    TestHeelSwap(kNone);
+    TestHeelSwap(kPantyhose);
+
+    std::printf("%zu check(s), %zu failure(s)\n", g_checks, g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Keyword rules matched by FormID against the string compare they replaced.
+//
+// Before keyword rules were resolved on kDataLoaded, HighHeelDetector::IsHighHeel called
+// TESObjectARMO::HasKeywordString once per rule, which compares the editor ID of every keyword on the armor with the
+// rule, ignoring case like every BSFixedString compare. This test keeps that loop, over a fake keyword table, as the
+// expected verdict, and checks KeywordRuleSet::Match() and HighHeelRules::Classify() against it for every subset of
+// a list of rules (resolvable, differing only in case, duplicated, unknown, empty) and every subset of a list of
+// armor keywords (including none at all, and a keyword without an editor ID).
+//
+//   KeywordRuleSetTest
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HighHeelRules.h"
+
+namespace {
+    struct FakeKeyword {
+        std::uint32_t formID;
+        std::string_view editorID;
+    };
+
+    // The keywords of the load order. 0x0C000999 is a keyword created at runtime, without an editor ID.
+    constexpr FakeKeyword kKeywordTable[] = {
+        {0x0006BBE3, "ArmorBoots"}, {0x0006BBD4, "ArmorClothing"}, {0x0A000801, "HighHeelKeyword"},
+        {0x0A000802, "SH_Heels"},   {0x0B000801, "StilettoKW"},    {0x0C000999, ""},
+    };
+
+    constexpr std::string_view kRuleNames[] = {"HighHeelKeyword", "sh_heels", "StilettoKW", "NotAKeyword",
+                                               "",                "ArmorBoots", "HighHeelKeyword"};
+    constexpr std::uint32_t kArmorKeywords[] = {0x0006BBE3, 0x0006BBD4, 0x0A000801,
+                                                0x0A000802, 0x0B000801, 0x0C000999};
+
+    bool EqualsIgnoringCase(std::string_view a_left, std::string_view a_right) {
+        if (a_left.size() != a_right.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a_left.size(); ++i) {
+            const auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+            if (lower(a_left[i]) != lower(a_right[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // TESForm::LookupByEditorID<BGSKeyword>: forms without an editor ID cannot be looked up.
+    std::optional<std::uint32_t> LookupByEditorID(std::string_view a_editorID) {
+        for (const auto& keyword : kKeywordTable) {
+            if (!keyword.editorID.empty() && EqualsIgnoringCase(keyword.editorID, a_editorID)) {
+                return keyword.formID;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // TESObjectARMO::HasKeywordString.
+    bool HasKeywordString(std::span<const std::uint32_t> a_armorKeywords, std::string_view a_editorID) {
+        for (const std::uint32_t formID : a_armorKeywords) {
+            for (const auto& keyword : kKeywordTable) {
+                if (keyword.formID == formID && !keyword.editorID.empty() &&
+                    EqualsIgnoringCase(keyword.editorID, a_editorID)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The loop over the rules HighHeelDetector::IsHighHeel used to run.
+    bool MatchesByString(std::span<const std::string> a_rules, std::span<const std::uint32_t> a_armorKeywords) {
+        for (const auto& rule : a_rules) {
+            if (HasKeywordString(a_armorKeywords, rule)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class TOut, class T, std::size_t N>
+    std::vector<TOut> Subset(const T (&a_items)[N], std::uint32_t a_mask) {
+        std::vector<TOut> subset;
+        for (std::size_t i = 0; i < N; ++i) {
+            if (a_mask & (1u << i)) {
+                subset.emplace_back(a_items[i]);
+            }
+        }
+        return subset;
+    }
+
+    std::string Describe(std::span<const std::string> a_rules, std::span<const std::uint32_t> a_armorKeywords) {
+        std::string text = "rules [";
+        for (const auto& rule : a_rules) {
+            text += " '" + rule + "'";
+        }
+        text += " ], armor keywords [";
+        for (const std::uint32_t formID : a_armorKeywords) {
+            char hex[16];
+            std::snprintf(hex, sizeof(hex), " %08X", formID);
+            text += hex;
+        }
+        return text + " ]";
+    }
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    std::size_t checks = 0;
+    std::size_t failures = 0;
+    const auto check = [&](bool a_isOk, const char* a_what, const std::string& a_case) {
+        ++checks;
+        if (!a_isOk) {
+            ++failures;
+            std::fprintf(stderr, "FAIL: %s; %s\n", a_what, a_case.c_str());
+        }
+    };
+
+    for (std::uint32_t ruleMask = 0; ruleMask < (1u << std::size(kRuleNames)); ++ruleMask) {
+        const std::vector<std::string> rules = Subset<std::string>(kRuleNames, ruleMask);
+
+        KeywordRuleSet keywordRules;
+        for (const auto& rule : rules) {
+            keywordRules.Add(rule);
+        }
+        const std::vector<std::uint32_t> everyKeyword(std::begin(kArmorKeywords), std::end(kArmorKeywords));
+        check(keywordRules.Match(everyKeyword) == nullptr, "a keyword rule matched before it was resolved",
+              Describe(rules, everyKeyword));
+
+        std::vector<std::string> expectedUnresolved;
+        for (const auto& rule : rules) {
+            if (!LookupByEditorID(rule)) {
+                expectedUnresolved.push_back(rule);
+            }
+        }
+        check(keywordRules.Resolve(LookupByEditorID) == expectedUnresolved, "wrong unresolved keyword rules",
+              Describe(rules, {}));
+
+        nlohmann::json json;
+        json["ByKeywords"] = rules;
+        HighHeelRules highHeelRules;
+        highHeelRules.ParseJson(json);
+        highHeelRules.ResolveKeywords(LookupByEditorID);
+
+        for (std::uint32_t armorMask = 0; armorMask < (1u << std::size(kArmorKeywords)); ++armorMask) {
+            const std::vector<std::uint32_t> armorKeywords = Subset<std::uint32_t>(kArmorKeywords, armorMask);
+            const bool expected = MatchesByString(rules, armorKeywords);
+
+            const char* matched = keywordRules.Match(armorKeywords);
+            check((matched != nullptr) == expected, "KeywordRuleSet::Match differs from HasKeywordString",
+                  Describe(rules, armorKeywords));
+            // The rule reported as matched must be one the armor carries.
+            if (matched) {
+                check(HasKeywordString(armorKeywords, matched),
+                      "KeywordRuleSet::Match names a rule that did not match", Describe(rules, armorKeywords));
+            }
+
+            ArmorInfo armor;
+            armor.formID = 0x01000800;
+            armor.plugin = "Heels.esp";
+            armor.localFormID = 0x800;
+            armor.keywords = armorKeywords;
+            armor.coversFeet = true;
+            check(highHeelRules.Classify(armor) == expected,
+                  "HighHeelRules::Classify differs from HasKeywordString", Describe(rules, armorKeywords));
+        }
+    }
+
+    std::printf("%zu check(s), %zu failure(s)\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
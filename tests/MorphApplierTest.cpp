@@ -0,0 +1,278 @@
+// Backend call counts of MorphApplier for typical equip/unequip sequences, against the applier it replaced.
+//
+// Before MorphApplier, every equip event cleared the legacy morph, wrote every morph of the new state and rebuilt the
+// mesh, whether or not anything had changed. This test replays the same sequences of states through that baseline
+// and through MorphApplier::UpdateMorphState() + Commit(), each against a fake SKEE that stores morphs and counts
+// every call, and checks both against the counts written out below. It also checks that both leave every actor with
+// exactly the morphs of its last state and no legacy morph.
+//
+//   MorphApplierTest
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "MorphApplier.h"
+
+namespace {
+    using State = MorphStateMachine::State;
+
+    struct Counts {
+        std::size_t setMorph{};
+        std::size_t clearMorph{};
+        std::size_t hasBodyMorphKey{};
+        std::size_t getMorph{};
+        std::size_t applyBodyMorphs{};
+
+        bool operator==(const Counts&) const = default;
+    };
+
+    // Keeps morphs the way SKEE does, per actor, morph name and key, and counts every call.
+    class CountingSkee : public IMorphBackend {
+    public:
+        void SetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey,
+                      float a_value) override {
+            ++counts.setMorph;
+            morphs[{a_actor.formID, a_morphName, a_morphKey}] = a_value;
+        }
+
+        void ClearMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++counts.clearMorph;
+            morphs.erase({a_actor.formID, a_morphName, a_morphKey});
+        }
+
+        bool HasBodyMorphKey(const ActorHandle& a_actor, const char* a_morphKey) override {
+            ++counts.hasBodyMorphKey;
+            for (const auto& [morph, value] : morphs) {
+                if (std::get<0>(morph) == a_actor.formID && std::get<2>(morph) == a_morphKey) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        float GetMorph(const ActorHandle& a_actor, const char* a_morphName, const char* a_morphKey) override {
+            ++counts.getMorph;
+            const auto it = morphs.find({a_actor.formID, a_morphName, a_morphKey});
+            return it != morphs.end() ? it->second : 0.0f;
+        }
+
+        void ApplyBodyMorphs(const ActorHandle&, bool) override { ++counts.applyBodyMorphs; }
+
+        float Get(std::uint32_t a_actor, const char* a_morphName, const char* a_morphKey) const {
+            const auto it = morphs.find({a_actor, a_morphName, a_morphKey});
+            return it != morphs.end() ? it->second : 0.0f;
+        }
+
+        Counts counts;
+        std::map<std::tuple<std::uint32_t, std::string, std::string>, float> morphs;
+    };
+
+    // Every actor exists; the test never asks for armor.
+    class FakeActors : public IArmorLookup {
+    public:
+        bool LookupArmor(std::uint32_t, ArmorInfo&) override { return false; }
+        ActorHandle LookupActor(std::uint32_t a_formID) override { return {a_formID, this}; }
+        bool GetWornArmor(const ActorHandle&, ArmorSlot, ArmorInfo&) override { return false; }
+    };
+
+    // What every equip event did before: clear the legacy morph, write every morph, rebuild the mesh.
+    void ApplyUnconditionally(IMorphBackend& a_backend, const ActorHandle& a_actor, State a_state) {
+        a_backend.ClearMorph(a_actor, "NoHeel", MorphApplier::kLegacyMorphKey);
+        for (std::size_t i = 0; i < MorphStateMachine::kMorphCount; ++i) {
+            const auto morph = static_cast<MorphStateMachine::Morph>(i);
+            const char* morphName = MorphStateMachine::GetMorphName(morph);
+            if (MorphStateMachine::IsMorphSet(a_state, morph)) {
+                a_backend.SetMorph(a_actor, morphName, MorphApplier::kMorphKey, 1.0f);
+            } else {
+                a_backend.ClearMorph(a_actor, morphName, MorphApplier::kMorphKey);
+            }
+        }
+        a_backend.ApplyBodyMorphs(a_actor, false);
+    }
+
+    struct Event {
+        std::uint32_t actor;
+        State state;
+        bool isEndOfTick;  // the plugin commits once per frame
+    };
+
+    struct Scenario {
+        const char* name;
+        // Morphs the actors carry when the session starts, e.g. restored from the save by SKEE.
+        std::vector<std::tuple<std::uint32_t, const char*, const char*>> savedMorphs;
+        std::vector<Event> events;
+        Counts before;
+        Counts after;
+    };
+
+    constexpr std::uint32_t kLydia = 0x000A2C94;
+    constexpr std::uint32_t kSerana = 0x02002B74;
+    constexpr std::uint32_t kPlayer = 0x00000014;
+
+    // Morphs per state: BarefeetBarelegs, LowHeel* and *Pantyhose without high heels carry NoHeel, HighHeelBarelegs
+    // carries neither and HighHeelPantyhose carries Heel.
+    const std::vector<Scenario> kScenarios = {
+        {"the same boots equipped ten times",
+         {},
+         {{kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true}},
+         {.setMorph = 10, .clearMorph = 20, .applyBodyMorphs = 10},
+         {.setMorph = 1, .hasBodyMorphKey = 2, .applyBodyMorphs = 1}},
+
+        {"high heels on and off three times",
+         {},
+         {{kLydia, State::kBarefeetBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, true},
+          {kLydia, State::kBarefeetBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, true},
+          {kLydia, State::kBarefeetBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, true},
+          {kLydia, State::kBarefeetBarelegs, true}},
+         {.setMorph = 4, .clearMorph = 17, .applyBodyMorphs = 7},
+         {.setMorph = 4, .clearMorph = 3, .hasBodyMorphKey = 2, .applyBodyMorphs = 7}},
+
+        {"pantyhose, then high heels over them, then back",
+         {},
+         {{kLydia, State::kBarefeetBarelegs, true},
+          {kLydia, State::kBarefeetPantyhose, true},
+          {kLydia, State::kHighHeelPantyhose, true},
+          {kLydia, State::kBarefeetPantyhose, true},
+          {kLydia, State::kBarefeetBarelegs, true}},
+         {.setMorph = 5, .clearMorph = 10, .applyBodyMorphs = 5},
+         {.setMorph = 3, .clearMorph = 2, .hasBodyMorphKey = 2, .applyBodyMorphs = 3}},
+
+        {"boots swapped for high heels and back within one frame",
+         {},
+         {{kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, false},
+          {kLydia, State::kLowHeelBarelegs, true}},
+         {.setMorph = 2, .clearMorph = 7, .applyBodyMorphs = 3},
+         {.setMorph = 1, .hasBodyMorphKey = 2, .applyBodyMorphs = 1}},
+
+        {"three actors change at once",
+         {},
+         {{kLydia, State::kLowHeelBarelegs, false},
+          {kSerana, State::kHighHeelPantyhose, false},
+          {kPlayer, State::kHighHeelBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, false},
+          {kSerana, State::kLowHeelPantyhose, false},
+          {kPlayer, State::kLowHeelBarelegs, true}},
+         {.setMorph = 4, .clearMorph = 14, .applyBodyMorphs = 6},
+         {.setMorph = 4, .clearMorph = 2, .hasBodyMorphKey = 6, .applyBodyMorphs = 5}},
+
+        {"saved with the right morphs, after a load",
+         {{kLydia, "NoHeel", MorphApplier::kMorphKey}},
+         {{kLydia, State::kLowHeelBarelegs, true}, {kLydia, State::kLowHeelBarelegs, true}},
+         {.setMorph = 2, .clearMorph = 4, .applyBodyMorphs = 2},
+         {.hasBodyMorphKey = 2, .getMorph = 2}},
+
+        {"saved by a release with the legacy morph key",
+         {{kLydia, "NoHeel", MorphApplier::kLegacyMorphKey}},
+         {{kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kLowHeelBarelegs, true},
+          {kLydia, State::kHighHeelBarelegs, true}},
+         {.setMorph = 2, .clearMorph = 7, .applyBodyMorphs = 3},
+         {.setMorph = 1, .clearMorph = 2, .hasBodyMorphKey = 2, .applyBodyMorphs = 2}},
+    };
+
+    void Seed(CountingSkee& a_backend, const Scenario& a_scenario) {
+        for (const auto& [actor, morphName, morphKey] : a_scenario.savedMorphs) {
+            a_backend.morphs[{actor, morphName, morphKey}] = 1.0f;
+        }
+    }
+
+    Counts RunBefore(const Scenario& a_scenario, CountingSkee& a_backend) {
+        Seed(a_backend, a_scenario);
+        FakeActors actors;
+        for (const auto& event : a_scenario.events) {
+            ApplyUnconditionally(a_backend, actors.LookupActor(event.actor), event.state);
+        }
+        return a_backend.counts;
+    }
+
+    Counts RunAfter(const Scenario& a_scenario, CountingSkee& a_backend) {
+        Seed(a_backend, a_scenario);
+        FakeActors actors;
+        MorphApplier applier(a_backend);
+        for (const auto& event : a_scenario.events) {
+            applier.UpdateMorphState(actors.LookupActor(event.actor), event.state);
+            if (event.isEndOfTick) {
+                applier.Commit(actors);
+            }
+        }
+        applier.Commit(actors);
+        return a_backend.counts;
+    }
+
+    std::string Describe(const Counts& a_counts) {
+        char text[160];
+        std::snprintf(text, sizeof(text),
+                      "SetMorph %zu, ClearMorph %zu, HasBodyMorphKey %zu, GetMorph %zu, ApplyBodyMorphs %zu",
+                      a_counts.setMorph, a_counts.clearMorph, a_counts.hasBodyMorphKey, a_counts.getMorph,
+                      a_counts.applyBodyMorphs);
+        return text;
+    }
+
+    // Every actor ends with the morphs of its last state, under the current key only.
+    bool HasFinalMorphs(const Scenario& a_scenario, const CountingSkee& a_backend) {
+        std::map<std::uint32_t, State> finalStates;
+        for (const auto& event : a_scenario.events) {
+            finalStates[event.actor] = event.state;
+        }
+        for (const auto& [actor, state] : finalStates) {
+            if (a_backend.Get(actor, "NoHeel", MorphApplier::kLegacyMorphKey) != 0.0f) {
+                return false;
+            }
+            for (std::size_t i = 0; i < MorphStateMachine::kMorphCount; ++i) {
+                const auto morph = static_cast<MorphStateMachine::Morph>(i);
+                const bool isSet =
+                    a_backend.Get(actor, MorphStateMachine::GetMorphName(morph), MorphApplier::kMorphKey) != 0.0f;
+                if (isSet != MorphStateMachine::IsMorphSet(state, morph)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::off);
+
+    std::size_t failures = 0;
+    for (const auto& scenario : kScenarios) {
+        CountingSkee beforeBackend;
+        CountingSkee afterBackend;
+        const Counts before = RunBefore(scenario, beforeBackend);
+        const Counts after = RunAfter(scenario, afterBackend);
+        std::printf("%s\n  before: %s\n  after:  %s\n", scenario.name, Describe(before).c_str(),
+                    Describe(after).c_str());
+
+        const auto check = [&](bool a_isOk, const char* a_what) {
+            if (!a_isOk) {
+                ++failures;
+                std::fprintf(stderr, "FAIL: %s: %s\n", scenario.name, a_what);
+            }
+        };
+        check(before == scenario.before, "unexpected call counts before the change");
+        check(after == scenario.after, "unexpected call counts after the change");
+        check(after.applyBodyMorphs <= before.applyBodyMorphs, "more mesh rebuilds than before the change");
+        check(HasFinalMorphs(scenario, beforeBackend), "wrong morphs before the change");
+        check(HasFinalMorphs(scenario, afterBackend), "wrong morphs after the change");
+    }
+
+    std::printf("%zu scenario(s), %zu failure(s)\n", kScenarios.size(), failures);
+    return failures == 0 ? 0 : 1;
+}
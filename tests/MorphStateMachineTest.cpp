@@ -0,0 +1,106 @@
+// MorphStateMachine against tables written out here by hand, not derived from MorphStateMachine.h or the generated
+// FSMTable.h.
+//
+// kSlots is the state numbering of docs/FSM.csv, which the co-save depends on. kMorphs is what each state should
+// leave on the body. Its Barelegs rows deliberately differ from the "Morph Action" column of docs/FSMbyGPT.csv: the
+// plugin has always shipped NoHeel on everything but high heels, and without pantyhose high heels carry no morph at
+// all. The Pantyhose rows follow FSMbyGPT.csv.
+//
+// Every state is checked through FromSlots(), GetFeet() and GetCalves(); every pair of states through Diff(), which
+// must write exactly the morphs that differ and reach the target's morphs.
+//
+//   MorphStateMachineTest
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "MorphStateMachine.h"
+
+namespace {
+    using State = MorphStateMachine::State;
+    using Morph = MorphStateMachine::Morph;
+    using Feet = MorphStateMachine::Feet;
+    using Calves = MorphStateMachine::Calves;
+
+    constexpr State kStates[] = {State::kInvalid,           State::kBarefeetBarelegs,  State::kLowHeelBarelegs,
+                                 State::kHighHeelBarelegs,  State::kBarefeetPantyhose, State::kLowHeelPantyhose,
+                                 State::kHighHeelPantyhose};
+
+    // {Heel, NoHeel} per state.
+    constexpr bool kMorphs[7][2] = {
+        {false, false},  // 0 Invalid
+        {false, true},   // 1 Barefeet  Barelegs    NoHeel
+        {false, true},   // 2 LowHeel   Barelegs    NoHeel
+        {false, false},  // 3 HighHeel  Barelegs    nothing
+        {false, true},   // 4 Barefeet  Pantyhose   NoHeel
+        {false, true},   // 5 LowHeel   Pantyhose   NoHeel
+        {true, false},   // 6 HighHeel  Pantyhose   Heel
+    };
+
+    // {Feet, Calves} per valid state.
+    constexpr std::pair<Feet, Calves> kSlots[7] = {
+        {},
+        {Feet::kBarefeet, Calves::kBarelegs},
+        {Feet::kLowHeel, Calves::kBarelegs},
+        {Feet::kHighHeel, Calves::kBarelegs},
+        {Feet::kBarefeet, Calves::kPantyhose},
+        {Feet::kLowHeel, Calves::kPantyhose},
+        {Feet::kHighHeel, Calves::kPantyhose},
+    };
+
+    std::size_t g_checks = 0;
+    std::size_t g_failures = 0;
+
+    void Check(bool a_isOk, const std::string& a_what) {
+        ++g_checks;
+        if (!a_isOk) {
+            ++g_failures;
+            std::fprintf(stderr, "FAIL: %s\n", a_what.c_str());
+        }
+    }
+
+    std::string Name(int a_state) { return "state " + std::to_string(a_state); }
+}
+
+int main() {
+    for (int state = 0; state < 7; ++state) {
+        Check(MorphStateMachine::IsMorphSet(kStates[state], Morph::kHeel) == kMorphs[state][0],
+              Name(state) + ": wrong Heel morph");
+        Check(MorphStateMachine::IsMorphSet(kStates[state], Morph::kNoHeel) == kMorphs[state][1],
+              Name(state) + ": wrong NoHeel morph");
+        if (state != 0) {
+            const auto [feet, calves] = kSlots[state];
+            Check(MorphStateMachine::FromSlots(feet, calves) == kStates[state], Name(state) + ": wrong FromSlots()");
+            Check(MorphStateMachine::GetFeet(kStates[state]) == feet, Name(state) + ": wrong GetFeet()");
+            Check(MorphStateMachine::GetCalves(kStates[state]) == calves, Name(state) + ": wrong GetCalves()");
+        }
+    }
+
+    // From Invalid nothing is known about the body, so every morph is written; otherwise only what differs.
+    for (int from = 0; from < 7; ++from) {
+        for (int to = 1; to < 7; ++to) {
+            const std::string pair = Name(from) + " -> " + Name(to);
+            bool morphs[2] = {kMorphs[from][0], kMorphs[from][1]};
+            bool isWritten[2] = {};
+            for (const auto& op : MorphStateMachine::Diff(kStates[from], kStates[to])) {
+                const auto m = static_cast<std::size_t>(op.morph);
+                Check(!isWritten[m], pair + ": morph written twice");
+                isWritten[m] = true;
+                morphs[m] = op.isSet;
+            }
+            for (std::size_t m = 0; m < 2; ++m) {
+                const bool isExpected = from == 0 || kMorphs[from][m] != kMorphs[to][m];
+                Check(isWritten[m] == isExpected, pair + ": morph " + std::to_string(m) +
+                                                      (isExpected ? " not written" : " written needlessly"));
+                Check(morphs[m] == kMorphs[to][m], pair + ": morph " + std::to_string(m) + " wrong afterwards");
+            }
+        }
+    }
+
+    Check(std::string(MorphStateMachine::GetMorphName(Morph::kHeel)) == "Heel", "wrong name of the Heel morph");
+    Check(std::string(MorphStateMachine::GetMorphName(Morph::kNoHeel)) == "NoHeel", "wrong name of the NoHeel morph");
+
+    std::printf("%zu check(s), %zu failure(s)\n", g_checks, g_failures);
+    return g_failures == 0 ? 0 : 1;
+}